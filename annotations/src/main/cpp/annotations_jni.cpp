@@ -0,0 +1,49 @@
+/* Copyright 2018
+ * Bernard Bou
+ * 1313ou@gmail.com */
+
+#include <jni.h>
+#include <cstddef>
+#include <vector>
+
+#include "depparse_native/slot_allocator.h"
+
+const char kIllegalArgumentException[] = "java/lang/IllegalArgumentException";
+
+// S L O T S
+
+/**
+ * Native allocate function callable from Java
+ * Allocates vertical slots to spans [lows[i], highs[i]), first fit in array order
+ *
+ * @return slot of each span
+ */
+extern "C" JNIEXPORT
+jintArray
+JNICALL Java_org_grammarscope_annotations_allocator_NativeSlotAllocator_allocate(
+        JNIEnv *env,
+        jobject type,
+        jintArray j_lows,
+        jintArray j_highs) {
+
+    (void) type;
+    jsize n = env->GetArrayLength(j_lows);
+    if (env->GetArrayLength(j_highs) != n) {
+        env->ThrowNew(env->FindClass(kIllegalArgumentException), "Span starts and ends differ in length");
+        return nullptr;
+    }
+
+    // single copy in, single copy out
+    std::vector<int32_t> lows(static_cast<size_t>(n));
+    std::vector<int32_t> highs(static_cast<size_t>(n));
+    std::vector<int32_t> slots(static_cast<size_t>(n));
+    env->GetIntArrayRegion(j_lows, 0, n, reinterpret_cast<jint *>(lows.data()));
+    env->GetIntArrayRegion(j_highs, 0, n, reinterpret_cast<jint *>(highs.data()));
+    allocateSlots(lows.data(), highs.data(), n, slots.data());
+
+    jintArray j_slots = env->NewIntArray(n);
+    if (j_slots == nullptr)
+        return nullptr;
+    env->SetIntArrayRegion(j_slots, 0, n, reinterpret_cast<const jint *>(slots.data()));
+    return j_slots;
+}
@@ -0,0 +1,35 @@
+package org.grammarscope.annotations.allocator
+
+import android.util.Log
+
+/**
+ * Native vertical slot allocator for index ranges: same first-fit allocation as SlotAllocatorForSequences
+ * over flat arrays (segment tree of slot bitmaps), each range costing O(log n) whatever its length,
+ * so that re-layout stays interactive with thousands of crossing arcs.
+ */
+object NativeSlotAllocator {
+
+    private const val TAG = "NativeSlotAllocator"
+
+    /**
+     * Whether the native library could be loaded, allocation falling back to Kotlin otherwise
+     */
+    val isAvailable: Boolean by lazy {
+        try {
+            System.loadLibrary("annotations_jni")
+            true
+        } catch (e: UnsatisfiedLinkError) {
+            Log.w(TAG, "No native slot allocator: $e")
+            false
+        }
+    }
+
+    /**
+     * Allocate slots, first fit in array order, range i covering indices [lows[i], highs[i])
+     *
+     * @param lows range low indices
+     * @param highs range high indices (exclusive)
+     * @return slot of each range, at most 64 slots being allocated as with SlotAllocatorForSequences
+     */
+    external fun allocate(lows: IntArray, highs: IntArray): IntArray
+}
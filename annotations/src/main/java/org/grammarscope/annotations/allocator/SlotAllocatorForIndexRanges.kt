@@ -14,18 +14,64 @@ open class SlotAllocatorForIndexRanges<T : HasIndices> : SlotAllocatorForSequenc
     @JvmField
     protected val slots: MutableMap<T, Int> = Hashtable<T, Int>()
 
+    /**
+     * Elements in allocation order
+     */
+    private val allocated: MutableList<T> = ArrayList()
+
+    /**
+     * Whether allocation went native, after which it stays native
+     */
+    private var isNative = false
+
+    /**
+     * Number of slots in use, when allocated natively
+     */
+    private var nativeSlotCount = 0
+
     /**
      * Allocate slots and cache them
      *
      * @param elements elements in range
      */
     fun allocate(elements: MutableCollection<T>) {
+        // long inputs go native
+        if (isNative || (allocated.size + elements.size >= NATIVE_THRESHOLD && NativeSlotAllocator.isAvailable)) {
+            allocateNatively(elements)
+            return
+        }
+
         // iterate on elements and allocate
         for (element in elements) {
             allocateSlot(element)
         }
+        allocated.addAll(elements)
     }
 
+    /**
+     * Allocate slots natively, replaying elements allocated so far (first fit leaves their slots unchanged)
+     *
+     * @param elements elements in range
+     */
+    private fun allocateNatively(elements: MutableCollection<T>) {
+        allocated.addAll(elements)
+        val lows = IntArray(allocated.size) { allocated[it].lowIndex }
+        val highs = IntArray(allocated.size) { allocated[it].highIndex }
+        val allocatedSlots = NativeSlotAllocator.allocate(lows, highs)
+        val used = HashSet<Int>()
+        for (i in allocated.indices) {
+            this.slots[allocated[i]] = allocatedSlots[i]
+            if (lows[i] < highs[i]) {
+                used.add(minOf(allocatedSlots[i], 63))
+            }
+        }
+        nativeSlotCount = used.size
+        isNative = true
+    }
+
+    override val maxSlot: Int
+        get() = if (isNative) nativeSlotCount else super.maxSlot
+
     /**
      * Get element's slot from cache
      *
@@ -54,4 +100,12 @@ open class SlotAllocatorForIndexRanges<T : HasIndices> : SlotAllocatorForSequenc
         val slot = super.allocateSlot(elements)
         this.slots[element] = slot
     }
+
+    companion object {
+
+        /**
+         * Number of elements from which allocation goes native
+         */
+        private const val NATIVE_THRESHOLD = 64
+    }
 }
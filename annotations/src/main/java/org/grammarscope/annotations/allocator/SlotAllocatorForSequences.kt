@@ -49,7 +49,7 @@ open class SlotAllocatorForSequences<T> {
     /**
      * Maximum number of slots allocated
      */
-    val maxSlot: Int
+    open val maxSlot: Int
         get() {
             val bitMap = mergeAllSlots()
 
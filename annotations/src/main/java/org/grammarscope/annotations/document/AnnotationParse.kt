@@ -53,8 +53,11 @@ class ParsedGraph(val sentence: Sentence) : Graph<Token> {
 
             // enhanced dependencies
             if (token.deps != null && token.deps!!.isNotEmpty()) {
-                val enhancedDeps = TokenEnhancedDepsProcessor.parse(token.deps!!) // list of (label, head) pairs
+                val enhancedDeps = TokenEnhancedDepsProcessor.parse(token) // list of (label, head) pairs
                 for ((label, head) in enhancedDeps) {
+                    if (head == -1 || head >= sentence.tokens.size) {
+                        continue
+                    }
                     val headToken = sentence.tokens[head]
                     val edge = if (reverse)
                         TokenEdge(headToken, token, label, token.index, true)
@@ -97,7 +97,7 @@ object Decorator {
                 this
                     .append('-')
                     .append(' ')
-                    .append(enhanced(token.deps!!, tokens, factories[4], factories[1]))
+                    .append(enhanced(token, tokens, factories[4], factories[1]))
                     .append('\n')
 
             // tag
@@ -133,8 +133,8 @@ object Decorator {
         return bidiFormatter.unicodeWrap(token)
     }
 
-    fun enhanced(deps: String, tokens: Array<Token>, vararg factories: SpanFactory): CharSequence {
-        val enhancedDeps = TokenEnhancedDepsProcessor.parse(deps)
+    fun enhanced(token: Token, tokens: Array<Token>, vararg factories: SpanFactory): CharSequence {
+        val enhancedDeps = TokenEnhancedDepsProcessor.parse(token)
         val sb = SpannableStringBuilder()
         for ((label, head) in enhancedDeps) {
             val headWord = if (head == -1 || head >= tokens.size) "?" else tokens[head].word // 0-based head index
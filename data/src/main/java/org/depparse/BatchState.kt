@@ -0,0 +1,57 @@
+package org.depparse
+
+/**
+ * State of native adaptive batch sizing, decoded from the array returned by batchState calls.
+ * Parse calls are split natively into batches sized so that each (parse and conversion) takes about the target latency,
+ * the parse context being released between batches so that concurrent calls interleave.
+ *
+ * @property data packed state
+ */
+class BatchState(@JvmField val data: LongArray) {
+
+    /**
+     * Target latency per batch in nanoseconds
+     */
+    val targetNanos: Long
+        get() = data[0]
+
+    /**
+     * Estimated cost per KiB of input text in nanoseconds
+     */
+    val nanosPerKByte: Long
+        get() = data[1]
+
+    /**
+     * Observed cost per token in nanoseconds, 0 until measured
+     */
+    val nanosPerToken: Long
+        get() = data[2]
+
+    /**
+     * Current batch size in bytes of input text
+     */
+    val batchBytes: Long
+        get() = data[3]
+
+    /**
+     * Number of batches observed
+     */
+    val count: Long
+        get() = data[4]
+
+    /**
+     * Number of texts in last batch
+     */
+    val lastTexts: Long
+        get() = data[5]
+
+    /**
+     * Latency of last batch in nanoseconds
+     */
+    val lastNanos: Long
+        get() = data[6]
+
+    override fun toString(): String {
+        return "target=${targetNanos / 1000000}ms batch=${batchBytes}B cost=${nanosPerKByte}ns/KiB ${nanosPerToken}ns/token batches=$count last=$lastTexts texts in ${lastNanos / 1000}us"
+    }
+}
@@ -0,0 +1,102 @@
+package org.depparse
+
+import android.os.ParcelFileDescriptor
+import java.io.FileInputStream
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+import java.nio.channels.FileChannel
+
+/**
+ * Decoder of the native binary document layout (depparse_native/binary.h), as written to shared memory:
+ * [header (8 ints), sentences (6 ints each), tokens (15 ints each), deps (2 ints each), string offsets (string count + 1), chars]
+ * Integers are in native byte order, strings are NUL-terminated UTF-8.
+ */
+object BinaryDocument {
+
+    private const val MAGIC = 0x31425044 // "DPB1"
+    private const val VERSION = 1
+    private const val HEADER_INTS = 8
+    private const val SENTENCE_INTS = 6
+    private const val TOKEN_INTS = 15
+    private const val DEP_INTS = 2
+
+    /**
+     * Map shared memory read-only and decode it, file descriptor is closed
+     *
+     * @param pfd file descriptor of shared memory holding a binary document
+     * @return sentences
+     */
+    fun read(pfd: ParcelFileDescriptor): Array<Sentence> {
+        pfd.use {
+            FileInputStream(it.fileDescriptor).channel.use { channel ->
+                return read(channel.map(FileChannel.MapMode.READ_ONLY, 0, channel.size()))
+            }
+        }
+    }
+
+    /**
+     * Decode binary document
+     *
+     * @param buffer buffer holding a binary document at position 0
+     * @return sentences
+     * @throws IllegalArgumentException if buffer does not hold a binary document
+     */
+    fun read(buffer: ByteBuffer): Array<Sentence> {
+        val ints = buffer.duplicate().order(ByteOrder.nativeOrder()).asIntBuffer()
+        require(ints.limit() >= HEADER_INTS && ints[0] == MAGIC && ints[1] == VERSION) { "Not a binary document" }
+        val sentenceCount = ints[2]
+        val tokenCount = ints[3]
+        val depCount = ints[4]
+        val stringCount = ints[5]
+        val sentencesAt = HEADER_INTS
+        val tokensAt = sentencesAt + sentenceCount * SENTENCE_INTS
+        val depsAt = tokensAt + tokenCount * TOKEN_INTS
+        val offsetsAt = depsAt + depCount * DEP_INTS
+        val charsAt = (offsetsAt + stringCount + 1) * 4
+
+        // strings, decoded once per id so that interned labels and tags are shared
+        val chars = buffer.duplicate()
+        val strings = arrayOfNulls<String>(stringCount)
+        fun str(id: Int): String? {
+            if (id < 0) {
+                return null
+            }
+            var s = strings[id]
+            if (s == null) {
+                val start = ints[offsetsAt + id]
+                val bytes = ByteArray(ints[offsetsAt + id + 1] - start - 1)
+                chars.position(charsAt + start)
+                chars.get(bytes)
+                s = String(bytes, Charsets.UTF_8)
+                strings[id] = s
+            }
+            return s
+        }
+
+        return Array(sentenceCount) { i ->
+            val s = sentencesAt + i * SENTENCE_INTS
+            val firstToken = ints[s + 4]
+            val tokens = Array(ints[s + 5]) { j ->
+                val t = tokensAt + (firstToken + j) * TOKEN_INTS
+                val depsFirst = ints[t + 13]
+                val depsCount = ints[t + 14]
+                val enhancedHeads = if (depsCount == 0) null else IntArray(depsCount) { ints[depsAt + (depsFirst + it) * DEP_INTS] }
+                val enhancedLabels = if (depsCount == 0) null else Array(depsCount) { str(ints[depsAt + (depsFirst + it) * DEP_INTS + 1])!! }
+                Token(
+                    i, j,
+                    str(ints[t])!!, // word
+                    ints[t + 10], ints[t + 11], // start, end
+                    str(ints[t + 5])!!, // category
+                    str(ints[t + 6])!!, // tag
+                    ints[t + 9], // head
+                    str(ints[t + 7])!!, // label
+                    ints[t + 12], // breaklevel
+                    str(ints[t + 8]), // deps
+                    enhancedHeads,
+                    enhancedLabels,
+                )
+            }
+            Sentence(str(ints[s])!!, ints[s + 2], ints[s + 3], tokens, str(ints[s + 1])!!)
+        }
+    }
+}
@@ -0,0 +1,29 @@
+package org.depparse
+
+/**
+ * Token fields to project parse results on, as a bit mask passed to parse calls.
+ * Fields left out are not converted natively: their strings are empty, their ints -1, deps and tree index null.
+ */
+object Fields {
+
+    const val WORD = 1
+    const val CATEGORY = 2
+    const val TAG = 4 // tag and the fields it is composed of (upostag, xpostag, lemma, feats)
+    const val HEAD = 8
+    const val LABEL = 16
+    const val OFFSETS = 32 // sentence and token offsets
+    const val BREAK_LEVEL = 64
+    const val DEPS = 128 // deps and enhanced dependencies
+    const val TREE = 256 // tree index, implies head and label
+    const val ALL = 511
+
+    /**
+     * Part-of-speech annotation
+     */
+    const val POS = WORD or CATEGORY or TAG or OFFSETS
+
+    /**
+     * Dependency graph
+     */
+    const val GRAPH = WORD or HEAD or LABEL or TREE
+}
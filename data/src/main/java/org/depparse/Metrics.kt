@@ -0,0 +1,156 @@
+package org.depparse
+
+/**
+ * Native metrics of a parser library, decoded from the array returned by metricsSnapshot calls:
+ * [version, calls, failures, sentences, tokens, bytes in, bucket count, parse histogram, convert histogram, total histogram]
+ * each histogram being [count, sum, max, bucket counts...], latencies in microseconds.
+ * Counters only grow since the library was loaded: take the difference of successive snapshots (minus) for rates over a window.
+ *
+ * @property data packed snapshot
+ */
+class Metrics(@JvmField val data: LongArray) {
+
+    /**
+     * Log-linear latency histogram, 8 sub-buckets per power of two of microseconds
+     */
+    inner class Histogram(private val offset: Int) {
+
+        val count: Long
+            get() = data[offset]
+
+        val sumMicros: Long
+            get() = data[offset + 1]
+
+        /**
+         * Maximum since loaded (not windowed by minus)
+         */
+        val maxMicros: Long
+            get() = data[offset + 2]
+
+        val meanMicros: Double
+            get() = if (count == 0L) 0.0 else sumMicros.toDouble() / count
+
+        /**
+         * Value at percentile, as the lowest value of the bucket it falls in, within 12.5%
+         *
+         * @param p percentile in 0..100
+         * @return latency in microseconds, 0 if empty
+         */
+        fun percentile(p: Double): Long {
+            if (count == 0L) {
+                return 0
+            }
+            val rank = maxOf(1L, Math.ceil(p / 100.0 * count).toLong())
+            var seen = 0L
+            for (b in 0 until bucketCount) {
+                seen += data[offset + 3 + b]
+                if (seen >= rank) {
+                    return lowestOf(b)
+                }
+            }
+            return lowestOf(bucketCount - 1)
+        }
+
+        fun toJson(): String {
+            return "{\"count\":$count,\"mean\":${meanMicros.toLong()},\"p50\":${percentile(50.0)},\"p90\":${percentile(90.0)},\"p99\":${percentile(99.0)},\"max\":$maxMicros}"
+        }
+    }
+
+    val version: Long
+        get() = data[0]
+
+    val calls: Long
+        get() = data[1]
+
+    val failures: Long
+        get() = data[2]
+
+    val sentences: Long
+        get() = data[3]
+
+    val tokens: Long
+        get() = data[4]
+
+    val bytesIn: Long
+        get() = data[5]
+
+    private val bucketCount: Int
+        get() = data[6].toInt()
+
+    private val histogramSize: Int
+        get() = 3 + bucketCount
+
+    /**
+     * Backend parse calls, context lease excluded
+     */
+    val parse: Histogram
+        get() = Histogram(HEADER)
+
+    /**
+     * Conversion of backend results
+     */
+    val convert: Histogram
+        get() = Histogram(HEADER + histogramSize)
+
+    /**
+     * JNI calls end-to-end
+     */
+    val total: Histogram
+        get() = Histogram(HEADER + 2 * histogramSize)
+
+    /**
+     * Metrics over the window since previous snapshot
+     *
+     * @param previous earlier snapshot of the same library
+     * @return difference, max values being kept from this snapshot
+     */
+    operator fun minus(previous: Metrics): Metrics {
+        val diff = data.copyOf()
+        for (i in 1 until HEADER - 1) {
+            diff[i] -= previous.data[i]
+        }
+        for (h in 0 until 3) {
+            val offset = HEADER + h * histogramSize
+            for (i in 0 until histogramSize) {
+                if (i != 2) {
+                    diff[offset + i] -= previous.data[offset + i]
+                }
+            }
+        }
+        return Metrics(diff)
+    }
+
+    /**
+     * Tokens per second of end-to-end time
+     */
+    fun tokensPerSecond(): Double {
+        val micros = total.sumMicros
+        return if (micros == 0L) 0.0 else tokens * 1_000_000.0 / micros
+    }
+
+    fun toJson(): String {
+        return "{\"calls\":$calls,\"failures\":$failures,\"sentences\":$sentences,\"tokens\":$tokens,\"bytesIn\":$bytesIn,\"parse\":${parse.toJson()},\"convert\":${convert.toJson()},\"total\":${total.toJson()}}"
+    }
+
+    override fun toString(): String {
+        return toJson()
+    }
+
+    companion object {
+
+        private const val HEADER = 7
+
+        private const val SUB_BUCKETS = 8
+
+        /**
+         * Lowest value of bucket, as in native histogram_t::lowestOf
+         */
+        fun lowestOf(bucket: Int): Long {
+            if (bucket < SUB_BUCKETS) {
+                return bucket.toLong()
+            }
+            val shift = bucket / SUB_BUCKETS - 1
+            return (SUB_BUCKETS + bucket % SUB_BUCKETS).toLong() shl shift
+        }
+    }
+}
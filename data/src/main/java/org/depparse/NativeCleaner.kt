@@ -0,0 +1,60 @@
+package org.depparse
+
+import java.lang.ref.PhantomReference
+import java.lang.ref.ReferenceQueue
+import java.util.Collections
+import java.util.concurrent.atomic.AtomicBoolean
+
+/**
+ * Releases native memory once its Java owner is phantom reachable, after java.lang.ref.Cleaner
+ * (which needs API 33): one daemon thread drains a reference queue and runs the registered actions.
+ * Actions must not reference their owner, else it never becomes unreachable.
+ */
+object NativeCleaner {
+
+    /**
+     * Registered cleaning action, run at most once, either explicitly or when owner is collected
+     */
+    class Cleanable internal constructor(owner: Any, private val action: Runnable) : PhantomReference<Any>(owner, queue) {
+
+        private val done = AtomicBoolean(false)
+
+        fun clean() {
+            if (done.compareAndSet(false, true)) {
+                pending.remove(this)
+                action.run()
+            }
+        }
+    }
+
+    private val queue = ReferenceQueue<Any>()
+
+    // keeps cleanables reachable until they have run
+    private val pending: MutableSet<Cleanable> = Collections.synchronizedSet(HashSet())
+
+    init {
+        val thread = Thread({
+            while (true) {
+                try {
+                    (queue.remove() as Cleanable).clean()
+                } catch (_: InterruptedException) {
+                }
+            }
+        }, "NativeCleaner")
+        thread.isDaemon = true
+        thread.start()
+    }
+
+    /**
+     * Register action to run when owner becomes phantom reachable
+     *
+     * @param owner owner of native memory
+     * @param action releasing action, not referencing owner
+     * @return cleanable, to release early
+     */
+    fun register(owner: Any, action: Runnable): Cleanable {
+        val cleanable = Cleanable(owner, action)
+        pending.add(cleanable)
+        return cleanable
+    }
+}
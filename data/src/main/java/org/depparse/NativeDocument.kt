@@ -0,0 +1,179 @@
+package org.depparse
+
+import java.util.concurrent.locks.ReentrantReadWriteLock
+import kotlin.concurrent.read
+import kotlin.concurrent.write
+
+/**
+ * Parse result left in native storage, sentences being materialized as Sentence/Token objects only when accessed.
+ * For paging through long documents, getSentences() materializes a range without keeping it, so that Java heap use
+ * only depends on the range the viewer holds, whereas get() keeps what it materializes.
+ * Native memory is released on close() or, failing that, once the document is garbage collected.
+ * Native calls in flight hold a read lock that close() waits for, so that storage is never released under them.
+ * The native methods are provided by the parser's JNI library, which must be loaded.
+ *
+ * @param ptr native document, owned by this object
+ */
+class NativeDocument(ptr: Long) : AutoCloseable {
+
+    @Volatile
+    private var ptr: Long = ptr
+
+    private val cleanable = NativeCleaner.register(this, Releaser(ptr))
+
+    private val lock = ReentrantReadWriteLock()
+
+    /**
+     * Number of sentences, no object is materialized
+     */
+    val size: Int = nativeSentenceCount(ptr)
+
+    private val sentences = arrayOfNulls<Sentence>(size)
+
+    /**
+     * Sentence, materialized with its tokens on first access
+     *
+     * @param i sentence index
+     * @return sentence, sentenceIndex of tokens being i
+     */
+    @Synchronized
+    operator fun get(i: Int): Sentence {
+        var sentence = sentences[i]
+        if (sentence == null) {
+            sentence = withOpen { nativeSentence(it, i) }
+            sentences[i] = sentence
+        }
+        return sentence
+    }
+
+    /**
+     * Sentence text, no token is materialized
+     */
+    fun text(i: Int): String {
+        return sentences[i]?.text ?: withOpen { nativeSentenceText(it, i) }
+    }
+
+    /**
+     * Number of tokens in sentence, no token is materialized
+     */
+    fun tokenCount(i: Int): Int {
+        return sentences[i]?.tokens?.size ?: withOpen { nativeTokenCount(it, i) }
+    }
+
+    /**
+     * Number of sentences
+     */
+    fun sentenceCount(): Int = size
+
+    /**
+     * Sentences in range, materialized in one native call and not kept by this document
+     *
+     * @param from first sentence index
+     * @param to sentence index after last
+     * @return sentences, sentenceIndex of tokens being their index in the document
+     */
+    fun getSentences(from: Int, to: Int): Array<Sentence> {
+        require(from in 0..to && to <= size) { "Bad range [$from, $to) of $size sentences" }
+        return withOpen { nativeSentences(it, from, to) }
+    }
+
+    /**
+     * Char offset of sentence in document text, document text being sentence texts each followed by one separator char
+     *
+     * @param i sentence index, size for document text length
+     */
+    fun textOffset(i: Int): Int {
+        require(i in 0..size) { "Bad sentence index $i of $size sentences" }
+        return withOpen { nativeTextOffset(it, i) }
+    }
+
+    /**
+     * Sentence at char offset in document text (see textOffset)
+     *
+     * @param charOffset char offset in document text
+     * @return sentence index, -1 if offset is out of document text
+     */
+    fun findSentenceAt(charOffset: Int): Int = withOpen { nativeFindSentenceAt(it, charOffset) }
+
+    /**
+     * Predicate-subject-object analysis, run natively on the parse result, no sentence is materialized
+     *
+     * @param labels labels of each class: predicate, subject, object, term modifier, predicate modifier
+     * @param threads number of threads sentences are shared between, 1 to analyze on the calling thread
+     * @return relations
+     */
+    fun semantics(labels: Array<Array<String>>, threads: Int = 1): SemanticTuples {
+        return SemanticTuples(withOpen { nativeSemantics(it, labels, threads) })
+    }
+
+    /**
+     * Structural query, run natively on the parse result, no sentence is materialized
+     *
+     * @param pattern query pattern, see org.depparse.QueryMatches
+     * @param maxMatches maximum number of matches, unlimited if <= 0
+     * @return matches
+     */
+    @Throws(IllegalArgumentException::class)
+    fun query(pattern: String, maxMatches: Int = 0): QueryMatches {
+        return QueryMatches(withOpen { nativeQuery(it, pattern, maxMatches) })
+    }
+
+    /**
+     * Materialize all sentences
+     */
+    fun toArray(): Array<Sentence> = Array(size) { get(it) }
+
+    /**
+     * Release native storage once native calls in flight are done, sentences already materialized remain valid
+     */
+    override fun close() {
+        lock.write {
+            ptr = 0
+            cleanable.clean()
+        }
+    }
+
+    /**
+     * Run native call on open document, close() waiting for it to return
+     */
+    private inline fun <T> withOpen(call: (Long) -> T): T {
+        lock.read {
+            val p = ptr
+            check(p != 0L) { "Native document is closed" }
+            return call(p)
+        }
+    }
+
+    // instance methods so that this document stays reachable for the duration of the native call
+
+    private external fun nativeSentenceCount(ptr: Long): Int
+
+    private external fun nativeTokenCount(ptr: Long, i: Int): Int
+
+    private external fun nativeSentenceText(ptr: Long, i: Int): String
+
+    private external fun nativeSentence(ptr: Long, i: Int): Sentence
+
+    private external fun nativeSentences(ptr: Long, from: Int, to: Int): Array<Sentence>
+
+    private external fun nativeTextOffset(ptr: Long, i: Int): Int
+
+    private external fun nativeFindSentenceAt(ptr: Long, charOffset: Int): Int
+
+    private external fun nativeSemantics(ptr: Long, labels: Array<Array<String>>, threads: Int): IntArray
+
+    private external fun nativeQuery(ptr: Long, pattern: String, maxMatches: Int): IntArray
+
+    private class Releaser(private val ptr: Long) : Runnable {
+
+        override fun run() {
+            release(ptr)
+        }
+    }
+
+    companion object {
+
+        @JvmStatic
+        private external fun release(ptr: Long)
+    }
+}
@@ -0,0 +1,66 @@
+package org.depparse
+
+import java.io.File
+
+/**
+ * Persistent parse cache, entries keyed by model identity and input texts being kept as memory-mappable files
+ * that are served in place as NativeDocument objects, least recently used ones being evicted above the size bound.
+ * The native methods are provided by the parser's JNI library, which must be loaded.
+ *
+ * @param dir cache directory, e.g. under Storage.getAppStorage()
+ * @param maxBytes size bound, unbounded if 0
+ */
+class ParseCache(dir: File, maxBytes: Long) : AutoCloseable {
+
+    @Volatile
+    private var ptr: Long = open(dir.absolutePath, maxBytes)
+
+    private val cleanable = NativeCleaner.register(this, Releaser(ptr))
+
+    /**
+     * Native cache, to be handed to cached parse calls
+     */
+    val handle: Long
+        get() {
+            val p = ptr
+            check(p != 0L) { "Parse cache is closed" }
+            return p
+        }
+
+    /**
+     * Remove all entries
+     */
+    fun clear() {
+        clear(handle)
+    }
+
+    /**
+     * Release native cache, cached parse calls in flight finishing with it, entries staying on disk
+     */
+    @Synchronized
+    override fun close() {
+        ptr = 0
+        cleanable.clean()
+    }
+
+    private class Releaser(private val ptr: Long) : Runnable {
+
+        override fun run() {
+            release(ptr)
+        }
+    }
+
+    companion object {
+
+        const val DIR = "parse_cache"
+
+        @JvmStatic
+        private external fun open(dir: String, maxBytes: Long): Long
+
+        @JvmStatic
+        private external fun clear(ptr: Long)
+
+        @JvmStatic
+        private external fun release(ptr: Long)
+    }
+}
@@ -0,0 +1,15 @@
+package org.depparse
+
+/**
+ * Native preprocessing of input texts ahead of parse, as a bit mask set per handle.
+ * Texts are validated, normalized and hashed in one pass, the hash keying the parse cache.
+ * Repair keeps char offsets into the input text; whitespace normalization makes offsets refer to the normalized text.
+ */
+object Preprocessing {
+
+    const val NONE = 0
+    const val REPAIR = 1 // invalid UTF-8 and lone surrogates to U+FFFD, U+0000 to space
+    const val WHITESPACE = 2 // Unicode spaces, tabs and line breaks to space, runs collapsed, trimmed
+    const val QUOTES = 4 // typographic quotes and primes to ' and "
+    const val DEFAULT = REPAIR
+}
@@ -0,0 +1,43 @@
+package org.depparse
+
+/**
+ * Matches of a native structural query, decoded from a single packed array:
+ * [width, sentence index, token matching node 0, token matching node 1, ..., sentence index, ...]
+ * Each match spans width ints, token indices are 0-based in their sentence, nodes are in pattern order.
+ *
+ * Pattern syntax (Semgrex-like):
+ * {upos:VERB} >nsubj {} >obj ({} >amod {lemma:big|large})
+ * relations: > child, < head, >> descendant, << ancestor
+ * attributes: word, lemma, upos, xpos, category, tag, label, values ending with '*' match as prefix, '!' negates
+ *
+ * @property data packed matches
+ */
+class QueryMatches(@JvmField val data: IntArray) {
+
+    private val width: Int
+        get() = data[0]
+
+    /**
+     * Number of pattern nodes
+     */
+    val nodeCount: Int
+        get() = width - 1
+
+    val size: Int
+        get() = (data.size - 1) / width
+
+    /**
+     * Sentence index of m-th match
+     */
+    fun sentence(m: Int): Int = data[1 + m * width]
+
+    /**
+     * Token matching node k in m-th match
+     */
+    fun token(m: Int, k: Int): Int = data[2 + m * width + k]
+
+    /**
+     * Tokens of m-th match, in pattern node order
+     */
+    fun tokens(m: Int): IntArray = data.copyOfRange(2 + m * width, 1 + (m + 1) * width)
+}
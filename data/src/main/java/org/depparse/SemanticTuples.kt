@@ -0,0 +1,59 @@
+package org.depparse
+
+/**
+ * Relations of a native predicate-subject-object analysis, decoded from a single packed array:
+ * [sentence index, predicate token, role, argument token, sentence index, ...]
+ * Token indices are 0-based in their sentence, relations are in analysis order, sentence by sentence.
+ *
+ * @property data packed relations
+ */
+class SemanticTuples(@JvmField val data: IntArray) {
+
+    val size: Int
+        get() = data.size / WIDTH
+
+    /**
+     * Sentence index of r-th relation
+     */
+    fun sentence(r: Int): Int = data[r * WIDTH]
+
+    /**
+     * Predicate token of r-th relation
+     */
+    fun predicate(r: Int): Int = data[r * WIDTH + 1]
+
+    /**
+     * Role of r-th relation, one of ROLE_*
+     */
+    fun role(r: Int): Int = data[r * WIDTH + 2]
+
+    /**
+     * Argument token of r-th relation
+     */
+    fun argument(r: Int): Int = data[r * WIDTH + 3]
+
+    companion object {
+
+        private const val WIDTH = 4
+
+        /**
+         * Argument is subject of predicate
+         */
+        const val ROLE_SUBJECT = 0
+
+        /**
+         * Argument is object of predicate
+         */
+        const val ROLE_OBJECT = 1
+
+        /**
+         * Argument is predicate governed by predicate
+         */
+        const val ROLE_PREDICATE = 2
+
+        /**
+         * Predicate modifies argument term
+         */
+        const val ROLE_TERM = 3
+    }
+}
@@ -1,11 +1,12 @@
 package org.depparse
 
-data class Sentence(
+data class Sentence @JvmOverloads constructor(
     @JvmField val text: String, // not null, possibly empty
     @JvmField val start: Int, // possibly -1
     @JvmField val end: Int, // possibly -1, inclusive
     @JvmField val tokens: Array<Token>, // not null, possibly empty
     @JvmField val docid: String, // not null, possibly empty
+    @JvmField val tree: TreeIndex? = null, // natively computed tree index, null if not computed
 ) {
 
     override fun equals(other: Any?): Boolean {
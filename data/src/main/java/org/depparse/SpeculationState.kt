@@ -0,0 +1,56 @@
+package org.depparse
+
+/**
+ * State of native speculative parsing, decoded from the array returned by speculationState calls.
+ * Texts likely to be asked for next are parsed ahead on idle time, results being parked until a parse call takes them.
+ *
+ * @property data packed state
+ */
+class SpeculationState(@JvmField val data: LongArray) {
+
+    /**
+     * Texts waiting to be parsed ahead
+     */
+    val queued: Long
+        get() = data[0]
+
+    /**
+     * Results parked, not taken yet
+     */
+    val parked: Long
+        get() = data[1]
+
+    /**
+     * Bytes of parked results
+     */
+    val parkedBytes: Long
+        get() = data[2]
+
+    /**
+     * Texts parsed ahead
+     */
+    val parsed: Long
+        get() = data[3]
+
+    /**
+     * Parked results taken by parse calls
+     */
+    val hits: Long
+        get() = data[4]
+
+    /**
+     * Parked results evicted unused, over budget or parsed by a replaced model
+     */
+    val evicted: Long
+        get() = data[5]
+
+    /**
+     * Texts dropped unparsed, or parsed while a clear came in
+     */
+    val dropped: Long
+        get() = data[6]
+
+    override fun toString(): String {
+        return "queued=$queued parked=$parked (${parkedBytes}B) parsed=$parsed hits=$hits evicted=$evicted dropped=$dropped"
+    }
+}
@@ -4,7 +4,7 @@ import java.io.IOException
 import java.util.Locale
 import java.util.regex.Pattern
 
-open class Token(
+open class Token @JvmOverloads constructor(
     @JvmField val sentenceIndex: Int, // possibly -1
     @JvmField val index: Int, // possibly -1
     @JvmField val word: String, // not null
@@ -16,6 +16,8 @@ open class Token(
     @JvmField val label: String, // not null, possibly empty
     @JvmField val breakLevel: Int, // possibly -1
     @JvmField val deps: String?, // not null, possibly empty
+    @JvmField val enhancedHeads: IntArray? = null, // natively parsed deps heads, 0-based, -1 for root, null if none or not parsed
+    @JvmField val enhancedLabels: Array<String>? = null, // natively parsed deps labels, parallel to enhancedHeads
 ) : Label, HasSegment, HasIndex {
 
     override val ith: Int
@@ -59,21 +61,43 @@ open class Token(
     }
 
     object TokenEnhancedDepsProcessor {
+        /**
+         * Enhanced dependencies of token, as parsed natively if available, from DEPS string otherwise
+         *
+         * @param token token
+         * @return list of (label, head) pairs, head being 0-based, -1 for root
+         */
+        fun parse(token: Token): List<Pair<String, Int>> {
+            val heads = token.enhancedHeads
+            val labels = token.enhancedLabels
+            if (heads != null && labels != null) {
+                return List(heads.size) { labels[it] to heads[it] }
+            }
+            return parse(token.deps ?: return emptyList())
+        }
+
         /**
          * Parse DEPS string
          *
          * @param input input
-         * @return list of (label, head) pairs
+         * @return list of (label, head) pairs, head being 0-based, -1 for root
          */
         fun parse(input: String): List<Pair<String, Int>> {
-            return input
-                .trim()
+            val deps = input.trim()
+            if (deps.isEmpty() || deps == "_") {
+                return emptyList()
+            }
+            return deps
                 .split("|")
-                .map {
-                    val (head, label) = it.split(":")
-                    label to head.toInt()
+                .mapNotNull {
+                    val colon = it.indexOf(':')
+                    if (colon == -1) {
+                        null
+                    } else {
+                        val head = it.substring(0, colon).substringBefore('.').toIntOrNull()
+                        if (head == null) null else it.substring(colon + 1) to head - 1
+                    }
                 }
-                .toList()
         }
     }
 
@@ -0,0 +1,96 @@
+package org.depparse
+
+/**
+ * Dependency tree index of a sentence, computed natively at conversion time.
+ * All queries are O(1) lookups into a single packed array:
+ * [flags, size, root count, roots..., child offsets (size + 1)..., children..., parents (size)..., depths (size)..., span starts (size)..., span ends (size)...]
+ *
+ * @property data packed index
+ */
+class TreeIndex(@JvmField val data: IntArray) {
+
+    val flags: Int
+        get() = data[0]
+
+    val size: Int
+        get() = data[1]
+
+    private val rootCount: Int
+        get() = data[2]
+
+    private val rootsOffset = 3
+    private val childOffsetsOffset = rootsOffset + data[2]
+    private val childrenOffset = childOffsetsOffset + data[1] + 1
+    private val parentsOffset = childrenOffset + data[childOffsetsOffset + data[1]]
+    private val depthsOffset = parentsOffset + data[1]
+    private val spanStartsOffset = depthsOffset + data[1]
+    private val spanEndsOffset = spanStartsOffset + data[1]
+
+    val hasCycle: Boolean
+        get() = flags and HAS_CYCLE != 0
+
+    val isProjective: Boolean
+        get() = flags and NON_PROJECTIVE == 0
+
+    val hasMultipleRoots: Boolean
+        get() = flags and MULTIPLE_ROOTS != 0
+
+    /**
+     * Root token indices
+     */
+    fun roots(): IntArray = data.copyOfRange(rootsOffset, rootsOffset + rootCount)
+
+    /**
+     * Tree head of token, -1 for roots
+     */
+    fun parent(i: Int): Int = data[parentsOffset + i]
+
+    fun childCount(i: Int): Int = data[childOffsetsOffset + i + 1] - data[childOffsetsOffset + i]
+
+    /**
+     * k-th child of token, children being in token order
+     */
+    fun child(i: Int, k: Int): Int = data[childrenOffset + data[childOffsetsOffset + i] + k]
+
+    fun children(i: Int): IntArray = data.copyOfRange(childrenOffset + data[childOffsetsOffset + i], childrenOffset + data[childOffsetsOffset + i + 1])
+
+    /**
+     * Depth of token, 0 for roots, -1 for tokens that do not reach a root
+     */
+    fun depth(i: Int): Int = data[depthsOffset + i]
+
+    /**
+     * First token of subtree rooted at token
+     */
+    fun spanStart(i: Int): Int = data[spanStartsOffset + i]
+
+    /**
+     * Last token (inclusive) of subtree rooted at token
+     */
+    fun spanEnd(i: Int): Int = data[spanEndsOffset + i]
+
+    /**
+     * Whether ancestor dominates descendant (or is descendant)
+     */
+    fun dominates(ancestor: Int, descendant: Int): Boolean {
+        if (descendant < spanStart(ancestor) || descendant > spanEnd(ancestor)) {
+            return false
+        }
+        if (isProjective) {
+            return true
+        }
+        val d = depth(ancestor)
+        var i = descendant
+        while (i != -1 && depth(i) > d) {
+            i = parent(i)
+        }
+        return i == ancestor
+    }
+
+    companion object {
+
+        const val HAS_CYCLE = 1
+        const val NON_PROJECTIVE = 2
+        const val MULTIPLE_ROOTS = 4
+    }
+}
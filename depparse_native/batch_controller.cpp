@@ -0,0 +1,69 @@
+/* Copyright 2018
+ * Bernard Bou
+ * 1313ou@gmail.com */
+
+#include <algorithm>
+
+#include "depparse_native/batch_controller.h"
+
+using namespace std;
+
+static const int64_t kDefaultTargetNanos = 50LL * 1000 * 1000;   // 50 ms
+static const double kInitialNanosPerByte = 20000.0;               // conservative until measured
+static const double kSmoothing = 0.25;                            // weight of last batch in moving averages
+static const size_t kMinBudget = 256;                             // bytes
+static const size_t kMaxBudget = 4 * 1024 * 1024;                 // bytes
+
+batch_controller_t::batch_controller_t() : target_nanos(kDefaultTargetNanos), nanos_per_byte(kInitialNanosPerByte), nanos_per_token(0) {
+}
+
+size_t batch_controller_t::budget() const {
+    auto bytes = static_cast<size_t>(static_cast<double>(target_nanos) / nanos_per_byte);
+    return min(max(bytes, kMinBudget), kMaxBudget);
+}
+
+size_t batch_controller_t::next(const vector<string> &texts, size_t from) {
+    size_t bytes;
+    {
+        lock_guard<mutex> lock(m);
+        bytes = budget();
+    }
+    size_t to = from;
+    size_t size = 0;
+    while (to < texts.size() && (to == from || size + texts[to].size() <= bytes)) {
+        size += texts[to].size();
+        to++;
+    }
+    return to;
+}
+
+void batch_controller_t::observe(size_t texts, size_t bytes, size_t tokens, int64_t nanos) {
+    lock_guard<mutex> lock(m);
+    if (bytes > 0) {
+        double per_byte = static_cast<double>(nanos) / static_cast<double>(bytes);
+        nanos_per_byte = count == 0 ? per_byte : nanos_per_byte + kSmoothing * (per_byte - nanos_per_byte);
+    }
+    if (tokens > 0) {
+        double per_token = static_cast<double>(nanos) / static_cast<double>(tokens);
+        nanos_per_token = nanos_per_token == 0 ? per_token : nanos_per_token + kSmoothing * (per_token - nanos_per_token);
+    }
+    count++;
+    last_texts = static_cast<int64_t>(texts);
+    last_nanos = nanos;
+}
+
+void batch_controller_t::setTarget(int64_t nanos) {
+    lock_guard<mutex> lock(m);
+    target_nanos = max(nanos, static_cast<int64_t>(1000000));
+}
+
+void batch_controller_t::snapshot(int64_t *state) {
+    lock_guard<mutex> lock(m);
+    state[kBatchTargetNanos] = target_nanos;
+    state[kBatchNanosPerKByte] = static_cast<int64_t>(nanos_per_byte * 1024);
+    state[kBatchNanosPerToken] = static_cast<int64_t>(nanos_per_token);
+    state[kBatchBytes] = static_cast<int64_t>(budget());
+    state[kBatchCount] = count;
+    state[kBatchLastTexts] = last_texts;
+    state[kBatchLastNanos] = last_nanos;
+}
@@ -0,0 +1,79 @@
+/* Copyright 2018
+ * Bernard Bou
+ * 1313ou@gmail.com */
+
+#ifndef DEPPARSE_BATCH_CONTROLLER_H
+#define DEPPARSE_BATCH_CONTROLLER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <mutex>
+
+// feedback controller sizing parse batches so that each batch (parse and conversion) takes about the target latency.
+// Cost is tracked per input byte, known before parsing, as a moving average of observed batches;
+// cost per token is tracked for reporting.
+
+/**
+ * Controller state, as handed to Java
+ */
+enum batch_state_t {
+    kBatchTargetNanos,      // target latency per batch
+    kBatchNanosPerKByte,    // estimated cost per input KiB
+    kBatchNanosPerToken,    // observed cost per token
+    kBatchBytes,            // current batch size in input bytes
+    kBatchCount,            // number of batches observed
+    kBatchLastTexts,        // number of texts in last batch
+    kBatchLastNanos,        // latency of last batch
+    kBatchStateSize,
+};
+
+class batch_controller_t {
+public:
+    batch_controller_t();
+
+    /**
+     * End of next batch
+     *
+     * @param texts input texts
+     * @param from start of batch
+     * @return end of batch (exclusive), at least one text past from
+     */
+    size_t next(const std::vector<std::string> &texts, size_t from);
+
+    /**
+     * Feed back observed batch
+     *
+     * @param texts number of texts in batch
+     * @param bytes input bytes in batch
+     * @param tokens tokens in batch
+     * @param nanos latency of batch
+     */
+    void observe(size_t texts, size_t bytes, size_t tokens, int64_t nanos);
+
+    /**
+     * Set target latency per batch
+     */
+    void setTarget(int64_t nanos);
+
+    /**
+     * Copy state
+     *
+     * @param state kBatchStateSize values
+     */
+    void snapshot(int64_t *state);
+
+private:
+    size_t budget() const;
+
+    std::mutex m;
+    int64_t target_nanos;
+    double nanos_per_byte;
+    double nanos_per_token;
+    int64_t count = 0;
+    int64_t last_texts = 0;
+    int64_t last_nanos = 0;
+};
+
+#endif
@@ -0,0 +1,179 @@
+/* Copyright 2018
+ * Bernard Bou
+ * 1313ou@gmail.com */
+
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include "depparse_native/binary.h"
+
+using namespace std;
+
+static_assert(sizeof(doc_sentence_t) == 6 * sizeof(int32_t), "sentence record is not packed");
+static_assert(sizeof(doc_token_t) == 15 * sizeof(int32_t), "token record is not packed");
+static_assert(sizeof(doc_dep_t) == 2 * sizeof(int32_t), "dep record is not packed");
+
+// not in older bionic headers
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#define MFD_ALLOW_SEALING 0x0002U
+#endif
+#ifndef F_ADD_SEALS
+#define F_ADD_SEALS 1033
+#define F_SEAL_SHRINK 0x0002
+#define F_SEAL_GROW 0x0004
+#define F_SEAL_WRITE 0x0008
+#endif
+
+// L A Y O U T
+
+static inline size_t align4(size_t n) {
+    return (n + 3) & ~static_cast<size_t>(3);
+}
+
+size_t
+binarySize(const document_view_t &doc) {
+    return kBinaryHeaderSize
+           + doc.sentence_count * sizeof(doc_sentence_t)
+           + doc.token_count * sizeof(doc_token_t)
+           + doc.dep_count * sizeof(doc_dep_t)
+           + (doc.string_count + 1) * sizeof(uint32_t)
+           + align4(doc.offsets[doc.string_count]);
+}
+
+void
+writeBinary(const document_view_t &doc, char *out) {
+    uint32_t chars_size = doc.offsets[doc.string_count];
+    const uint32_t header[8] = {
+            kBinaryMagic,
+            kBinaryVersion,
+            static_cast<uint32_t>(doc.sentence_count),
+            static_cast<uint32_t>(doc.token_count),
+            static_cast<uint32_t>(doc.dep_count),
+            static_cast<uint32_t>(doc.string_count),
+            chars_size,
+            0,
+    };
+    memcpy(out, header, sizeof(header));
+    out += sizeof(header);
+    memcpy(out, doc.sentences, doc.sentence_count * sizeof(doc_sentence_t));
+    out += doc.sentence_count * sizeof(doc_sentence_t);
+    memcpy(out, doc.tokens, doc.token_count * sizeof(doc_token_t));
+    out += doc.token_count * sizeof(doc_token_t);
+    memcpy(out, doc.deps, doc.dep_count * sizeof(doc_dep_t));
+    out += doc.dep_count * sizeof(doc_dep_t);
+    memcpy(out, doc.offsets, (doc.string_count + 1) * sizeof(uint32_t));
+    out += (doc.string_count + 1) * sizeof(uint32_t);
+    memcpy(out, doc.chars, chars_size);
+    memset(out + chars_size, 0, align4(chars_size) - chars_size);
+}
+
+bool
+readBinary(const char *data, size_t size, document_view_t &doc) {
+    if (size < kBinaryHeaderSize || reinterpret_cast<uintptr_t>(data) % 4 != 0) {
+        return false;
+    }
+    uint32_t header[8];
+    memcpy(header, data, sizeof(header));
+    if (header[0] != kBinaryMagic || header[1] != kBinaryVersion) {
+        return false;
+    }
+    doc.sentence_count = static_cast<int32_t>(header[2]);
+    doc.token_count = static_cast<int32_t>(header[3]);
+    doc.dep_count = static_cast<int32_t>(header[4]);
+    doc.string_count = static_cast<int32_t>(header[5]);
+    uint32_t chars_size = header[6];
+    if (doc.sentence_count < 0 || doc.token_count < 0 || doc.dep_count < 0 || doc.string_count < 1) {
+        return false;
+    }
+
+    // sections, computed in 64 bits against overflow
+    uint64_t offset = kBinaryHeaderSize;
+    uint64_t sentences = offset;
+    offset += static_cast<uint64_t>(doc.sentence_count) * sizeof(doc_sentence_t);
+    uint64_t tokens = offset;
+    offset += static_cast<uint64_t>(doc.token_count) * sizeof(doc_token_t);
+    uint64_t deps = offset;
+    offset += static_cast<uint64_t>(doc.dep_count) * sizeof(doc_dep_t);
+    uint64_t offsets = offset;
+    offset += (static_cast<uint64_t>(doc.string_count) + 1) * sizeof(uint32_t);
+    uint64_t chars = offset;
+    offset += chars_size;
+    if (offset > size) {
+        return false;
+    }
+    doc.sentences = reinterpret_cast<const doc_sentence_t *>(data + sentences);
+    doc.tokens = reinterpret_cast<const doc_token_t *>(data + tokens);
+    doc.deps = reinterpret_cast<const doc_dep_t *>(data + deps);
+    doc.offsets = reinterpret_cast<const uint32_t *>(data + offsets);
+    doc.chars = data + chars;
+
+    // string table and record ranges, so that readers need no further checks
+    if (chars_size == 0 || doc.offsets[0] != 0 || doc.offsets[doc.string_count] != chars_size || doc.chars[chars_size - 1] != '\0') {
+        return false;
+    }
+    for (int32_t i = 0; i < doc.string_count; i++) {
+        if (doc.offsets[i + 1] <= doc.offsets[i] || doc.chars[doc.offsets[i + 1] - 1] != '\0')
+            return false;
+    }
+    for (int32_t s = 0; s < doc.sentence_count; s++) {
+        const doc_sentence_t &sentence = doc.sentences[s];
+        if (sentence.first_token < 0 || sentence.token_count < 0 || sentence.first_token > doc.token_count - sentence.token_count)
+            return false;
+        if (sentence.text < 0 || sentence.text >= doc.string_count || sentence.docid < 0 || sentence.docid >= doc.string_count)
+            return false;
+    }
+    for (int32_t t = 0; t < doc.token_count; t++) {
+        const doc_token_t &token = doc.tokens[t];
+        const int32_t ids[] = {token.word, token.lemma, token.upostag, token.xpostag, token.feats, token.category, token.tag, token.label};
+        for (int32_t id: ids) {
+            if (id < 0 || id >= doc.string_count)
+                return false;
+        }
+        if (token.deps < kNullString || token.deps >= doc.string_count)
+            return false;
+        if (token.deps_first < 0 || token.deps_count < 0 || token.deps_first > doc.dep_count - token.deps_count)
+            return false;
+    }
+    for (int32_t d = 0; d < doc.dep_count; d++) {
+        if (doc.deps[d].label < 0 || doc.deps[d].label >= doc.string_count)
+            return false;
+    }
+    return true;
+}
+
+// S H A R E D   M E M O R Y
+
+int
+writeBinaryToSharedMemory(const document_view_t &doc, const char *name) {
+#ifdef __NR_memfd_create
+    int fd = static_cast<int>(syscall(__NR_memfd_create, name, MFD_CLOEXEC | MFD_ALLOW_SEALING));
+#else
+    (void) name;
+    errno = ENOSYS;
+    int fd = -1;
+#endif
+    if (fd < 0) {
+        return -1;
+    }
+    size_t size = binarySize(doc);
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        close(fd);
+        return -1;
+    }
+    void *data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        close(fd);
+        return -1;
+    }
+    writeBinary(doc, static_cast<char *>(data));
+    munmap(data, size);
+
+    // readers get an immutable region, sealing is best effort (kernels before 3.17 have no memfd at all)
+    fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE);
+    return fd;
+}
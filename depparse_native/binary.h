@@ -0,0 +1,64 @@
+/* Copyright 2018
+ * Bernard Bou
+ * 1313ou@gmail.com */
+
+#ifndef DEPPARSE_BINARY_H
+#define DEPPARSE_BINARY_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "depparse_native/document.h"
+
+// binary layout of documents, readable in place (mapped shared memory, files):
+//
+// header   8 x int32: magic, version, sentence count, token count, dep count, string count, chars size, reserved
+// sentences  sentence count x 6 int32 (doc_sentence_t)
+// tokens     token count x 15 int32 (doc_token_t)
+// deps       dep count x 2 int32 (doc_dep_t)
+// offsets    (string count + 1) x uint32
+// chars      chars size bytes, NUL-terminated UTF-8 strings
+//
+// Integers are in native byte order.
+
+const uint32_t kBinaryMagic = 0x31425044; // "DPB1"
+const uint32_t kBinaryVersion = 1;
+const size_t kBinaryHeaderSize = 8 * sizeof(int32_t);
+
+/**
+ * Size of binary layout of document
+ */
+size_t
+binarySize(const document_view_t &doc);
+
+/**
+ * Write binary layout of document
+ *
+ * @param doc document
+ * @param out output buffer of binarySize(doc) bytes, 4-byte aligned
+ */
+void
+writeBinary(const document_view_t &doc, char *out);
+
+/**
+ * View document in binary layout, no copy is made
+ *
+ * @param data binary layout, 4-byte aligned, to outlive the view
+ * @param size size of data
+ * @param doc view to fill
+ * @return false if data is not a well-formed binary layout
+ */
+bool
+readBinary(const char *data, size_t size, document_view_t &doc);
+
+/**
+ * Write binary layout of document to a new sealed, read-only shared memory file (memfd)
+ *
+ * @param doc document
+ * @param name debugging name of shared memory
+ * @return file descriptor, or -1 if shared memory is not available (errno is set)
+ */
+int
+writeBinaryToSharedMemory(const document_view_t &doc, const char *name);
+
+#endif
@@ -0,0 +1,72 @@
+/* Copyright 2018
+ * Bernard Bou
+ * 1313ou@gmail.com */
+
+#include "depparse_native/char_indices.h"
+
+using namespace std;
+
+// T O   C H A R   I N D E X   H E L P E R
+
+/**
+ * Number of bytes in the UTF-8 sequence introduced by this lead byte.
+ * Stray continuation bytes and invalid lead bytes count as one char.
+ */
+static inline size_t sequenceLength(unsigned char lead) {
+    if (lead < 0xC0)
+        return 1;
+    if (lead < 0xE0)
+        return 2;
+    if (lead < 0xF0)
+        return 3;
+    if (lead < 0xF8)
+        return 4;
+    return 1;
+}
+
+/**
+ * Number of Java (UTF-16) chars of a UTF-8 sequence: supplementary chars, the only ones with 4-byte sequences, take two.
+ */
+static inline int charUnits(size_t sequenceLength) {
+    return sequenceLength == 4 ? 2 : 1;
+}
+
+void getCharIndices(const string &text, vector<int> &byteToCharIndex) {
+    // Get the byte size of the UTF-8 string
+    size_t byteSize = text.size();
+
+    // Size + 1 to include position after last byte
+    byteToCharIndex.resize(byteSize + 1);
+
+    // Walk the UTF-8 sequences directly, no intermediate wide string
+    const auto *bytes = reinterpret_cast<const unsigned char *>(text.data());
+    int charIndex = 0;
+    size_t bytePos = 0;
+    while (bytePos < byteSize) {
+        size_t charByteCount = sequenceLength(bytes[bytePos]);
+        if (bytePos + charByteCount > byteSize)
+            charByteCount = byteSize - bytePos;
+
+        // Fill in the byte-to-char mapping for each byte in this character
+        for (size_t j = 0; j < charByteCount; ++j) {
+            byteToCharIndex[bytePos + j] = charIndex;
+        }
+        bytePos += charByteCount;
+        charIndex += charUnits(charByteCount);
+    }
+
+    // Set the final position
+    byteToCharIndex[byteSize] = charIndex;
+}
+
+int charCount(const char *text, size_t byteSize) {
+    const auto *bytes = reinterpret_cast<const unsigned char *>(text);
+    int charIndex = 0;
+    size_t bytePos = 0;
+    while (bytePos < byteSize) {
+        size_t charByteCount = sequenceLength(bytes[bytePos]);
+        bytePos += charByteCount;
+        charIndex += charUnits(charByteCount);
+    }
+    return charIndex;
+}
@@ -0,0 +1,42 @@
+/* Copyright 2018
+ * Bernard Bou
+ * 1313ou@gmail.com */
+
+#ifndef DEPPARSE_CHAR_INDICES_H
+#define DEPPARSE_CHAR_INDICES_H
+
+#include <string>
+#include <vector>
+
+/**
+ * Creates a mapping from UTF-8 byte positions to character indices, chars being Java (UTF-16) chars:
+ * a supplementary char, the only one with a 4-byte sequence, takes two indices.
+ *
+ * @param text The UTF-8 encoded string to process
+ * @param byteToCharIndex A vector where each index represents a byte position, and the value is the corresponding character index
+ */
+void getCharIndices(const std::string &text, std::vector<int> &byteToCharIndex);
+
+/**
+ * Number of chars in UTF-8 text, counted as getCharIndices does
+ *
+ * @param text UTF-8 text
+ * @param byteSize byte size of text
+ * @return char count
+ */
+int charCount(const char *text, size_t byteSize);
+
+/**
+ * Map byte position to char index
+ *
+ * @param byteToCharIndex mapping
+ * @param bytePos byte position, possibly -1
+ * @return char index or -1 if byte position is -1 or out of range
+ */
+inline int toCharIndex(const std::vector<int> &byteToCharIndex, int bytePos) {
+    if (bytePos < 0 || bytePos >= static_cast<int>(byteToCharIndex.size()))
+        return -1;
+    return byteToCharIndex[bytePos];
+}
+
+#endif
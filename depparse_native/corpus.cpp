@@ -0,0 +1,108 @@
+/* Copyright 2018
+ * Bernard Bou
+ * 1313ou@gmail.com */
+
+#include <cstdlib>
+
+#include "depparse_native/corpus.h"
+
+using namespace std;
+
+static const string kTextComment = "# text = ";
+
+// S P L I T
+
+static void splitFields(const string &line, vector<string> &fields) {
+    fields.clear();
+    string::size_type i = 0;
+    while (true) {
+        string::size_type j = line.find('\t', i);
+        if (j == string::npos) {
+            fields.push_back(line.substr(i));
+            return;
+        }
+        fields.push_back(line.substr(i, j - i));
+        i = j + 1;
+    }
+}
+
+// O F F S E T S
+
+/**
+ * Text out of forms when there is no text comment, and offsets of forms in text
+ */
+static void locate(corpus_sentence_t &sentence, const vector<bool> &space_after) {
+    if (sentence.text.empty()) {
+        for (size_t k = 0; k < sentence.tokens.size(); k++) {
+            sentence.text += sentence.tokens[k].form;
+            if (space_after[k] && k + 1 < sentence.tokens.size())
+                sentence.text += ' ';
+        }
+    }
+    string::size_type from = 0;
+    for (auto &token: sentence.tokens) {
+        string::size_type at = sentence.text.find(token.form, from);
+        if (at == string::npos || token.form.empty()) {
+            // form does not show as is (e.g. syntactic word of a contraction): empty span at cursor
+            token.start = static_cast<int>(from);
+            token.end = static_cast<int>(from);
+            continue;
+        }
+        token.start = static_cast<int>(at);
+        token.end = static_cast<int>(at + token.form.size());
+        from = at + token.form.size();
+    }
+}
+
+// R E A D
+
+size_t
+readConllu(istream &in, vector<corpus_sentence_t> &sentences) {
+    size_t count = 0;
+    corpus_sentence_t sentence;
+    vector<bool> space_after;
+    vector<string> fields;
+    string line;
+    bool more = true;
+    while (more) {
+        more = static_cast<bool>(getline(in, line));
+        if (more && !line.empty() && line.back() == '\r')
+            line.pop_back();
+
+        // end of sentence
+        if (!more || line.empty()) {
+            if (!sentence.tokens.empty()) {
+                locate(sentence, space_after);
+                sentences.push_back(std::move(sentence));
+                count++;
+            }
+            sentence = corpus_sentence_t();
+            space_after.clear();
+            continue;
+        }
+
+        // comment
+        if (line[0] == '#') {
+            if (line.compare(0, kTextComment.size(), kTextComment) == 0)
+                sentence.text = line.substr(kTextComment.size());
+            continue;
+        }
+
+        // token line, multiword ranges (1-2) and empty nodes (1.1) skipped
+        splitFields(line, fields);
+        if (fields.size() < 10 || fields[0].find_first_of("-.") != string::npos)
+            continue;
+        corpus_token_t token;
+        token.form = fields[1];
+        token.lemma = fields[2] == "_" ? "" : fields[2];
+        token.upos = fields[3] == "_" ? "" : fields[3];
+        token.xpos = fields[4] == "_" ? "" : fields[4];
+        token.feats = fields[5] == "_" ? "" : fields[5];
+        token.head = static_cast<int>(strtol(fields[6].c_str(), nullptr, 10));
+        token.deprel = fields[7] == "_" ? "" : fields[7];
+        token.deps = fields[8] == "_" ? "" : fields[8];
+        sentence.tokens.push_back(std::move(token));
+        space_after.push_back(fields[9].find("SpaceAfter=No") == string::npos);
+    }
+    return count;
+}
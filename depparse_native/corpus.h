@@ -0,0 +1,49 @@
+/* Copyright 2018
+ * Bernard Bou
+ * 1313ou@gmail.com */
+
+#ifndef DEPPARSE_CORPUS_H
+#define DEPPARSE_CORPUS_H
+
+#include <string>
+#include <vector>
+#include <istream>
+
+// annotated corpus in CoNLL-U format, read into plain records for host tools (no backend, no JNI).
+// Multiword token ranges and empty nodes are skipped, so tokens are the syntactic words as parsers output them.
+
+/**
+ * Corpus token
+ */
+struct corpus_token_t {
+    std::string form;
+    std::string lemma;
+    std::string upos;
+    std::string xpos;
+    std::string feats;
+    std::string deprel;
+    std::string deps;
+    int head = 0;       // 1-based, 0 for root
+    int start = -1;     // byte offset in sentence text
+    int end = -1;       // byte offset in sentence text, exclusive
+};
+
+/**
+ * Corpus sentence
+ */
+struct corpus_sentence_t {
+    std::string text;   // '# text' comment, else forms joined as SpaceAfter says
+    std::vector<corpus_token_t> tokens;
+};
+
+/**
+ * Read CoNLL-U
+ *
+ * @param in input
+ * @param sentences sentences to append to
+ * @return number of sentences read
+ */
+size_t
+readConllu(std::istream &in, std::vector<corpus_sentence_t> &sentences);
+
+#endif
@@ -0,0 +1,175 @@
+/* Copyright 2018
+ * Bernard Bou
+ * 1313ou@gmail.com */
+
+#include <cstdlib>
+#include <strings.h>
+
+#include "depparse_native/document.h"
+
+using namespace std;
+
+// S T R I N G   P O O L
+
+string_pool_t::string_pool_t() {
+    clear();
+}
+
+int32_t string_pool_t::add(const char *s, size_t n) {
+    if (n == 0 && !chars.empty()) {
+        return kEmptyString;
+    }
+    auto id = static_cast<int32_t>(offsets.size()) - 1;
+    chars.insert(chars.end(), s, s + n);
+    chars.push_back('\0');
+    offsets.push_back(static_cast<uint32_t>(chars.size()));
+    return id;
+}
+
+int32_t string_pool_t::intern(const string &s) {
+    auto it = interned.find(s);
+    if (it != interned.end()) {
+        return it->second;
+    }
+    int32_t id = add(s);
+    interned.emplace(s, id);
+    return id;
+}
+
+void string_pool_t::clear() {
+    chars.clear();
+    offsets.clear();
+    interned.clear();
+    offsets.push_back(0);
+    add("", 0); // kEmptyString
+}
+
+// D O C U M E N T
+
+void document_t::clear() {
+    sentences.clear();
+    tokens.clear();
+    deps.clear();
+    strings.clear();
+}
+
+document_view_t
+viewOf(const document_t &doc) {
+    document_view_t view;
+    view.sentences = doc.sentences.data();
+    view.sentence_count = static_cast<int32_t>(doc.sentences.size());
+    view.tokens = doc.tokens.data();
+    view.token_count = static_cast<int32_t>(doc.tokens.size());
+    view.deps = doc.deps.data();
+    view.dep_count = static_cast<int32_t>(doc.deps.size());
+    view.chars = doc.strings.chars.data();
+    view.offsets = doc.strings.offsets.data();
+    view.string_count = doc.strings.size();
+    return view;
+}
+
+bool
+isRoot(const document_view_t &doc, const doc_token_t &token) {
+    // udpipe hands the root a 0 head, so the label is what tells
+    return token.head < 0 || strcasecmp(doc.str(token.label), "root") == 0;
+}
+
+void
+appendDocument(document_t &doc, const document_view_t &from) {
+    // strings but the leading empty one
+    const int32_t shift = doc.strings.size() - 1;
+    const auto chars_before = static_cast<uint32_t>(doc.strings.chars.size());
+    if (from.string_count > 1) {
+        doc.strings.chars.insert(doc.strings.chars.end(), from.chars + from.offsets[1], from.chars + from.offsets[from.string_count]);
+        for (int32_t id = 2; id <= from.string_count; id++)
+            doc.strings.offsets.push_back(chars_before + from.offsets[id] - from.offsets[1]);
+    }
+    auto remap = [shift](int32_t id) { return id <= kEmptyString ? id : id + shift; };
+
+    const auto first_token = static_cast<int32_t>(doc.tokens.size());
+    const auto first_dep = static_cast<int32_t>(doc.deps.size());
+    for (int32_t i = 0; i < from.sentence_count; i++) {
+        doc_sentence_t sentence = from.sentences[i];
+        sentence.text = remap(sentence.text);
+        sentence.docid = remap(sentence.docid);
+        sentence.first_token += first_token;
+        doc.sentences.push_back(sentence);
+    }
+    for (int32_t i = 0; i < from.token_count; i++) {
+        doc_token_t token = from.tokens[i];
+        token.word = remap(token.word);
+        token.lemma = remap(token.lemma);
+        token.upostag = remap(token.upostag);
+        token.xpostag = remap(token.xpostag);
+        token.feats = remap(token.feats);
+        token.category = remap(token.category);
+        token.tag = remap(token.tag);
+        token.label = remap(token.label);
+        token.deps = remap(token.deps);
+        token.deps_first += first_dep;
+        doc.tokens.push_back(token);
+    }
+    for (int32_t i = 0; i < from.dep_count; i++) {
+        doc_dep_t dep = from.deps[i];
+        dep.label = remap(dep.label);
+        doc.deps.push_back(dep);
+    }
+}
+
+doc_token_t &
+newToken(document_t &doc) {
+    doc.tokens.emplace_back();
+    doc_token_t &token = doc.tokens.back();
+    token.word = kEmptyString;
+    token.lemma = kEmptyString;
+    token.upostag = kEmptyString;
+    token.xpostag = kEmptyString;
+    token.feats = kEmptyString;
+    token.category = kEmptyString;
+    token.tag = kEmptyString;
+    token.label = kEmptyString;
+    token.deps = kNullString;
+    token.head = -1;
+    token.start = -1;
+    token.end = -1;
+    token.breaklevel = -1;
+    token.deps_first = static_cast<int32_t>(doc.deps.size());
+    token.deps_count = 0;
+    return token;
+}
+
+// E N H A N C E D   D E P E N D E N C I E S
+
+void
+parseEnhancedDeps(const string &deps, document_t &doc) {
+    doc_token_t &token = doc.tokens.back();
+    token.deps_first = static_cast<int32_t>(doc.deps.size());
+    token.deps_count = 0;
+    if (deps.empty() || deps == "_") {
+        return;
+    }
+
+    string label;
+    string::size_type i = 0;
+    while (i < deps.size()) {
+        string::size_type j = deps.find('|', i);
+        if (j == string::npos)
+            j = deps.size();
+
+        // head:label, label being all that follows the first colon
+        string::size_type colon = deps.find(':', i);
+        if (colon != string::npos && colon < j) {
+            char *end;
+            long head = strtol(deps.c_str() + i, &end, 10);
+            if (end != deps.c_str() + i) {
+                label.assign(deps, colon + 1, j - colon - 1);
+                doc_dep_t dep;
+                dep.head = static_cast<int32_t>(head) - 1; // 1-based, 0 for root
+                dep.label = doc.strings.intern(label);
+                doc.deps.push_back(dep);
+                token.deps_count++;
+            }
+        }
+        i = j + 1;
+    }
+}
@@ -0,0 +1,215 @@
+/* Copyright 2018
+ * Bernard Bou
+ * 1313ou@gmail.com */
+
+#ifndef DEPPARSE_DOCUMENT_H
+#define DEPPARSE_DOCUMENT_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+// Backend-neutral compact parse result.
+// Backends convert their sentence_t maps once into flat sentence/token records whose
+// string fields are ids into a single string pool. Consumers (JNI materialization,
+// writers, command-line tools) read it through a document_view_t.
+
+/**
+ * String id of a null field (materialized as null in Java)
+ */
+const int32_t kNullString = -1;
+
+/**
+ * String id of the empty string, always present in a pool
+ */
+const int32_t kEmptyString = 0;
+
+/**
+ * Token fields to project conversion on (bit mask), fields left out are skipped (empty strings, -1 ints, null deps and tree)
+ */
+const int32_t kFieldWord = 1;
+const int32_t kFieldCategory = 2;
+const int32_t kFieldTag = 4;            // tag and the fields it is composed of: upostag, xpostag, lemma, feats
+const int32_t kFieldHead = 8;
+const int32_t kFieldLabel = 16;
+const int32_t kFieldOffsets = 32;       // sentence and token offsets
+const int32_t kFieldBreakLevel = 64;
+const int32_t kFieldDeps = 128;         // deps and enhanced dependencies
+const int32_t kFieldTree = 256;         // tree index, requires head and label
+const int32_t kFieldAll = 511;
+
+/**
+ * Fields to convert, given requested ones: adds those that requested ones depend on
+ */
+inline int32_t neededFields(int32_t fields) {
+    return (fields & kFieldTree) != 0 ? fields | kFieldHead | kFieldLabel : fields;
+}
+
+/**
+ * Sentence record
+ */
+struct doc_sentence_t {
+    int32_t text;           // string id, not null, possibly empty
+    int32_t docid;          // string id, not null, possibly empty
+    int32_t start;          // char index, possibly -1
+    int32_t end;            // char index, inclusive, possibly -1
+    int32_t first_token;    // index of first token record
+    int32_t token_count;    // number of token records
+};
+
+/**
+ * Enhanced dependency (DEPS) record
+ */
+struct doc_dep_t {
+    int32_t head;           // 0-based head index, -1 for root
+    int32_t label;          // interned string id
+};
+
+/**
+ * Token record, int fields are the values handed to Java
+ */
+struct doc_token_t {
+    int32_t word;           // string id, not null
+    int32_t lemma;          // string id, possibly empty
+    int32_t upostag;        // string id, possibly empty
+    int32_t xpostag;        // string id, possibly empty
+    int32_t feats;          // string id, possibly empty
+    int32_t category;       // string id, possibly empty
+    int32_t tag;            // string id, possibly empty
+    int32_t label;          // string id, possibly empty
+    int32_t deps;           // string id, possibly null
+    int32_t head;           // 0-based head index, possibly -1
+    int32_t start;          // char index relative to sentence text, possibly -1
+    int32_t end;            // char index relative to sentence text, inclusive, possibly -1
+    int32_t breaklevel;     // possibly -1
+    int32_t deps_first;     // index of first enhanced dependency record
+    int32_t deps_count;     // number of enhanced dependency records
+};
+
+/**
+ * Pool of NUL-terminated strings addressed by id
+ */
+class string_pool_t {
+public:
+    string_pool_t();
+
+    /**
+     * Append string (no deduplication, for words and texts)
+     */
+    int32_t add(const char *s, size_t n);
+
+    int32_t add(const std::string &s) {
+        return add(s.data(), s.size());
+    }
+
+    /**
+     * Append string unless already interned (for labels, tags, categories)
+     */
+    int32_t intern(const std::string &s);
+
+    const char *at(int32_t id) const {
+        return id < 0 ? nullptr : chars.data() + offsets[id];
+    }
+
+    int32_t size() const {
+        return static_cast<int32_t>(offsets.size()) - 1;
+    }
+
+    void clear();
+
+    std::vector<char> chars;        // concatenated NUL-terminated strings
+    std::vector<uint32_t> offsets;  // string id -> offset in chars, size() + 1 entries
+
+private:
+    std::unordered_map<std::string, int32_t> interned;
+};
+
+/**
+ * Owning document, filled by backend converters
+ */
+struct document_t {
+    std::vector<doc_sentence_t> sentences;
+    std::vector<doc_token_t> tokens;
+    std::vector<doc_dep_t> deps;
+    string_pool_t strings;
+
+    void clear();
+};
+
+/**
+ * Read-only view over document records, whatever owns them
+ */
+struct document_view_t {
+    const doc_sentence_t *sentences;
+    int32_t sentence_count;
+    const doc_token_t *tokens;
+    int32_t token_count;
+    const doc_dep_t *deps;
+    int32_t dep_count;
+    const char *chars;
+    const uint32_t *offsets;
+    int32_t string_count;
+
+    const char *str(int32_t id) const {
+        return id < 0 ? nullptr : chars + offsets[id];
+    }
+
+    size_t length(int32_t id) const {
+        return id < 0 ? 0 : offsets[id + 1] - offsets[id] - 1;
+    }
+
+    const doc_token_t *tokensOf(const doc_sentence_t &sentence) const {
+        return tokens + sentence.first_token;
+    }
+
+    const doc_dep_t *depsOf(const doc_token_t &token) const {
+        return deps + token.deps_first;
+    }
+};
+
+document_view_t
+viewOf(const document_t &doc);
+
+/**
+ * Whether token is a root of its sentence tree (no head or root label)
+ */
+bool
+isRoot(const document_view_t &doc, const doc_token_t &token);
+
+/**
+ * Tree head of token
+ *
+ * @return 0-based head index in sentence, -1 for roots
+ */
+inline int32_t
+treeHead(const document_view_t &doc, const doc_token_t &token) {
+    return isRoot(doc, token) ? -1 : token.head;
+}
+
+/**
+ * Parse CoNLL-U enhanced dependencies (head:label|head:label...) of the last token into dependency records.
+ * Empty and '_' yield no record, labels are interned, labels may themselves contain ':'.
+ *
+ * @param deps DEPS column
+ * @param doc document whose last token gets the records
+ */
+void
+parseEnhancedDeps(const std::string &deps, document_t &doc);
+
+/**
+ * Append records of other document, string ids being shifted (appended strings are not interned in the document)
+ *
+ * @param doc document to append to
+ * @param from document to append
+ */
+void
+appendDocument(document_t &doc, const document_view_t &from);
+
+/**
+ * Start a new token in the document (all string fields empty except deps that is null, int fields -1)
+ */
+doc_token_t &
+newToken(document_t &doc);
+
+#endif
@@ -0,0 +1,307 @@
+/* Copyright 2018
+ * Bernard Bou
+ * 1313ou@gmail.com */
+
+#include <jni.h>
+#include <utility>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+
+#include "depparse_native/jni_document.h"
+#include "depparse_native/jni_sentences.h"
+#include "depparse_native/char_indices.h"
+#include "depparse_native/semantics.h"
+
+using namespace std;
+
+/**
+ * Document, owned or mapped from cache, with the char offsets of its sentences in the document text,
+ * document text being sentence texts each followed by one separator char
+ */
+struct native_document_t {
+    document_t doc;                 // owned document, empty when mapped
+    mapped_file_t mapping;          // mapped document, unmapped when owned
+    document_view_t view;           // view of either
+    vector<int32_t> text_offsets;   // sentence count + 1, last one being document text length
+};
+
+/**
+ * Compute text offsets, once
+ */
+static void indexTextOffsets(native_document_t &native_doc) {
+    const document_view_t &view = native_doc.view;
+    vector<int32_t> &offsets = native_doc.text_offsets;
+    offsets.reserve(static_cast<size_t>(view.sentence_count) + 1);
+    int32_t offset = 0;
+    for (int32_t i = 0; i < view.sentence_count; i++) {
+        offsets.push_back(offset);
+        const char *text = view.str(view.sentences[i].text);
+        offset += charCount(text, strlen(text)) + 1;
+    }
+    offsets.push_back(offset);
+}
+
+jlong
+toNativeDocument(document_t &doc) {
+    auto *native_doc = new native_document_t();
+    native_doc->doc = std::move(doc);
+    doc.clear();
+    native_doc->view = viewOf(native_doc->doc);
+    indexTextOffsets(*native_doc);
+    return reinterpret_cast<jlong>(native_doc);
+}
+
+jlong
+toNativeDocument(parse_cache_t &cache, const string &key) {
+    auto *native_doc = new native_document_t();
+    if (!cache.lookup(key, native_doc->mapping, native_doc->view)) {
+        delete native_doc;
+        return 0;
+    }
+    indexTextOffsets(*native_doc);
+    return reinterpret_cast<jlong>(native_doc);
+}
+
+static inline const native_document_t &nativeDocumentOf(jlong ptr) {
+    return *reinterpret_cast<const native_document_t *>(ptr);
+}
+
+static inline const document_view_t &documentOf(jlong ptr) {
+    return nativeDocumentOf(ptr).view;
+}
+
+// N A T I V E   I N T E R F A C E
+
+extern "C" JNIEXPORT
+jint
+JNICALL Java_org_depparse_NativeDocument_nativeSentenceCount(
+        JNIEnv *env,
+        jobject thiz,
+        jlong ptr) {
+
+    (void) env;
+    (void) thiz;
+    return documentOf(ptr).sentence_count;
+}
+
+extern "C" JNIEXPORT
+jint
+JNICALL Java_org_depparse_NativeDocument_nativeTokenCount(
+        JNIEnv *env,
+        jobject thiz,
+        jlong ptr,
+        jint i) {
+
+    (void) env;
+    (void) thiz;
+    return documentOf(ptr).sentences[i].token_count;
+}
+
+extern "C" JNIEXPORT
+jstring
+JNICALL Java_org_depparse_NativeDocument_nativeSentenceText(
+        JNIEnv *env,
+        jobject thiz,
+        jlong ptr,
+        jint i) {
+
+    (void) thiz;
+    const document_view_t &doc = documentOf(ptr);
+    return env->NewStringUTF(doc.str(doc.sentences[i].text));
+}
+
+extern "C" JNIEXPORT
+jobject
+JNICALL Java_org_depparse_NativeDocument_nativeSentence(
+        JNIEnv *env,
+        jobject thiz,
+        jlong ptr,
+        jint i) {
+
+    (void) thiz;
+    const document_view_t &doc = documentOf(ptr);
+    jni_classes_t classes;
+    if (!lookupClasses(env, classes)) {
+        return nullptr;
+    }
+    jstring_cache_t labels(doc.string_count);
+    return toJavaSentence(env, doc, i, classes, labels);
+}
+
+extern "C" JNIEXPORT
+jobjectArray
+JNICALL Java_org_depparse_NativeDocument_nativeSentences(
+        JNIEnv *env,
+        jobject thiz,
+        jlong ptr,
+        jint from,
+        jint to) {
+
+    (void) thiz;
+    const document_view_t &doc = documentOf(ptr);
+    jni_classes_t classes;
+    if (!lookupClasses(env, classes)) {
+        return nullptr;
+    }
+    jobjectArray sentence_array = env->NewObjectArray(to - from, classes.sentence_class, nullptr);
+    if (sentence_array == nullptr) {
+        return nullptr;
+    }
+
+    // one label cache for the page, local references released as sentences are set
+    jstring_cache_t labels(doc.string_count);
+    for (jint i = from; i < to; i++) {
+        jobject jsentence = toJavaSentence(env, doc, i, classes, labels);
+        if (env->ExceptionCheck()) {
+            return nullptr;
+        }
+        env->SetObjectArrayElement(sentence_array, i - from, jsentence);
+        env->DeleteLocalRef(jsentence);
+    }
+    return sentence_array;
+}
+
+extern "C" JNIEXPORT
+jint
+JNICALL Java_org_depparse_NativeDocument_nativeTextOffset(
+        JNIEnv *env,
+        jobject thiz,
+        jlong ptr,
+        jint i) {
+
+    (void) env;
+    (void) thiz;
+    return nativeDocumentOf(ptr).text_offsets[i];
+}
+
+extern "C" JNIEXPORT
+jint
+JNICALL Java_org_depparse_NativeDocument_nativeFindSentenceAt(
+        JNIEnv *env,
+        jobject thiz,
+        jlong ptr,
+        jint offset) {
+
+    (void) env;
+    (void) thiz;
+    const vector<int32_t> &offsets = nativeDocumentOf(ptr).text_offsets;
+    if (offset < 0 || offset >= offsets.back()) {
+        return -1;
+    }
+    // last sentence starting at or before offset
+    auto it = upper_bound(offsets.begin(), offsets.end(), offset);
+    return static_cast<jint>(it - offsets.begin()) - 1;
+}
+
+extern "C" JNIEXPORT
+jintArray
+JNICALL Java_org_depparse_NativeDocument_nativeSemantics(
+        JNIEnv *env,
+        jobject thiz,
+        jlong ptr,
+        jobjectArray jlabels,
+        jint threads) {
+
+    (void) thiz;
+    if (env->GetArrayLength(jlabels) != kClassCount) {
+        env->ThrowNew(env->FindClass("java/lang/IllegalArgumentException"), "Semantic labels are not one set per class");
+        return nullptr;
+    }
+
+    // labels of each class
+    semantic_labels_t labels;
+    for (jsize c = 0; c < kClassCount; c++) {
+        auto jclass_labels = static_cast<jobjectArray>(env->GetObjectArrayElement(jlabels, c));
+        jsize n = env->GetArrayLength(jclass_labels);
+        for (jsize i = 0; i < n; i++) {
+            auto jlabel = static_cast<jstring>(env->GetObjectArrayElement(jclass_labels, i));
+            const char *label = env->GetStringUTFChars(jlabel, JNI_FALSE);
+            labels.classes[c].emplace_back(label);
+            env->ReleaseStringUTFChars(jlabel, label);
+            env->DeleteLocalRef(jlabel);
+        }
+        env->DeleteLocalRef(jclass_labels);
+    }
+
+    // analyze
+    vector<int32_t> relations;
+    analyzeSemantics(documentOf(ptr), labels, relations, threads);
+
+    auto n = static_cast<jsize>(relations.size());
+    jintArray jrelations = env->NewIntArray(n);
+    if (jrelations == nullptr) {
+        return nullptr;
+    }
+    env->SetIntArrayRegion(jrelations, 0, n, relations.data());
+    return jrelations;
+}
+
+extern "C" JNIEXPORT
+jintArray
+JNICALL Java_org_depparse_NativeDocument_nativeQuery(
+        JNIEnv *env,
+        jobject thiz,
+        jlong ptr,
+        jstring jpattern,
+        jint max_matches) {
+
+    (void) thiz;
+    return toJavaMatches(env, documentOf(ptr), jpattern, max_matches);
+}
+
+extern "C" JNIEXPORT
+void
+JNICALL Java_org_depparse_NativeDocument_release(
+        JNIEnv *env,
+        jclass clazz,
+        jlong ptr) {
+
+    (void) env;
+    (void) clazz;
+    delete reinterpret_cast<native_document_t *>(ptr);
+}
+
+// C A C H E
+
+extern "C" JNIEXPORT
+jlong
+JNICALL Java_org_depparse_ParseCache_open(
+        JNIEnv *env,
+        jclass clazz,
+        jstring jdir,
+        jlong max_bytes) {
+
+    (void) clazz;
+    const char *dir = env->GetStringUTFChars(jdir, JNI_FALSE);
+    auto *cache = new parse_cache_t(dir, max_bytes > 0 ? static_cast<size_t>(max_bytes) : 0);
+    env->ReleaseStringUTFChars(jdir, dir);
+    return handles<parse_cache_t>().add(cache);
+}
+
+extern "C" JNIEXPORT
+void
+JNICALL Java_org_depparse_ParseCache_clear(
+        JNIEnv *env,
+        jclass clazz,
+        jlong ptr) {
+
+    (void) env;
+    (void) clazz;
+    shared_ptr<parse_cache_t> cache = cacheOf(ptr);
+    if (cache)
+        cache->clear();
+}
+
+extern "C" JNIEXPORT
+void
+JNICALL Java_org_depparse_ParseCache_release(
+        JNIEnv *env,
+        jclass clazz,
+        jlong ptr) {
+
+    (void) env;
+    (void) clazz;
+    // freed here unless cached parse calls are in flight, by the last of them otherwise
+    handles<parse_cache_t>().remove(ptr);
+}
@@ -0,0 +1,47 @@
+/* Copyright 2018
+ * Bernard Bou
+ * 1313ou@gmail.com */
+
+#ifndef DEPPARSE_JNI_DOCUMENT_H
+#define DEPPARSE_JNI_DOCUMENT_H
+
+#include <jni.h>
+
+#include <string>
+#include <memory>
+
+#include "depparse_native/jni_handles.h"
+#include "depparse_native/document.h"
+#include "depparse_native/parse_cache.h"
+
+// native storage behind org.depparse.NativeDocument and org.depparse.ParseCache, shared by the JNI libraries
+
+/**
+ * Move document to native storage owned by a Java org.depparse.NativeDocument
+ *
+ * @param doc document, emptied
+ * @return pointer to hand to the NativeDocument constructor, released by NativeDocument.release
+ */
+jlong
+toNativeDocument(document_t &doc);
+
+/**
+ * Parse cache behind a Java org.depparse.ParseCache, kept alive by the returned reference
+ *
+ * @return null if cache is null or was released
+ */
+inline std::shared_ptr<parse_cache_t> cacheOf(jlong ptr) {
+    return handles<parse_cache_t>().get(ptr);
+}
+
+/**
+ * Map cached document to native storage owned by a Java org.depparse.NativeDocument, served in place
+ *
+ * @param cache parse cache
+ * @param key entry key
+ * @return pointer to hand to the NativeDocument constructor, 0 on a cache miss
+ */
+jlong
+toNativeDocument(parse_cache_t &cache, const std::string &key);
+
+#endif
@@ -0,0 +1,76 @@
+/* Copyright 2018
+ * Bernard Bou
+ * 1313ou@gmail.com */
+
+#ifndef DEPPARSE_JNI_HANDLES_H
+#define DEPPARSE_JNI_HANDLES_H
+
+#include <jni.h>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+// Native objects behind Java handles (pools, registries, parse caches) are kept in tables of shared references:
+// calls hold a reference for their duration and release only drops the table's, so that an object is freed by
+// whichever of release or the last call in flight lets go of it last.
+
+/**
+ * Table of live handles to objects of type T
+ */
+template<typename T>
+class handles_t {
+public:
+    /**
+     * Register object, owned by the table from then on
+     *
+     * @return Java handle
+     */
+    jlong add(T *object) {
+        auto handle = reinterpret_cast<jlong>(object);
+        std::lock_guard<std::mutex> lock(m);
+        objects[handle] = std::shared_ptr<T>(object);
+        return handle;
+    }
+
+    /**
+     * Object behind handle, kept alive by the returned reference
+     *
+     * @return null if handle is null or was removed
+     */
+    std::shared_ptr<T> get(jlong handle) {
+        std::lock_guard<std::mutex> lock(m);
+        auto it = objects.find(handle);
+        return it != objects.end() ? it->second : nullptr;
+    }
+
+    /**
+     * Unregister handle, new calls failing to get its object
+     *
+     * @return table's reference, freeing the object when dropped unless calls are in flight, null if handle was not registered
+     */
+    std::shared_ptr<T> remove(jlong handle) {
+        std::shared_ptr<T> object;
+        std::lock_guard<std::mutex> lock(m);
+        auto it = objects.find(handle);
+        if (it != objects.end()) {
+            object = std::move(it->second);
+            objects.erase(it);
+        }
+        return object;
+    }
+
+private:
+    std::mutex m;
+    std::unordered_map<jlong, std::shared_ptr<T>> objects;
+};
+
+/**
+ * Live handles of library
+ */
+template<typename T>
+handles_t<T> &handles() {
+    static handles_t<T> table;
+    return table;
+}
+
+#endif
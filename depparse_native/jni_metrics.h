@@ -0,0 +1,77 @@
+/* Copyright 2018
+ * Bernard Bou
+ * 1313ou@gmail.com */
+
+#ifndef DEPPARSE_JNI_METRICS_H
+#define DEPPARSE_JNI_METRICS_H
+
+#include <jni.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "depparse_native/metrics.h"
+#include "depparse_native/model_pool.h"
+#include "depparse_native/trace.h"
+
+/**
+ * Records a JNI call in library metrics: input bytes when entered, end-to-end latency when left,
+ * the call counting as failed if it leaves with a pending Java exception.
+ * Calls on a model pool are also written to the library trace when recording.
+ */
+class call_metrics_t {
+public:
+    /**
+     * @param call call name, as recorded in traces
+     * @param pool model pool serving the call
+     */
+    call_metrics_t(JNIEnv *env, const std::vector<std::string> &texts, const char *call, model_pool_t *pool) :
+            env(env), texts(texts), call(call), pool(pool), start(std::chrono::steady_clock::now()) {
+        size_t bytes = 0;
+        for (const auto &text: texts)
+            bytes += text.size();
+        metrics_t &m = metrics();
+        m.calls.fetch_add(1, std::memory_order_relaxed);
+        m.bytes_in.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    ~call_metrics_t() {
+        metrics_t &m = metrics();
+        m.total.record(microsSince(start));
+        bool failed = env->ExceptionCheck();
+        if (failed)
+            m.failures.fetch_add(1, std::memory_order_relaxed);
+        trace_recorder_t &trace = recorder();
+        if (pool != nullptr && trace.active())
+            trace.record(call, pool->path(), reinterpret_cast<int64_t>(pool), texts, start, failed);
+    }
+
+    call_metrics_t(const call_metrics_t &) = delete;
+
+    call_metrics_t &operator=(const call_metrics_t &) = delete;
+
+private:
+    JNIEnv *const env;
+    const std::vector<std::string> &texts;
+    const char *const call;
+    model_pool_t *const pool;
+    const std::chrono::steady_clock::time_point start;
+};
+
+/**
+ * Snapshot of library metrics as Java long array (layout in metrics.h)
+ */
+inline jlongArray toJavaMetrics(JNIEnv *env) {
+    int64_t values[kMetricsSize];
+    metrics().snapshot(values);
+    jlong snapshot[kMetricsSize];
+    for (int i = 0; i < kMetricsSize; i++)
+        snapshot[i] = static_cast<jlong>(values[i]);
+    jlongArray array = env->NewLongArray(kMetricsSize);
+    if (array == nullptr)
+        return nullptr;
+    env->SetLongArrayRegion(array, 0, kMetricsSize, snapshot);
+    return array;
+}
+
+#endif
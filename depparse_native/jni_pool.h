@@ -0,0 +1,169 @@
+/* Copyright 2018
+ * Bernard Bou
+ * 1313ou@gmail.com */
+
+#ifndef DEPPARSE_JNI_POOL_H
+#define DEPPARSE_JNI_POOL_H
+
+#include <jni.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <utility>
+#include <memory>
+
+#include "depparse_native/jni_handles.h"
+#include "depparse_native/model_pool.h"
+#include "depparse_native/model_registry.h"
+#include "depparse_native/metrics.h"
+
+// Java handles of the JNI libraries are model_pool_t pointers, registry handles model_registry_t pointers,
+// both registered in the library's handle table (see jni_handles.h)
+
+inline std::shared_ptr<model_pool_t> poolOf(jlong handle) {
+    return handles<model_pool_t>().get(handle);
+}
+
+inline jlong toHandle(model_pool_t *pool) {
+    return handles<model_pool_t>().add(pool);
+}
+
+inline std::shared_ptr<model_registry_t> registryOf(jlong handle) {
+    return handles<model_registry_t>().get(handle);
+}
+
+inline jlong toHandle(model_registry_t *registry) {
+    return handles<model_registry_t>().add(registry);
+}
+
+/**
+ * Run backend call with a leased context, the context being returned when the call is done
+ *
+ * @param env environment
+ * @param pool model pool
+ * @param call callable taking a backend handle and the model the context belongs to
+ * @return false if no context could be acquired (an IllegalStateException is pending)
+ */
+template<typename F>
+bool withLease(JNIEnv *env, model_pool_t &pool, F &&call) {
+    foreground_t foreground(pool.speculation);
+    context_lease_t context(pool);
+    if (context.handle() == 0) {
+        env->ThrowNew(env->FindClass("java/lang/IllegalStateException"), "No parse context available");
+        return false;
+    }
+    {
+        scoped_timer_t timer(metrics().parse);
+        call(context.handle(), *context.leased());
+    }
+    return true;
+}
+
+/**
+ * Run backend call with a leased context, the context being returned when the call is done
+ *
+ * @param env environment
+ * @param pool model pool
+ * @param call callable taking a backend handle
+ * @return false if no context could be acquired (an IllegalStateException is pending)
+ */
+template<typename F>
+bool withContext(JNIEnv *env, model_pool_t &pool, F &&call) {
+    return withLease(env, pool, [&](long context, const model_t &model) {
+        (void) model;
+        call(context);
+    });
+}
+
+/**
+ * Run parse over texts in batches sized by the pool's controller, a context being leased for the parse of each batch only,
+ * so that concurrent calls interleave; latency of each batch (parse and conversion, lease excluded) is fed back to the controller.
+ * All entry points that parse texts into documents (Java sentences, native documents, cache entries, shared memory,
+ * CoNLL-U, query matches) run through it. Segmentation calls and proto calls do not: segmentation costs per byte are not
+ * those of parsing and would skew the controller's estimates, and proto results skip conversion, so no token count comes back.
+ *
+ * @param env environment
+ * @param pool model pool
+ * @param texts input texts
+ * @param parse callable taking a backend handle and the texts of a batch
+ * @param convert callable converting the last batch, returning false on failure, setting the number of tokens
+ * @param parsed_by if not null, set to the path of the model that parsed all batches, empty if a swap came in between batches
+ * @return false if no context could be acquired (an IllegalStateException is pending) or if conversion failed
+ */
+template<typename P, typename C>
+bool withBatches(JNIEnv *env, model_pool_t &pool, const std::vector<std::string> &texts, P &&parse, C &&convert,
+                 std::string *parsed_by = nullptr) {
+    foreground_t foreground(pool.speculation);
+    std::vector<std::string> batch;
+    bool mixed = false;
+    for (size_t i = 0; i < texts.size();) {
+        size_t j = pool.batching.next(texts, i);
+        batch.assign(texts.begin() + static_cast<long>(i), texts.begin() + static_cast<long>(j));
+        size_t bytes = 0;
+        for (const auto &text: batch)
+            bytes += text.size();
+
+        // timed once the context is held: lease waits and lazy context loads say nothing of the cost of a batch
+        std::chrono::steady_clock::time_point t0;
+        if (!withLease(env, pool, [&](long context, const model_t &model) {
+            if (parsed_by != nullptr) {
+                if (i == 0)
+                    *parsed_by = model.path;
+                else if (*parsed_by != model.path)
+                    mixed = true;
+            }
+            t0 = std::chrono::steady_clock::now();
+            parse(context, batch);
+        })) {
+            return false;
+        }
+        size_t tokens = 0;
+        if (!convert(tokens)) {
+            return false;
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        pool.batching.observe(batch.size(), bytes, tokens, std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+        i = j;
+    }
+    if (mixed)
+        parsed_by->clear();
+    return true;
+}
+
+/**
+ * Run withBatches over texts, results parked by the pool's speculator being appended to the document instead of parsing
+ * the texts they are for, runs of other texts being parsed in order in between
+ *
+ * @param env environment
+ * @param pool model pool
+ * @param texts input texts
+ * @param hashes content hashes of input texts
+ * @param doc document conversion appends to
+ * @param parse callable taking a backend handle and the texts of a batch
+ * @param convert callable converting the last batch into doc, returning false on failure, setting the number of tokens
+ * @return false if no context could be acquired (an IllegalStateException is pending) or if conversion failed
+ */
+template<typename P, typename C>
+bool withSpeculation(JNIEnv *env, model_pool_t &pool, const std::vector<std::string> &texts, const std::vector<uint64_t> &hashes,
+                     document_t &doc, P &&parse, C &&convert) {
+    speculator_t &speculation = pool.speculation;
+    std::vector<std::string> run;
+    for (size_t i = 0; i < texts.size();) {
+        if (speculation.take(hashes[i], doc)) {
+            i++;
+            continue;
+        }
+        size_t j = i + 1;
+        while (j < texts.size() && !speculation.parked(hashes[j]))
+            j++;
+        if (i == 0 && j == texts.size())
+            return withBatches(env, pool, texts, parse, convert);
+        run.assign(texts.begin() + static_cast<long>(i), texts.begin() + static_cast<long>(j));
+        if (!withBatches(env, pool, run, parse, convert))
+            return false;
+        i = j;
+    }
+    return true;
+}
+
+#endif
@@ -0,0 +1,335 @@
+/* Copyright 2018
+ * Bernard Bou
+ * 1313ou@gmail.com */
+
+#include <jni.h>
+#include <string>
+#include <vector>
+
+#include <android/log.h>
+
+#include "depparse_native/jni_sentences.h"
+#include "depparse_native/tree_index.h"
+#include "depparse_native/query.h"
+
+#define LOG_TAG    "DEPPARSE_JNI"
+
+//#define LOGE(...)  __android_log_print(ANDROID_LOG_ERROR,LOG_TAG,__VA_ARGS__)
+//#define LOGW(...)  __android_log_print(ANDROID_LOG_WARN,LOG_TAG,__VA_ARGS__)
+#define LOGD(...)  __android_log_print(ANDROID_LOG_DEBUG,LOG_TAG,__VA_ARGS__)
+//#define LOGI(...)  __android_log_print(ANDROID_LOG_INFO,LOG_TAG,__VA_ARGS__)
+
+using namespace std;
+
+const char kIllegalStateException[] = "java/lang/IllegalStateException";
+const char kIllegalArgumentException[] = "java/lang/IllegalArgumentException";
+
+const char sentenceClass[] = "org/depparse/Sentence";
+const char tokenClass[] = "org/depparse/Token";
+const char stringClass[] = "java/lang/String";
+const char treeIndexClass[] = "org/depparse/TreeIndex";
+const char sentenceCtor[] = "(Ljava/lang/String;II[Lorg/depparse/Token;Ljava/lang/String;Lorg/depparse/TreeIndex;)V";
+const char tokenCtor[] = "(IILjava/lang/String;IILjava/lang/String;Ljava/lang/String;ILjava/lang/String;ILjava/lang/String;[I[Ljava/lang/String;)V";
+const char treeIndexCtor[] = "([I)V";
+
+// C H E C K   H E L P E R S
+
+/**
+ * Check nullity and throw an IllegalStateException if the object is null
+ * @tparam T object type
+ * @param env environment
+ * @param t object to check
+ * @return object
+ */
+template<typename T>
+T CheckNotNull(JNIEnv *env, T &&t) {
+    if (t == nullptr) {
+        env->ThrowNew(env->FindClass(kIllegalStateException), "");
+        return nullptr;
+    }
+    return std::forward<T>(t);
+}
+
+
+// C L A S S E S
+
+bool
+lookupClasses(JNIEnv *env, jni_classes_t &classes) {
+    classes.sentence_class = CheckNotNull(env, env->FindClass(sentenceClass));
+    if (env->ExceptionCheck()) {
+        return false;
+    }
+    classes.sentence_ctor = CheckNotNull(env, env->GetMethodID(classes.sentence_class, "<init>", sentenceCtor));
+    if (env->ExceptionCheck()) {
+        return false;
+    }
+    classes.token_class = CheckNotNull(env, env->FindClass(tokenClass));
+    if (env->ExceptionCheck()) {
+        return false;
+    }
+    classes.token_ctor = CheckNotNull(env, env->GetMethodID(classes.token_class, "<init>", tokenCtor));
+    if (env->ExceptionCheck()) {
+        return false;
+    }
+    classes.string_class = CheckNotNull(env, env->FindClass(stringClass));
+    if (env->ExceptionCheck()) {
+        return false;
+    }
+    classes.tree_index_class = CheckNotNull(env, env->FindClass(treeIndexClass));
+    if (env->ExceptionCheck()) {
+        return false;
+    }
+    classes.tree_index_ctor = CheckNotNull(env, env->GetMethodID(classes.tree_index_class, "<init>", treeIndexCtor));
+    return !env->ExceptionCheck();
+}
+
+// T O   J A V A
+
+/**
+ * Returns Java enhanced dependencies of token as parallel arrays of heads and labels
+ *
+ * @param env environment
+ * @param doc document, non-null
+ * @param token token
+ * @param labels cache of label strings
+ * @param jheads output array of 0-based heads (-1 for root), null if none
+ * @param jlabels output array of labels, null if none
+ * @param string_class java class of string
+ */
+void
+toJavaEnhancedDeps(
+        JNIEnv *env,
+        const document_view_t &doc,
+        const doc_token_t &token,
+        jstring_cache_t &labels,
+        jintArray &jheads,
+        jobjectArray &jlabels,
+        jclass string_class) {
+
+    jheads = nullptr;
+    jlabels = nullptr;
+    int n = token.deps_count;
+    if (n == 0) {
+        return;
+    }
+    const doc_dep_t *deps = doc.depsOf(token);
+    vector<jint> heads(static_cast<size_t>(n));
+    for (int k = 0; k < n; k++) {
+        heads[k] = deps[k].head;
+    }
+    jheads = env->NewIntArray(n);
+    env->SetIntArrayRegion(jheads, 0, n, heads.data());
+    jlabels = env->NewObjectArray(n, string_class, nullptr);
+    for (int k = 0; k < n; k++) {
+        env->SetObjectArrayElement(jlabels, k, labels.get(env, doc, deps[k].label));
+    }
+}
+
+/**
+ * Returns Java tree index of sentence
+ *
+ * @param env environment
+ * @param doc document, non-null
+ * @param sentenceIndex sentence index
+ * @param tree_index_class java class of tree index
+ * @param tree_index_ctor java constructor of tree index
+ * @return TreeIndex
+ */
+jobject
+toJavaTreeIndex(
+        JNIEnv *env,
+        const document_view_t &doc,
+        int sentenceIndex,
+        jclass tree_index_class,
+        jmethodID tree_index_ctor) {
+
+    tree_index_t index;
+    buildTreeIndex(doc, sentenceIndex, index);
+    vector<int32_t> packed;
+    packTreeIndex(index, packed);
+
+    auto n = static_cast<jsize>(packed.size());
+    jintArray jdata = CheckNotNull(env, env->NewIntArray(n));
+    if (env->ExceptionCheck()) {
+        return nullptr;
+    }
+    env->SetIntArrayRegion(jdata, 0, n, packed.data());
+    return env->NewObject(tree_index_class, tree_index_ctor, jdata);
+}
+
+/**
+ * Returns a Java sentence
+ *
+ * @param env environment
+ * @param doc document, non-null
+ * @param sentenceIndex sentence index
+ * @param classes java classes and constructors
+ * @param labels cache of enhanced dependency label strings
+ * @param fields fields to materialize, others being the shared empty string, -1 or null
+ * @return Sentence with tokens field being Array<Token!!>!! otherwise
+ * @throws IllegalStateException whenever CheckNull encounters a null value, that is
+ * -word is null (should not happen)
+ * -category, label, tag are guarded against being null by being set to empty string at token level
+ * -text, docids are guarded against being null by being set to empty string at sentence level
+ */
+jobject
+toJavaSentence(
+        JNIEnv *env,
+        const document_view_t &doc,
+        int sentenceIndex,
+        const jni_classes_t &classes,
+        jstring_cache_t &labels,
+        int32_t fields) {
+
+    const doc_sentence_t &sentence = doc.sentences[sentenceIndex];
+    int nTokens = sentence.token_count;
+
+    // make java array of tokens Token[] to be field of Sentence class and return back to Java
+
+    jobjectArray jtoken_array = CheckNotNull(env, env->NewObjectArray(nTokens, classes.token_class, nullptr));
+    if (env->ExceptionCheck()) {
+        return nullptr;
+    }
+
+    // Tokens
+
+    const doc_token_t *tokens = doc.tokensOf(sentence);
+    jstring jempty = labels.get(env, doc, kEmptyString);
+    for (int j = 0; j < nTokens; j++) {
+
+        // collect token data
+
+        const doc_token_t &token = tokens[j];
+
+        // token constructor parameters
+
+        jstring jword = (fields & kFieldWord) == 0 ? jempty : CheckNotNull(env, env->NewStringUTF(doc.str(token.word)));
+        jstring jcategory = (fields & kFieldCategory) == 0 ? jempty : CheckNotNull(env, env->NewStringUTF(doc.str(token.category)));
+        jstring jtag = (fields & kFieldTag) == 0 ? jempty : CheckNotNull(env, env->NewStringUTF(doc.str(token.tag)));
+        jstring jlabel = (fields & kFieldLabel) == 0 ? jempty : CheckNotNull(env, env->NewStringUTF(doc.str(token.label)));
+        jstring jdeps = nullptr;
+        jintArray jdeps_heads = nullptr;
+        jobjectArray jdeps_labels = nullptr;
+        if ((fields & kFieldDeps) != 0) {
+            jdeps = token.deps == kNullString ? nullptr : CheckNotNull(env, env->NewStringUTF(doc.str(token.deps)));
+            toJavaEnhancedDeps(env, doc, token, labels, jdeps_heads, jdeps_labels, classes.string_class);
+        }
+        jint start = (fields & kFieldOffsets) == 0 ? -1 : token.start;
+        jint end = (fields & kFieldOffsets) == 0 ? -1 : token.end;
+        jint head = (fields & kFieldHead) == 0 ? -1 : token.head;
+        jint breaklevel = (fields & kFieldBreakLevel) == 0 ? -1 : token.breaklevel;
+
+        // make java token
+        // jword: String!!, possibly ""
+        // istart: Int!!, possibly -1
+        // iend: Int!!, possibly -1
+        // jcategory!!: String!!, possibly ""
+        // jtag: String!!
+        // ihead: Int!!, possibly -1
+        // jlabel: String!!, possibly ""
+        // ibreaklevel: Int!!, possibly -1
+        // jdeps: String?, possibly "", null if backend has no deps
+        // jdeps_heads, jdeps_labels: IntArray?, Array<String>?, null if no enhanced dependency
+        jobject jtoken = CheckNotNull(env, env->NewObject(classes.token_class, classes.token_ctor, sentenceIndex, j, jword, start, end, jcategory, jtag, head, jlabel, breaklevel, jdeps, jdeps_heads, jdeps_labels));
+        if (env->ExceptionCheck()) {
+            return nullptr;
+        }
+
+        // set token in array
+
+        env->SetObjectArrayElement(jtoken_array, j, jtoken);
+    }
+
+    // make sentence
+
+    jstring jtext = CheckNotNull(env, env->NewStringUTF(doc.str(sentence.text)));
+    jstring jdocid = CheckNotNull(env, env->NewStringUTF(doc.str(sentence.docid)));
+    jobject jtree = nullptr;
+    if ((fields & kFieldTree) != 0) {
+        jtree = CheckNotNull(env, toJavaTreeIndex(env, doc, sentenceIndex, classes.tree_index_class, classes.tree_index_ctor));
+        if (env->ExceptionCheck()) {
+            return nullptr;
+        }
+    }
+    jint start = (fields & kFieldOffsets) == 0 ? -1 : sentence.start;
+    jint end = (fields & kFieldOffsets) == 0 ? -1 : sentence.end;
+    jobject jsentence = env->NewObject(classes.sentence_class, classes.sentence_ctor, jtext, start, end, jtoken_array, jdocid, jtree);
+    return jsentence;
+}
+
+/**
+ * Returns an array of Java sentences
+ *
+ * @param env environment
+ * @param doc document
+ * @param fields fields to materialize
+ * @return array of java sentences, Array<Array<Token!!>!!>!! or an exception is thrown
+ * @throws IllegalStateException whenever
+ * - classes Sentence and Token and their constructors could not be retrieved
+ * - array of sentences could not be created
+ */
+jobjectArray
+toJavaSentences(
+        JNIEnv *env,
+        const document_view_t &doc,
+        int32_t fields) {
+
+    // classes and constructors
+
+    jni_classes_t classes;
+    if (!lookupClasses(env, classes)) {
+        return nullptr;
+    }
+    jstring_cache_t labels(doc.string_count);
+
+    // make Array<Sentence> to return back to Java
+
+    int n = doc.sentence_count;
+    jobjectArray sentence_array = CheckNotNull(env, env->NewObjectArray(n, classes.sentence_class, nullptr));
+    if (env->ExceptionCheck()) {
+        return nullptr;
+    }
+
+    // fill Array<Sentence> to return back to Java
+
+    for (int i = 0; i < n; i++) {
+        jobject jsentence = toJavaSentence(env, doc, i, classes, labels, fields);
+        env->SetObjectArrayElement(sentence_array, i, jsentence);
+    }
+    return sentence_array;
+}
+
+// Q U E R Y
+
+jintArray
+toJavaMatches(
+        JNIEnv *env,
+        const document_view_t &doc,
+        jstring jpattern,
+        jint max_matches) {
+
+    // compile
+    const char *pattern = env->GetStringUTFChars(jpattern, JNI_FALSE);
+    query_t query;
+    string error;
+    bool compiled = compileQuery(pattern, query, error);
+    env->ReleaseStringUTFChars(jpattern, pattern);
+    if (!compiled) {
+        env->ThrowNew(env->FindClass(kIllegalArgumentException), error.c_str());
+        return nullptr;
+    }
+
+    // match, tuples preceded by their width
+    vector<int32_t> matches;
+    matches.push_back(query.width());
+    int32_t count = matchQuery(query, doc, matches, max_matches);
+    LOGD("Matched %d\n", count);
+
+    auto n = static_cast<jsize>(matches.size());
+    jintArray jmatches = CheckNotNull(env, env->NewIntArray(n));
+    if (env->ExceptionCheck()) {
+        return nullptr;
+    }
+    env->SetIntArrayRegion(jmatches, 0, n, matches.data());
+    return jmatches;
+}
@@ -0,0 +1,93 @@
+/* Copyright 2018
+ * Bernard Bou
+ * 1313ou@gmail.com */
+
+#ifndef DEPPARSE_JNI_SENTENCES_H
+#define DEPPARSE_JNI_SENTENCES_H
+
+#include <jni.h>
+#include <vector>
+
+#include "depparse_native/document.h"
+
+// materialization of documents as org.depparse.Sentence/Token objects, shared by the JNI libraries
+
+/**
+ * Java classes and constructors, looked up once per call
+ */
+struct jni_classes_t {
+    jclass sentence_class;
+    jmethodID sentence_ctor;
+    jclass token_class;
+    jmethodID token_ctor;
+    jclass string_class;
+    jclass tree_index_class;
+    jmethodID tree_index_ctor;
+};
+
+/**
+ * Java strings for interned ids, created once per conversion so that tokens share them
+ */
+struct jstring_cache_t {
+    explicit jstring_cache_t(int32_t n) : strings(static_cast<size_t>(n), nullptr) {
+    }
+
+    jstring get(JNIEnv *env, const document_view_t &doc, int32_t id) {
+        jstring &jstr = strings[id];
+        if (jstr == nullptr)
+            jstr = env->NewStringUTF(doc.str(id));
+        return jstr;
+    }
+
+    std::vector<jstring> strings;
+};
+
+/**
+ * Look up classes and constructors
+ *
+ * @param env environment
+ * @param classes classes to fill
+ * @return false if an exception is pending
+ */
+bool
+lookupClasses(JNIEnv *env, jni_classes_t &classes);
+
+/**
+ * Returns a Java sentence
+ *
+ * @param env environment
+ * @param doc document
+ * @param sentenceIndex sentence index in document
+ * @param classes java classes and constructors
+ * @param labels cache of label strings
+ * @param fields fields to materialize (bit mask of kField*), others being empty strings, -1 or null without any Java string being made
+ * @return Sentence or null if an exception is pending
+ */
+jobject
+toJavaSentence(JNIEnv *env, const document_view_t &doc, int sentenceIndex, const jni_classes_t &classes, jstring_cache_t &labels, int32_t fields = kFieldAll);
+
+/**
+ * Returns an array of Java sentences
+ *
+ * @param env environment
+ * @param doc document
+ * @param fields fields to materialize (bit mask of kField*)
+ * @return array of java sentences, Array<Sentence!!>!! or null if an exception is pending
+ */
+jobjectArray
+toJavaSentences(JNIEnv *env, const document_view_t &doc, int32_t fields = kFieldAll);
+
+/**
+ * Returns matches of a structural query (see query.h) over document
+ *
+ * @param env environment
+ * @param doc document
+ * @param jpattern query pattern
+ * @param max_matches maximum number of matches, unlimited if <= 0
+ * @return [width, sentence index, token..., sentence index, token..., ...], width ints per match, or null if an exception is pending
+ * @throws IllegalArgumentException if pattern is malformed
+ */
+jintArray
+toJavaMatches(JNIEnv *env, const document_view_t &doc, jstring jpattern, jint max_matches);
+
+#endif
@@ -0,0 +1,71 @@
+/* Copyright 2018
+ * Bernard Bou
+ * 1313ou@gmail.com */
+
+#include "depparse_native/metrics.h"
+
+using namespace std;
+
+// H I S T O G R A M
+
+// values at or above this one land in the last bucket
+static const int64_t kMaxMicros = static_cast<int64_t>(2 * histogram_t::kSubBuckets - 1) << (histogram_t::kBucketCount / histogram_t::kSubBuckets - 2);
+
+int histogram_t::bucketOf(int64_t micros) {
+    if (micros < kSubBuckets)
+        return micros < 0 ? 0 : static_cast<int>(micros);
+    if (micros >= kMaxMicros)
+        return kBucketCount - 1;
+    int exponent = 63 - __builtin_clzll(static_cast<unsigned long long>(micros));
+    int sub = static_cast<int>(micros >> (exponent - kSubBits)) & (kSubBuckets - 1);
+    return (exponent - kSubBits + 1) * kSubBuckets + sub;
+}
+
+int64_t histogram_t::lowestOf(int bucket) {
+    if (bucket < kSubBuckets)
+        return bucket;
+    int exponent = bucket / kSubBuckets + kSubBits - 1;
+    int sub = bucket % kSubBuckets;
+    return static_cast<int64_t>(kSubBuckets + sub) << (exponent - kSubBits);
+}
+
+void histogram_t::record(int64_t micros) {
+    if (micros < 0)
+        micros = 0;
+    auto value = static_cast<uint64_t>(micros);
+    buckets[bucketOf(micros)].fetch_add(1, memory_order_relaxed);
+    count.fetch_add(1, memory_order_relaxed);
+    sum.fetch_add(value, memory_order_relaxed);
+    uint64_t current = max.load(memory_order_relaxed);
+    while (value > current && !max.compare_exchange_weak(current, value, memory_order_relaxed)) {
+    }
+}
+
+void histogram_t::snapshot(int64_t *out) const {
+    // not a consistent cut: concurrent records may show in some fields only, which pollers tolerate
+    out[0] = static_cast<int64_t>(count.load(memory_order_relaxed));
+    out[1] = static_cast<int64_t>(sum.load(memory_order_relaxed));
+    out[2] = static_cast<int64_t>(max.load(memory_order_relaxed));
+    for (int i = 0; i < kBucketCount; i++)
+        out[3 + i] = static_cast<int64_t>(buckets[i].load(memory_order_relaxed));
+}
+
+// M E T R I C S
+
+void metrics_t::snapshot(int64_t *out) const {
+    out[kMetricsVersion] = kMetricsLayoutVersion;
+    out[kMetricsCalls] = static_cast<int64_t>(calls.load(memory_order_relaxed));
+    out[kMetricsFailures] = static_cast<int64_t>(failures.load(memory_order_relaxed));
+    out[kMetricsSentences] = static_cast<int64_t>(sentences.load(memory_order_relaxed));
+    out[kMetricsTokens] = static_cast<int64_t>(tokens.load(memory_order_relaxed));
+    out[kMetricsBytesIn] = static_cast<int64_t>(bytes_in.load(memory_order_relaxed));
+    out[kMetricsBucketCount] = histogram_t::kBucketCount;
+    parse.snapshot(out + kMetricsHistograms);
+    convert.snapshot(out + kMetricsHistograms + kHistogramSize);
+    total.snapshot(out + kMetricsHistograms + 2 * kHistogramSize);
+}
+
+metrics_t &metrics() {
+    static metrics_t instance;
+    return instance;
+}
@@ -0,0 +1,159 @@
+/* Copyright 2018
+ * Bernard Bou
+ * 1313ou@gmail.com */
+
+#include <algorithm>
+
+#include "depparse_native/model_pool.h"
+
+using namespace std;
+
+// M O D E L
+
+model_t::model_t(const backend_t &backend, const string &path, int size) : path(path), size(size < 1 ? 1 : size), backend(backend), capacity(this->size) {
+}
+
+model_t::~model_t() {
+    // no lease is left: leases hold a reference
+    for (long handle: contexts) {
+        backend.unload(handle);
+    }
+}
+
+bool model_t::load() {
+    long handle = acquire();
+    if (handle == 0)
+        return false;
+    release(handle);
+    return true;
+}
+
+long model_t::acquire() {
+    unique_lock<mutex> lock(m);
+    while (true) {
+        if (!idle.empty()) {
+            long handle = idle.back();
+            idle.pop_back();
+            return handle;
+        }
+        if (capacity < size && chrono::steady_clock::now() - capped >= kContextRetry) {
+            // memory may have been freed since the failed load: try growing again, once per delay
+            capacity = size;
+        }
+        if (static_cast<int>(contexts.size()) + loading < capacity) {
+
+            // load outside the lock, other calls keep being served
+            loading++;
+            lock.unlock();
+            long handle = backend.load(path.c_str());
+            lock.lock();
+            loading--;
+            if (handle != 0) {
+                contexts.push_back(handle);
+                return handle;
+            }
+            cv.notify_all();
+            if (contexts.empty())
+                return 0;
+
+            // out of memory or the like: no more contexts for this model, wait for a loaded one instead of reloading
+            capacity = static_cast<int>(contexts.size()) + loading;
+            capped = chrono::steady_clock::now();
+            continue;
+        }
+        cv.wait(lock);
+    }
+}
+
+long model_t::tryAcquire() {
+    lock_guard<mutex> lock(m);
+    if (idle.empty())
+        return 0;
+    long handle = idle.back();
+    idle.pop_back();
+    return handle;
+}
+
+void model_t::release(long handle) {
+    {
+        lock_guard<mutex> lock(m);
+        idle.push_back(handle);
+    }
+    cv.notify_one();
+}
+
+int model_t::trim(int keep) {
+    vector<long> trimmed;
+    {
+        lock_guard<mutex> lock(m);
+        while (!idle.empty() && static_cast<int>(contexts.size()) > keep) {
+            long handle = idle.back();
+            idle.pop_back();
+            contexts.erase(find(contexts.begin(), contexts.end(), handle));
+            trimmed.push_back(handle);
+        }
+
+        // memory is released: contexts a failed load kept out may load now
+        capacity = size;
+    }
+    cv.notify_all();
+    // unloaded out of the lock, trimmed contexts load back on demand
+    for (long handle: trimmed) {
+        backend.unload(handle);
+    }
+    return static_cast<int>(trimmed.size());
+}
+
+// P O O L
+
+model_pool_t::model_pool_t(const backend_t &backend, int size) : backend(backend), size(size < 1 ? 1 : size) {
+}
+
+model_pool_t::~model_pool_t() {
+    // worker leases contexts of this pool
+    speculation.stop();
+}
+
+bool model_pool_t::load(const string &path) {
+    return load(path, backend);
+}
+
+bool model_pool_t::load(const string &path, const backend_t &model_backend) {
+    lock_guard<mutex> serialized(loading);
+    shared_ptr<model_t> loaded = make_shared<model_t>(model_backend, path, size);
+    if (!loaded->load())
+        return false;
+    {
+        lock_guard<mutex> lock(m);
+        model.swap(loaded);
+    }
+    // loaded now holds the replaced model, unloaded here unless leases still hold it
+    return true;
+}
+
+shared_ptr<model_t> model_pool_t::current() {
+    lock_guard<mutex> lock(m);
+    return model;
+}
+
+string model_pool_t::path() {
+    shared_ptr<model_t> loaded = current();
+    return loaded ? loaded->path : string();
+}
+
+int model_pool_t::trim(int keep) {
+    shared_ptr<model_t> loaded = current();
+    return loaded ? loaded->trim(keep) : 0;
+}
+
+// L E A S E
+
+context_lease_t::context_lease_t(model_pool_t &pool, bool idle_only) : model(pool.current()) {
+    if (model)
+        h = idle_only ? model->tryAcquire() : model->acquire();
+}
+
+context_lease_t::~context_lease_t() {
+    if (h != 0)
+        model->release(h);
+}
@@ -0,0 +1,200 @@
+/* Copyright 2018
+ * Bernard Bou
+ * 1313ou@gmail.com */
+
+#ifndef DEPPARSE_MODEL_POOL_H
+#define DEPPARSE_MODEL_POOL_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+
+#include "depparse_native/batch_controller.h"
+#include "depparse_native/preprocess.h"
+#include "depparse_native/speculation.h"
+
+// pools of backend parse contexts, so that concurrent parse calls never share a backend handle.
+// Backend handles make no thread-safety guarantee, so each context is a backend handle of its own:
+// contexts are loaded on demand, up to the pool size, and leased to one call at a time.
+
+/**
+ * Delay after which a pool capped by a failed context load tries to grow again
+ */
+const std::chrono::seconds kContextRetry(30);
+
+typedef long (*backend_load_t)(const char *model);
+typedef void (*backend_unload_t)(long handle);
+
+/**
+ * Backend entry points
+ */
+struct backend_t {
+    backend_load_t load;
+    backend_unload_t unload;
+};
+
+/**
+ * Loaded model: contexts over one model file, unloaded when the last reference goes
+ */
+class model_t {
+public:
+    model_t(const backend_t &backend, const std::string &path, int size);
+
+    ~model_t();
+
+    /**
+     * Load first context
+     *
+     * @return false if model could not be loaded
+     */
+    bool load();
+
+    /**
+     * Acquire a context, loading one if all are busy and pool is not full, waiting otherwise
+     * A failed load caps the pool at the contexts already loaded, so that it is not retried by every waiting call,
+     * until trim frees memory or kContextRetry has elapsed
+     *
+     * @return backend handle, 0 if none could be loaded
+     */
+    long acquire();
+
+    /**
+     * Acquire an idle context, never loading nor waiting
+     *
+     * @return backend handle, 0 if none is idle
+     */
+    long tryAcquire();
+
+    /**
+     * Return context to pool
+     */
+    void release(long handle);
+
+    /**
+     * Unload idle contexts, keeping at least keep contexts loaded, lifting the cap left by a failed load
+     *
+     * @return number of contexts unloaded
+     */
+    int trim(int keep);
+
+    const std::string path;
+    const int size;
+
+private:
+    const backend_t backend;
+    std::mutex m;
+    std::condition_variable cv;
+    std::vector<long> idle;
+    std::vector<long> contexts;
+    int loading = 0;
+    int capacity;       // size, lowered to the contexts loaded when a load fails
+    std::chrono::steady_clock::time_point capped;   // when capacity was lowered
+};
+
+/**
+ * Pool behind a Java handle: current model and pool size
+ */
+class model_pool_t {
+public:
+    model_pool_t(const backend_t &backend, int size);
+
+    ~model_pool_t();
+
+    /**
+     * Load model, replacing current model, if any, once loaded
+     * Calls keep being served by the current model while the new one loads, calls in flight finish on it,
+     * and it is unloaded when the last of them is done with it. Loads are serialized.
+     *
+     * @return false if model could not be loaded (current model is kept)
+     */
+    bool load(const std::string &path);
+
+    /**
+     * Load model with other backend entry points, replacing current model, if any, once loaded
+     *
+     * @return false if model could not be loaded (current model is kept)
+     */
+    bool load(const std::string &path, const backend_t &model_backend);
+
+    /**
+     * Current model, kept alive by the returned reference
+     */
+    std::shared_ptr<model_t> current();
+
+    /**
+     * Path of current model, empty if none
+     */
+    std::string path();
+
+    /**
+     * Unload idle contexts of current model, keeping at least keep contexts loaded
+     *
+     * @return number of contexts unloaded
+     */
+    int trim(int keep);
+
+    const backend_t backend;
+    const int size;
+
+    /**
+     * Batch sizing of parse calls on this pool, kept across model swaps
+     */
+    batch_controller_t batching;
+
+    /**
+     * Preprocessing of input texts of parse calls on this pool (kPreprocess* flags), kept across model swaps
+     */
+    std::atomic<int32_t> preprocessing{kPreprocessDefault};
+
+    /**
+     * Speculative parsing of texts likely to be asked for next, stopped before the pool goes
+     */
+    speculator_t speculation{*this};
+
+private:
+    std::mutex m;
+    std::mutex loading;
+    std::shared_ptr<model_t> model;
+};
+
+/**
+ * Scoped lease of a context of the current model, the model outliving the lease
+ */
+class context_lease_t {
+public:
+    /**
+     * @param pool pool to lease from
+     * @param idle_only whether to lease an idle context only, never loading nor waiting for one
+     */
+    explicit context_lease_t(model_pool_t &pool, bool idle_only = false);
+
+    ~context_lease_t();
+
+    context_lease_t(const context_lease_t &) = delete;
+
+    context_lease_t &operator=(const context_lease_t &) = delete;
+
+    /**
+     * Backend handle, 0 if no context could be acquired
+     */
+    long handle() const {
+        return h;
+    }
+
+    /**
+     * Model the context belongs to
+     */
+    const std::shared_ptr<model_t> &leased() const {
+        return model;
+    }
+
+private:
+    std::shared_ptr<model_t> model;
+    long h = 0;
+};
+
+#endif
@@ -0,0 +1,156 @@
+/* Copyright 2018
+ * Bernard Bou
+ * 1313ou@gmail.com */
+
+#include <thread>
+#include <utility>
+#include <vector>
+#include <sys/stat.h>
+
+#include "depparse_native/model_registry.h"
+
+using namespace std;
+
+static size_t fileSize(const string &path) {
+    struct stat st{};
+    if (stat(path.c_str(), &st) != 0)
+        return 0;
+    return static_cast<size_t>(st.st_size);
+}
+
+// R E G I S T R Y
+
+model_registry_t::model_registry_t(const backend_t &backend, size_t budget, int size) : backend(backend), budget(budget), size(size < 1 ? 1 : size) {
+}
+
+model_registry_t::~model_registry_t() {
+    unique_lock<mutex> lock(m);
+    while (pending > 0)
+        cv.wait(lock);
+}
+
+shared_ptr<model_pool_t> model_registry_t::get(const string &path, bool wait) {
+    unique_lock<mutex> lock(m);
+    entry_t &entry = entries[path];
+    if (!entry.pool && !entry.loading)
+        startLoading(path, entry);
+    if (entry.loading) {
+        if (!wait)
+            return nullptr;
+        while (entry.loading)
+            cv.wait(lock);
+    }
+    // entry survives the wait: loading entries are not evicted
+    entry.last_used = ++tick;
+    return entry.pool;
+}
+
+void model_registry_t::prefetch(const string &path) {
+    lock_guard<mutex> lock(m);
+    entry_t &entry = entries[path];
+    if (!entry.pool && !entry.loading)
+        startLoading(path, entry);
+}
+
+void model_registry_t::evict(const string &path) {
+    shared_ptr<model_pool_t> evicted;
+    {
+        lock_guard<mutex> lock(m);
+        auto it = entries.find(path);
+        if (it == entries.end() || it->second.loading)
+            return;
+        in_use -= it->second.cost;
+        evicted.swap(it->second.pool);
+        entries.erase(it);
+    }
+    // unloaded here, out of the lock, unless calls in flight still hold it
+}
+
+size_t model_registry_t::used() {
+    lock_guard<mutex> lock(m);
+    return in_use;
+}
+
+int model_registry_t::trim(int keep) {
+    vector<shared_ptr<model_pool_t>> evicted;
+    {
+        lock_guard<mutex> lock(m);
+        int loaded = 0;
+        for (const auto &e: entries) {
+            if (e.second.pool)
+                loaded++;
+        }
+        while (loaded > keep) {
+            auto lru = entries.end();
+            for (auto it = entries.begin(); it != entries.end(); ++it) {
+                if (it->second.pool && (lru == entries.end() || it->second.last_used < lru->second.last_used))
+                    lru = it;
+            }
+            in_use -= lru->second.cost;
+            evicted.push_back(lru->second.pool);
+            entries.erase(lru);
+            loaded--;
+        }
+    }
+    // unloaded here, out of the lock, unless calls in flight still hold them
+    return static_cast<int>(evicted.size());
+}
+
+vector<shared_ptr<model_pool_t>> model_registry_t::pools() {
+    vector<shared_ptr<model_pool_t>> loaded;
+    lock_guard<mutex> lock(m);
+    for (const auto &e: entries) {
+        if (e.second.pool)
+            loaded.push_back(e.second.pool);
+    }
+    return loaded;
+}
+
+void model_registry_t::startLoading(const string &path, entry_t &entry) {
+    entry.loading = true;
+    pending++;
+    thread(&model_registry_t::load, this, path).detach();
+}
+
+void model_registry_t::load(const string &path) {
+    size_t cost = fileSize(path) * static_cast<size_t>(size);
+
+    // make room first, so that concurrent loads keep within budget
+    vector<shared_ptr<model_pool_t>> evicted;
+    {
+        lock_guard<mutex> lock(m);
+        for (bool fits = budget == 0 || in_use + cost <= budget; !fits; fits = in_use + cost <= budget) {
+            auto lru = entries.end();
+            for (auto it = entries.begin(); it != entries.end(); ++it) {
+                if (it->second.pool && !it->second.loading && (lru == entries.end() || it->second.last_used < lru->second.last_used))
+                    lru = it;
+            }
+            if (lru == entries.end())
+                break; // model alone exceeds budget: loaded anyway
+            in_use -= lru->second.cost;
+            evicted.push_back(lru->second.pool);
+            entries.erase(lru);
+        }
+        entries[path].cost = cost;
+        in_use += cost;
+    }
+    evicted.clear();
+
+    // load out of the lock, other models keep being served
+    shared_ptr<model_pool_t> pool = make_shared<model_pool_t>(backend, size);
+    bool loaded = pool->load(path);
+
+    lock_guard<mutex> lock(m);
+    entry_t &entry = entries[path];
+    entry.loading = false;
+    if (loaded) {
+        entry.pool = std::move(pool);
+    } else {
+        // left without pool, next get retries
+        in_use -= entry.cost;
+        entry.cost = 0;
+    }
+    entry.last_used = ++tick;
+    pending--;
+    cv.notify_all();
+}
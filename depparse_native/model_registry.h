@@ -0,0 +1,101 @@
+/* Copyright 2018
+ * Bernard Bou
+ * 1313ou@gmail.com */
+
+#ifndef DEPPARSE_MODEL_REGISTRY_H
+#define DEPPARSE_MODEL_REGISTRY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <map>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+
+#include "depparse_native/model_pool.h"
+
+// models of several languages kept loaded side by side, keyed by model path, within a memory budget.
+// A miss loads the model in the background, evicting least recently used models until it fits.
+// The cost of a model is estimated as its file size times the pool size (one backend handle per context).
+// Evicted models drain like swapped-out ones: calls in flight finish on them.
+
+/**
+ * Registry of model pools
+ */
+class model_registry_t {
+public:
+    /**
+     * @param backend backend entry points
+     * @param budget memory budget in bytes, unlimited if 0
+     * @param size pool size of each model
+     */
+    model_registry_t(const backend_t &backend, size_t budget, int size);
+
+    /**
+     * Waits for background loads to end
+     */
+    ~model_registry_t();
+
+    /**
+     * Get model, loading it in the background if not loaded
+     *
+     * @param path model path (key)
+     * @param wait whether to wait for a pending load to end
+     * @return model pool, null if loading (when not waiting) or if the model could not be loaded
+     */
+    std::shared_ptr<model_pool_t> get(const std::string &path, bool wait);
+
+    /**
+     * Start loading model in the background if not loaded, does not wait
+     */
+    void prefetch(const std::string &path);
+
+    /**
+     * Drop model, calls in flight finishing on it
+     */
+    void evict(const std::string &path);
+
+    /**
+     * Estimated memory used by loaded models in bytes
+     */
+    size_t used();
+
+    /**
+     * Evict least recently used models, keeping at most keep of them
+     *
+     * @return number of models evicted
+     */
+    int trim(int keep);
+
+    /**
+     * Pools of loaded models
+     */
+    std::vector<std::shared_ptr<model_pool_t>> pools();
+
+    const backend_t backend;
+    const size_t budget;
+    const int size;
+
+private:
+    struct entry_t {
+        std::shared_ptr<model_pool_t> pool;
+        size_t cost = 0;
+        uint64_t last_used = 0;
+        bool loading = false;
+    };
+
+    void startLoading(const std::string &path, entry_t &entry);
+
+    void load(const std::string &path);
+
+    std::mutex m;
+    std::condition_variable cv;
+    std::map<std::string, entry_t> entries;
+    size_t in_use = 0;
+    uint64_t tick = 0;
+    int pending = 0;
+};
+
+#endif
@@ -0,0 +1,46 @@
+# Optional optimized build of the JNI libraries (clang): ThinLTO and profile-guided optimization.
+#
+#   -DDEPPARSE_LTO=ON                          ThinLTO
+#   -DDEPPARSE_PROFILE_GENERATE=<dir>          instrument for profile collection, raw profiles written to dir (host training driver)
+#   -DDEPPARSE_PROFILE_USE=<file.profdata>     optimize with merged profile, implies ThinLTO
+#
+# Profiles are collected on the host by the training drivers (udpipe_train, syntaxnet_train) and merged with llvm-profdata
+# of the same LLVM major version as the compiler that consumes them (see make-pgo.sh at the repository root).
+# Functions whose host profile does not match the target build (e.g. inlined standard library code) are optimized without profile.
+
+option(DEPPARSE_LTO "Link the JNI library with ThinLTO" OFF)
+set(DEPPARSE_PROFILE_GENERATE "" CACHE PATH "Directory of raw profiles of an instrumented build")
+set(DEPPARSE_PROFILE_USE "" CACHE FILEPATH "Merged profile (.profdata) to optimize with")
+
+function(depparse_optimize target)
+    if (NOT DEPPARSE_LTO AND NOT DEPPARSE_PROFILE_GENERATE AND NOT DEPPARSE_PROFILE_USE)
+        return()
+    endif ()
+    if (NOT CMAKE_CXX_COMPILER_ID MATCHES "Clang")
+        message(WARNING "Profile-guided and ThinLTO builds need clang, ${target} is built plain")
+        return()
+    endif ()
+
+    if (DEPPARSE_PROFILE_GENERATE)
+        target_compile_options(${target} PRIVATE "-fprofile-generate=${DEPPARSE_PROFILE_GENERATE}")
+        target_link_options(${target} PRIVATE "-fprofile-generate=${DEPPARSE_PROFILE_GENERATE}")
+    elseif (DEPPARSE_PROFILE_USE)
+        if (NOT EXISTS ${DEPPARSE_PROFILE_USE})
+            message(FATAL_ERROR "No profile ${DEPPARSE_PROFILE_USE}")
+        endif ()
+        target_compile_options(${target} PRIVATE
+                "-fprofile-use=${DEPPARSE_PROFILE_USE}"
+                -Wno-profile-instr-unprofiled
+                -Wno-profile-instr-out-of-date
+                -Wno-backend-plugin)
+    endif ()
+
+    if (DEPPARSE_LTO OR DEPPARSE_PROFILE_USE)
+        target_compile_options(${target} PRIVATE -flto=thin)
+        target_link_options(${target} PRIVATE -flto=thin)
+        if (DEPPARSE_PROFILE_USE)
+            # profile is also applied to cross-module inlining at link time
+            target_link_options(${target} PRIVATE "-fprofile-use=${DEPPARSE_PROFILE_USE}")
+        endif ()
+    endif ()
+endfunction()
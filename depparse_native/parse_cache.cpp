@@ -0,0 +1,194 @@
+/* Copyright 2018
+ * Bernard Bou
+ * 1313ou@gmail.com */
+
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <algorithm>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "depparse_native/parse_cache.h"
+#include "depparse_native/preprocess.h"
+#include "depparse_native/binary.h"
+
+using namespace std;
+
+static const char kEntrySuffix[] = ".dpb";
+static const char kTempSuffix[] = ".tmp";
+static const time_t kStaleTempSeconds = 600;
+
+// M A P P I N G
+
+mapped_file_t::~mapped_file_t() {
+    if (addr != nullptr)
+        munmap(addr, length);
+}
+
+bool mapped_file_t::map(const string &path) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return false;
+    }
+    void *a = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (a == MAP_FAILED)
+        return false;
+    addr = a;
+    length = static_cast<size_t>(st.st_size);
+    return true;
+}
+
+// K E Y S
+
+string
+modelIdentity(const string &model_path) {
+    struct stat st{};
+    string identity = model_path;
+    if (stat(model_path.c_str(), &st) == 0) {
+        identity += '|';
+        identity += to_string(static_cast<long long>(st.st_size));
+        identity += '|';
+        identity += to_string(static_cast<long long>(st.st_mtime));
+    }
+    return identity;
+}
+
+string
+cacheKey(const string &model_identity, const vector<uint64_t> &hashes, const char *variant) {
+    // text hashes fold in text lengths, so that splitting texts differently yields other keys
+    string buffer(variant);
+    buffer += '\0';
+    buffer += model_identity;
+    buffer += '\0';
+    buffer.append(reinterpret_cast<const char *>(hashes.data()), hashes.size() * sizeof(uint64_t));
+    uint64_t h = contentHash(buffer);
+    char key[17];
+    snprintf(key, sizeof(key), "%016llx", static_cast<unsigned long long>(h));
+    return key;
+}
+
+// C A C H E
+
+parse_cache_t::parse_cache_t(const string &dir, size_t max_bytes) : dir(dir), max_bytes(max_bytes) {
+    mkdir(dir.c_str(), 0700);
+}
+
+string parse_cache_t::pathOf(const string &key) const {
+    return dir + '/' + key + kEntrySuffix;
+}
+
+bool parse_cache_t::lookup(const string &key, mapped_file_t &mapping, document_view_t &doc) {
+    string path = pathOf(key);
+    if (!mapping.map(path))
+        return false;
+    if (!readBinary(mapping.data(), mapping.size(), doc)) {
+        unlink(path.c_str());
+        return false;
+    }
+    // access time as modification time, for eviction
+    utimensat(AT_FDCWD, path.c_str(), nullptr, 0);
+    return true;
+}
+
+bool parse_cache_t::store(const string &key, const document_view_t &doc) {
+    string path = pathOf(key);
+    string temp = path + '.' + to_string(getpid()) + '.' + to_string(gettid()) + kTempSuffix;
+    int fd = open(temp.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0)
+        return false;
+
+    // written through a mapping, synced, then renamed over the entry
+    size_t size = binarySize(doc);
+    bool written = ftruncate(fd, static_cast<off_t>(size)) == 0;
+    if (written) {
+        void *data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        written = data != MAP_FAILED;
+        if (written) {
+            writeBinary(doc, static_cast<char *>(data));
+            munmap(data, size);
+            written = fsync(fd) == 0;
+        }
+    }
+    close(fd);
+    if (!written || rename(temp.c_str(), path.c_str()) != 0) {
+        unlink(temp.c_str());
+        return false;
+    }
+    if (max_bytes > 0)
+        evict();
+    return true;
+}
+
+void parse_cache_t::evict() {
+    lock_guard<mutex> lock(m);
+    DIR *d = opendir(dir.c_str());
+    if (d == nullptr)
+        return;
+
+    struct entry_t {
+        time_t mtime;
+        size_t size;
+        string path;
+    };
+    vector<entry_t> entries;
+    size_t total = 0;
+    time_t now = time(nullptr);
+    const size_t entry_suffix = strlen(kEntrySuffix);
+    const size_t temp_suffix = strlen(kTempSuffix);
+    struct dirent *e;
+    while ((e = readdir(d)) != nullptr) {
+        string name = e->d_name;
+        bool is_entry = name.size() > entry_suffix && name.compare(name.size() - entry_suffix, entry_suffix, kEntrySuffix) == 0;
+        bool is_temp = name.size() > temp_suffix && name.compare(name.size() - temp_suffix, temp_suffix, kTempSuffix) == 0;
+        if (!is_entry && !is_temp)
+            continue;
+        string path = dir + '/' + name;
+        struct stat st{};
+        if (stat(path.c_str(), &st) != 0)
+            continue;
+        if (is_temp) {
+            // left over by writers that died
+            if (now - st.st_mtime > kStaleTempSeconds)
+                unlink(path.c_str());
+            continue;
+        }
+        entries.push_back({st.st_mtime, static_cast<size_t>(st.st_size), path});
+        total += static_cast<size_t>(st.st_size);
+    }
+    closedir(d);
+    if (total <= max_bytes)
+        return;
+
+    // least recently used first, mapped entries stay readable once unlinked
+    sort(entries.begin(), entries.end(), [](const entry_t &a, const entry_t &b) { return a.mtime < b.mtime; });
+    for (const auto &entry: entries) {
+        if (total <= max_bytes)
+            break;
+        if (unlink(entry.path.c_str()) == 0)
+            total -= entry.size;
+    }
+}
+
+void parse_cache_t::clear() {
+    lock_guard<mutex> lock(m);
+    DIR *d = opendir(dir.c_str());
+    if (d == nullptr)
+        return;
+    const size_t entry_suffix = strlen(kEntrySuffix);
+    struct dirent *e;
+    while ((e = readdir(d)) != nullptr) {
+        string name = e->d_name;
+        if (name.size() > entry_suffix && name.compare(name.size() - entry_suffix, entry_suffix, kEntrySuffix) == 0)
+            unlink((dir + '/' + name).c_str());
+    }
+    closedir(d);
+}
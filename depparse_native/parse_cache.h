@@ -0,0 +1,115 @@
+/* Copyright 2018
+ * Bernard Bou
+ * 1313ou@gmail.com */
+
+#ifndef DEPPARSE_PARSE_CACHE_H
+#define DEPPARSE_PARSE_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <mutex>
+
+#include "depparse_native/document.h"
+
+// persistent parse cache: one file per entry in binary layout (see binary.h), named after the entry key.
+// Entries are memory-mapped and read in place, no deserialization.
+// Writes go to a temporary file that is synced then renamed, so that readers never see a partial entry.
+// Access time is kept as file modification time, least recently used entries being evicted above the size bound.
+
+/**
+ * Read-only file mapping, unmapped when destroyed
+ */
+class mapped_file_t {
+public:
+    mapped_file_t() = default;
+
+    ~mapped_file_t();
+
+    mapped_file_t(const mapped_file_t &) = delete;
+
+    mapped_file_t &operator=(const mapped_file_t &) = delete;
+
+    /**
+     * Map file
+     *
+     * @return false if file could not be opened or mapped
+     */
+    bool map(const std::string &path);
+
+    const char *data() const {
+        return static_cast<const char *>(addr);
+    }
+
+    size_t size() const {
+        return length;
+    }
+
+private:
+    void *addr = nullptr;
+    size_t length = 0;
+};
+
+/**
+ * Identity of a model: path, size and modification time, so that updated models do not hit entries of older ones
+ */
+std::string
+modelIdentity(const std::string &model_path);
+
+/**
+ * Cache key of parse of texts by model
+ *
+ * @param model_identity model identity
+ * @param hashes content hashes of input texts, as preprocessText returns them
+ * @param variant call variant (e.g. split or not)
+ * @return key, 16 hex digits
+ */
+std::string
+cacheKey(const std::string &model_identity, const std::vector<uint64_t> &hashes, const char *variant);
+
+/**
+ * Parse cache in a directory
+ */
+class parse_cache_t {
+public:
+    /**
+     * @param dir cache directory, created if missing
+     * @param max_bytes size bound of entries, unbounded if 0
+     */
+    parse_cache_t(const std::string &dir, size_t max_bytes);
+
+    /**
+     * Look entry up and map it
+     *
+     * @param key entry key
+     * @param mapping mapping to fill
+     * @param doc view of mapped document to fill
+     * @return false on a miss, corrupt entries being removed
+     */
+    bool lookup(const std::string &key, mapped_file_t &mapping, document_view_t &doc);
+
+    /**
+     * Store entry, evicting least recently used entries above size bound
+     *
+     * @return false if entry could not be written
+     */
+    bool store(const std::string &key, const document_view_t &doc);
+
+    /**
+     * Remove all entries
+     */
+    void clear();
+
+    const std::string dir;
+    const size_t max_bytes;
+
+private:
+    std::string pathOf(const std::string &key) const;
+
+    void evict();
+
+    std::mutex m;
+};
+
+#endif
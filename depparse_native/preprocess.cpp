@@ -0,0 +1,306 @@
+/* Copyright 2018
+ * Bernard Bou
+ * 1313ou@gmail.com */
+
+#include <cstring>
+
+#include "depparse_native/preprocess.h"
+
+using namespace std;
+
+// W O R D S
+
+static const uint64_t kOnes = 0x0101010101010101ULL;
+static const uint64_t kHighs = 0x8080808080808080ULL;
+
+static inline uint64_t load(const char *p) {
+    uint64_t w;
+    memcpy(&w, p, sizeof(w));
+    return w;
+}
+
+/**
+ * High bit set in each zero byte
+ */
+static inline uint64_t zeroBytes(uint64_t w) {
+    const uint64_t lows = ~kHighs;
+    return ~(((w & lows) + lows) | w | lows);
+}
+
+/**
+ * High bit set in each byte less than c, bytes being ASCII
+ */
+static inline uint64_t bytesLessThan(uint64_t w, unsigned char c) {
+    return ~(w + (0x80 - c) * kOnes) & kHighs;
+}
+
+// H A S H
+
+static const uint64_t kMul1 = 0x9E3779B97F4A7C15ULL;
+static const uint64_t kMul2 = 0xC2B2AE3D27D4EB4FULL;
+
+static inline uint64_t mixWord(uint64_t h, uint64_t w) {
+    h ^= w * kMul1;
+    h = (h << 31 | h >> 33) * kMul2;
+    return h;
+}
+
+static inline uint64_t finalize(uint64_t h, size_t n) {
+    h ^= n;
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+/**
+ * Hasher consuming a buffer in words as it grows, the tail being hashed zero-padded
+ */
+struct hasher_t {
+    uint64_t h = 0;
+    size_t done = 0;
+
+    /**
+     * Hash whole words, keeping the last keep bytes out
+     */
+    void consume(const string &buffer, size_t keep) {
+        while (buffer.size() >= done + sizeof(uint64_t) + keep) {
+            h = mixWord(h, load(buffer.data() + done));
+            done += sizeof(uint64_t);
+        }
+    }
+
+    uint64_t finish(const string &buffer) {
+        consume(buffer, 0);
+        if (done < buffer.size()) {
+            uint64_t w = 0;
+            memcpy(&w, buffer.data() + done, buffer.size() - done);
+            h = mixWord(h, w);
+        }
+        return finalize(h, buffer.size());
+    }
+};
+
+uint64_t
+contentHash(const char *data, size_t n) {
+    uint64_t h = 0;
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= n; i += sizeof(uint64_t))
+        h = mixWord(h, load(data + i));
+    if (i < n) {
+        uint64_t w = 0;
+        memcpy(&w, data + i, n - i);
+        h = mixWord(h, w);
+    }
+    return finalize(h, n);
+}
+
+// S E Q U E N C E S
+
+static inline bool isContinuation(unsigned char c) {
+    return (c & 0xC0) == 0x80;
+}
+
+static void appendUtf8(string &out, uint32_t cp) {
+    if (cp < 0x80) {
+        out += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+        out += static_cast<char>(0xC0 | cp >> 6);
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += static_cast<char>(0xE0 | cp >> 12);
+        out += static_cast<char>(0x80 | (cp >> 6 & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | cp >> 18);
+        out += static_cast<char>(0x80 | (cp >> 12 & 0x3F));
+        out += static_cast<char>(0x80 | (cp >> 6 & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+}
+
+static const uint32_t kReplacement = 0xFFFD;
+static const uint32_t kInvalid = 0xFFFFFFFF;
+
+/**
+ * Decode sequence at p, a surrogate pair as one code point
+ *
+ * @param length byte length of sequence, invalid sequences being one byte long except lone surrogates (one Java char)
+ * @return code point, kInvalid if sequence is invalid, 0 for C0 80
+ */
+static uint32_t decode(const unsigned char *p, size_t n, size_t &length) {
+    unsigned char c = p[0];
+    length = 1;
+    if (c < 0x80)
+        return c;
+    if (c == 0xC0 && n >= 2 && p[1] == 0x80) {
+        length = 2;
+        return 0;
+    }
+    if (c >= 0xC2 && c < 0xE0) {
+        if (n < 2 || !isContinuation(p[1]))
+            return kInvalid;
+        length = 2;
+        return (c & 0x1Fu) << 6 | (p[1] & 0x3Fu);
+    }
+    if (c >= 0xE0 && c < 0xF0) {
+        if (n < 3 || !isContinuation(p[1]) || !isContinuation(p[2]))
+            return kInvalid;
+        uint32_t cp = (c & 0x0Fu) << 12 | (p[1] & 0x3Fu) << 6 | (p[2] & 0x3Fu);
+        if (cp < 0x800)
+            return kInvalid;
+        if (cp >= 0xD800 && cp < 0xDC00) {
+            // high surrogate, to be followed by low surrogate
+            if (n < 6 || p[3] != 0xED || (p[4] & 0xF0) != 0xB0 || !isContinuation(p[5])) {
+                length = 3;
+                return kInvalid;
+            }
+            uint32_t low = (p[4] & 0x0Fu) << 6 | (p[5] & 0x3Fu);
+            length = 6;
+            return 0x10000 + ((cp - 0xD800) << 10) + low;
+        }
+        length = 3;
+        if (cp >= 0xDC00 && cp < 0xE000)
+            return kInvalid;
+        return cp;
+    }
+    if (c >= 0xF0 && c < 0xF5) {
+        if (n < 4 || !isContinuation(p[1]) || !isContinuation(p[2]) || !isContinuation(p[3]))
+            return kInvalid;
+        uint32_t cp = (c & 0x07u) << 18 | (p[1] & 0x3Fu) << 12 | (p[2] & 0x3Fu) << 6 | (p[3] & 0x3Fu);
+        if (cp < 0x10000 || cp > 0x10FFFF)
+            return kInvalid;
+        length = 4;
+        return cp;
+    }
+    return kInvalid;
+}
+
+static bool isSpace(uint32_t cp) {
+    switch (cp) {
+        case 0x09:
+        case 0x0A:
+        case 0x0B:
+        case 0x0C:
+        case 0x0D:
+        case 0x20:
+        case 0x85:
+        case 0xA0:
+        case 0x1680:
+        case 0x2028:
+        case 0x2029:
+        case 0x202F:
+        case 0x205F:
+        case 0x3000:
+            return true;
+        default:
+            return cp >= 0x2000 && cp <= 0x200A;
+    }
+}
+
+static uint32_t unquote(uint32_t cp) {
+    switch (cp) {
+        case 0x2018:    // left single quotation mark
+        case 0x2019:    // right single quotation mark
+        case 0x201A:    // single low-9 quotation mark
+        case 0x201B:    // single high-reversed-9 quotation mark
+        case 0x2032:    // prime
+            return '\'';
+        case 0x201C:    // left double quotation mark
+        case 0x201D:    // right double quotation mark
+        case 0x201E:    // double low-9 quotation mark
+        case 0x201F:    // double high-reversed-9 quotation mark
+        case 0x2033:    // double prime
+            return '"';
+        default:
+            return cp;
+    }
+}
+
+// P R E P R O C E S S
+
+uint64_t
+preprocessText(const char *in, size_t n, int32_t flags, string &out, size_t *repairs) {
+    const bool repair = (flags & kPreprocessRepair) != 0;
+    const bool spaces = (flags & kPreprocessWhitespace) != 0;
+    const bool quotes = (flags & kPreprocessQuotes) != 0;
+    const auto *bytes = reinterpret_cast<const unsigned char *>(in);
+
+    out.clear();
+    out.reserve(n);
+    hasher_t hasher;
+    size_t repaired = 0;
+
+    // whether last output is a collapsible space (leading spaces are dropped)
+    bool after_space = true;
+
+    size_t i = 0;
+    while (i < n) {
+        // ASCII words, taken as they are unless they hold spaces to normalize, appended as one run
+        size_t run = i;
+        while (run + sizeof(uint64_t) <= n) {
+            uint64_t w = load(in + run);
+            if ((w & kHighs) != 0)
+                break;
+            if (spaces) {
+                uint64_t blanks = zeroBytes(w ^ (' ' * kOnes));
+                // no control char, no two spaces in a row, no space after a space
+                if (bytesLessThan(w, ' ') != 0 || (blanks & blanks << 8) != 0 || (after_space && (blanks & 0x80) != 0))
+                    break;
+                after_space = (blanks >> 56) != 0;
+            }
+            run += sizeof(uint64_t);
+        }
+        if (run > i) {
+            out.append(in + i, run - i);
+            i = run;
+            hasher.consume(out, sizeof(uint64_t));
+            continue;
+        }
+
+        // one sequence, proper UTF-8 unless invalid, a surrogate pair or U+0000
+        size_t length;
+        uint32_t cp = decode(bytes + i, n - i, length);
+        if (cp == kInvalid || cp == 0 || length == 6) {
+            if (!repair) {
+                // left as is, a pair as its first half
+                size_t raw = length == 6 ? 3 : length;
+                out.append(in + i, raw);
+                i += raw;
+                after_space = false;
+                continue;
+            }
+            if (cp == kInvalid)
+                cp = kReplacement;
+            else if (cp == 0)
+                cp = ' ';
+            repaired++;
+        }
+        i += length;
+
+        if (spaces && isSpace(cp)) {
+            if (!after_space) {
+                out += ' ';
+                after_space = true;
+            }
+            continue;
+        }
+        if (quotes)
+            cp = unquote(cp);
+        after_space = false;
+        if (cp < 0x80)
+            out += static_cast<char>(cp);
+        else
+            appendUtf8(out, cp);
+    }
+
+    // trailing space
+    if (spaces && !out.empty() && out.back() == ' ')
+        out.pop_back();
+
+    if (repairs != nullptr)
+        *repairs += repaired;
+    return hasher.finish(out);
+}
@@ -0,0 +1,53 @@
+/* Copyright 2018
+ * Bernard Bou
+ * 1313ou@gmail.com */
+
+#ifndef DEPPARSE_PREPROCESS_H
+#define DEPPARSE_PREPROCESS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// input preprocessing ahead of backend parse, one pass per text that validates, normalizes and hashes it.
+// ASCII runs are processed 8 bytes at a time (one 64-bit word tested with bit tricks), other sequences one at a time.
+//
+// Input comes from GetStringUTFChars as modified UTF-8: supplementary chars are surrogate pairs encoded as two 3-byte
+// sequences and U+0000 is C0 80. Repair turns pairs into 4-byte UTF-8 sequences, U+0000 into a space, and invalid
+// or lone surrogate sequences into U+FFFD, so that char offsets into the Java text are unchanged (see char_indices.h).
+// Whitespace normalization changes char offsets: they then refer to the normalized text that parse results hold.
+
+const int32_t kPreprocessRepair = 1;        // repair UTF-8
+const int32_t kPreprocessWhitespace = 2;    // map Unicode spaces, tabs and line breaks to ' ', collapse runs, trim
+const int32_t kPreprocessQuotes = 4;        // map typographic single and double quotes to ' and "
+const int32_t kPreprocessDefault = kPreprocessRepair;
+
+/**
+ * Hash of content, as computed by preprocessText
+ *
+ * @param data bytes
+ * @param n number of bytes
+ * @return 64-bit hash
+ */
+uint64_t
+contentHash(const char *data, size_t n);
+
+inline uint64_t contentHash(const std::string &text) {
+    return contentHash(text.data(), text.size());
+}
+
+/**
+ * Preprocess text
+ *
+ * @param in text, modified UTF-8
+ * @param n byte size of text
+ * @param flags kPreprocess* flags
+ * @param out preprocessed text to fill
+ * @param repairs number of repaired sequences to add to, if not null
+ * @return content hash of preprocessed text
+ */
+uint64_t
+preprocessText(const char *in, size_t n, int32_t flags, std::string &out, size_t *repairs = nullptr);
+
+#endif
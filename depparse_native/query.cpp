@@ -0,0 +1,351 @@
+/* Copyright 2018
+ * Bernard Bou
+ * 1313ou@gmail.com */
+
+#include <cstring>
+
+#include "depparse_native/query.h"
+#include "depparse_native/tree_index.h"
+
+using namespace std;
+
+// P A R S E R
+
+/**
+ * Recursive descent parser, fills query nodes in pattern order
+ */
+class query_parser_t {
+public:
+    query_parser_t(const char *pattern, query_t &query, string &error) : start(pattern), p(pattern), query(query), error(error) {
+    }
+
+    bool parse() {
+        query.nodes.clear();
+        if (!parsePattern(-1, kQueryRoot, string()))
+            return false;
+        skipSpaces();
+        if (*p != '\0')
+            return fail("unexpected character");
+        return true;
+    }
+
+private:
+    bool parsePattern(int32_t parent, query_relation_t relation, const string &label) {
+        auto node = static_cast<int32_t>(query.nodes.size());
+        if (!parseNode(parent, relation, label))
+            return false;
+        while (true) {
+            skipSpaces();
+            if (*p != '>' && *p != '<')
+                return true;
+
+            // op
+            query_relation_t r;
+            if (p[0] == '>') {
+                r = p[1] == '>' ? kQueryDescendant : kQueryChild;
+            } else {
+                r = p[1] == '<' ? kQueryAncestor : kQueryHead;
+            }
+            p += r == kQueryDescendant || r == kQueryAncestor ? 2 : 1;
+
+            // label
+            const char *l = p;
+            while (*p != '\0' && strchr(" \t{()<>", *p) == nullptr)
+                p++;
+            string rlabel(l, p);
+            if (!rlabel.empty() && (r == kQueryDescendant || r == kQueryAncestor))
+                return fail("label not allowed on '>>' and '<<'");
+
+            // target
+            skipSpaces();
+            if (*p == '(') {
+                p++;
+                if (!parsePattern(node, r, rlabel))
+                    return false;
+                skipSpaces();
+                if (*p != ')')
+                    return fail("expected ')'");
+                p++;
+            } else if (!parseNode(node, r, rlabel)) {
+                return false;
+            }
+        }
+    }
+
+    bool parseNode(int32_t parent, query_relation_t relation, const string &label) {
+        skipSpaces();
+        if (*p != '{')
+            return fail("expected '{'");
+        p++;
+        query.nodes.emplace_back();
+        query_node_t &node = query.nodes.back();
+        node.parent = parent;
+        node.relation = relation;
+        node.label = label;
+        while (true) {
+            skipSpaces();
+            if (*p == '}') {
+                p++;
+                return true;
+            }
+            query_test_t test;
+            if (!parseTest(test))
+                return false;
+            query.nodes.back().tests.push_back(test);
+            skipSpaces();
+            if (*p == ';')
+                p++;
+            else if (*p != '}')
+                return fail("expected ';' or '}'");
+        }
+    }
+
+    bool parseTest(query_test_t &test) {
+        test.negated = *p == '!';
+        if (test.negated) {
+            p++;
+            skipSpaces();
+        }
+        const char *a = p;
+        while (*p >= 'a' && *p <= 'z')
+            p++;
+        string attr(a, p);
+        if (attr == "word")
+            test.attr = kQueryWord;
+        else if (attr == "lemma")
+            test.attr = kQueryLemma;
+        else if (attr == "upos")
+            test.attr = kQueryUPos;
+        else if (attr == "xpos")
+            test.attr = kQueryXPos;
+        else if (attr == "category")
+            test.attr = kQueryCategory;
+        else if (attr == "tag")
+            test.attr = kQueryTag;
+        else if (attr == "label")
+            test.attr = kQueryLabel;
+        else {
+            p = a;
+            return fail("unknown attribute");
+        }
+        skipSpaces();
+        if (*p != ':')
+            return fail("expected ':'");
+        p++;
+        while (true) {
+            skipSpaces();
+            const char *v = p;
+            while (*p != '\0' && strchr("|;}", *p) == nullptr)
+                p++;
+            const char *e = p;
+            while (e > v && (e[-1] == ' ' || e[-1] == '\t'))
+                e--;
+            query_value_t value;
+            value.prefix = e > v && e[-1] == '*';
+            value.text.assign(v, value.prefix ? e - 1 : e);
+            test.values.push_back(value);
+            if (*p != '|')
+                break;
+            p++;
+        }
+        if (*p == '\0')
+            return fail("expected '}'");
+        return true;
+    }
+
+    void skipSpaces() {
+        while (*p == ' ' || *p == '\t')
+            p++;
+    }
+
+    bool fail(const char *message) {
+        error = message;
+        error += " at ";
+        error += to_string(p - start);
+        return false;
+    }
+
+    const char *const start;
+    const char *p;
+    query_t &query;
+    string &error;
+};
+
+bool
+compileQuery(const char *pattern, query_t &query, string &error) {
+    query_parser_t parser(pattern, query, error);
+    return parser.parse();
+}
+
+// M A T C H E R
+
+static const char *attrOf(const document_view_t &doc, const doc_token_t &token, query_attr_t attr) {
+    switch (attr) {
+        case kQueryWord:
+            return doc.str(token.word);
+        case kQueryLemma:
+            return doc.str(token.lemma);
+        case kQueryUPos:
+            return doc.str(token.upostag != kEmptyString ? token.upostag : token.category);
+        case kQueryXPos:
+            return doc.str(token.xpostag);
+        case kQueryCategory:
+            return doc.str(token.category);
+        case kQueryTag:
+            return doc.str(token.tag);
+        case kQueryLabel:
+            return doc.str(token.label);
+    }
+    return nullptr;
+}
+
+static bool matchesValue(const char *s, const query_value_t &value) {
+    if (value.prefix)
+        return strncmp(s, value.text.c_str(), value.text.size()) == 0;
+    return strcmp(s, value.text.c_str()) == 0;
+}
+
+static bool matchesTests(const document_view_t &doc, const doc_token_t &token, const query_node_t &node) {
+    for (const auto &test: node.tests) {
+        const char *s = attrOf(doc, token, test.attr);
+        if (s == nullptr)
+            s = "";
+        bool matched = false;
+        for (const auto &value: test.values) {
+            if (matchesValue(s, value)) {
+                matched = true;
+                break;
+            }
+        }
+        if (matched == test.negated)
+            return false;
+    }
+    return true;
+}
+
+/**
+ * Backtracking matcher over one sentence
+ */
+class query_matcher_t {
+public:
+    query_matcher_t(const query_t &query, const document_view_t &doc, vector<int32_t> &matches, int32_t maxMatches)
+            : query(query), doc(doc), matches(matches), maxMatches(maxMatches), assigned(query.nodes.size(), -1) {
+    }
+
+    void matchSentence(int32_t sentenceIndex) {
+        const doc_sentence_t &sentence = doc.sentences[sentenceIndex];
+        this->sentenceIndex = sentenceIndex;
+        tokens = doc.tokensOf(sentence);
+        n = sentence.token_count;
+        used.assign(n, 0);
+        if (query.nodes.size() > 1)
+            buildTreeIndex(doc, sentenceIndex, index);
+        assign(0);
+    }
+
+    bool full() const {
+        return maxMatches > 0 && count >= maxMatches;
+    }
+
+    int32_t count = 0;
+
+private:
+    void assign(size_t k) {
+        if (k == query.nodes.size()) {
+            matches.push_back(sentenceIndex);
+            matches.insert(matches.end(), assigned.begin(), assigned.end());
+            count++;
+            return;
+        }
+        const query_node_t &node = query.nodes[k];
+        if (node.parent < 0) {
+            for (int32_t i = 0; i < n && !full(); i++)
+                tryAssign(k, i);
+            return;
+        }
+
+        const int32_t a = assigned[node.parent];
+        switch (node.relation) {
+            case kQueryChild:
+                for (int32_t c = index.child_offsets[a]; c < index.child_offsets[a + 1] && !full(); c++)
+                    tryAssign(k, index.children[c]);
+                break;
+
+            case kQueryHead:
+                if (!node.label.empty() && node.label != doc.str(tokens[a].label))
+                    break;
+                if (index.parents[a] != -1)
+                    tryAssign(k, index.parents[a]);
+                break;
+
+            case kQueryDescendant: {
+                // spans are only meaningful for tokens reached from a root
+                bool cyclic = (index.flags & kTreeHasCycle) != 0;
+                int32_t from = cyclic ? 0 : index.span_starts[a];
+                int32_t to = cyclic ? n - 1 : index.span_ends[a];
+                bool projective = !cyclic && (index.flags & kTreeNonProjective) == 0;
+                for (int32_t d = from; d <= to && !full(); d++) {
+                    if (d != a && (projective || isAncestor(a, d)))
+                        tryAssign(k, d);
+                }
+                break;
+            }
+
+            case kQueryAncestor: {
+                int32_t i = index.parents[a];
+                for (int32_t steps = 0; i != -1 && steps < n && !full(); steps++, i = index.parents[i])
+                    tryAssign(k, i);
+                break;
+            }
+
+            case kQueryRoot:
+                break;
+        }
+    }
+
+    void tryAssign(size_t k, int32_t i) {
+        if (used[i])
+            return;
+        const query_node_t &node = query.nodes[k];
+        const doc_token_t &token = tokens[i];
+        if (node.relation == kQueryChild && !node.label.empty() && node.label != doc.str(token.label))
+            return;
+        if (!matchesTests(doc, token, node))
+            return;
+        used[i] = 1;
+        assigned[k] = i;
+        assign(k + 1);
+        used[i] = 0;
+    }
+
+    bool isAncestor(int32_t a, int32_t d) const {
+        int32_t i = index.parents[d];
+        for (int32_t steps = 0; i != -1 && steps < n; steps++, i = index.parents[i]) {
+            if (i == a)
+                return true;
+        }
+        return false;
+    }
+
+    const query_t &query;
+    const document_view_t &doc;
+    vector<int32_t> &matches;
+    const int32_t maxMatches;
+    vector<int32_t> assigned;
+    vector<char> used;
+    tree_index_t index;
+    const doc_token_t *tokens = nullptr;
+    int32_t sentenceIndex = 0;
+    int32_t n = 0;
+};
+
+int32_t
+matchQuery(const query_t &query, const document_view_t &doc, vector<int32_t> &matches, int32_t maxMatches) {
+    if (query.nodes.empty())
+        return 0;
+    query_matcher_t matcher(query, doc, matches, maxMatches);
+    for (int32_t s = 0; s < doc.sentence_count && !matcher.full(); s++) {
+        matcher.matchSentence(s);
+    }
+    return matcher.count;
+}
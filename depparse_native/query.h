@@ -0,0 +1,100 @@
+/* Copyright 2018
+ * Bernard Bou
+ * 1313ou@gmail.com */
+
+#ifndef DEPPARSE_QUERY_H
+#define DEPPARSE_QUERY_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "depparse_native/document.h"
+
+// structural queries over dependency trees, Semgrex-like syntax:
+//
+// pattern  := node relation*
+// relation := op [label] (node | '(' pattern ')')
+// op       := '>' (child) | '<' (head) | '>>' (descendant) | '<<' (ancestor)
+// node     := '{' [test (';' test)*] '}'
+// test     := ['!'] attr ':' value ('|' value)*
+// attr     := word | lemma | upos | xpos | category | tag | label
+// value    := text, matched exactly, or prefix when ending with '*'
+//
+// Relations following a node all apply to that node:
+// {upos:VERB} >nsubj {} >obj {} matches a verb with both a subject and an object,
+// {upos:VERB} >obj ({} >amod {}) matches a verb whose object has an adjectival modifier.
+// A label after '>' constrains the dependent's label, after '<' the node's own label.
+// Matched tokens are distinct.
+
+enum query_attr_t {
+    kQueryWord,
+    kQueryLemma,
+    kQueryUPos,         // falls back to category when the backend has no upostag
+    kQueryXPos,
+    kQueryCategory,
+    kQueryTag,
+    kQueryLabel,
+};
+
+enum query_relation_t {
+    kQueryRoot,         // first node, not related
+    kQueryChild,        // node is child of its pattern parent
+    kQueryHead,         // node is head of its pattern parent
+    kQueryDescendant,   // node is descendant of its pattern parent
+    kQueryAncestor,     // node is ancestor of its pattern parent
+};
+
+struct query_value_t {
+    std::string text;
+    bool prefix;
+};
+
+struct query_test_t {
+    query_attr_t attr;
+    bool negated;
+    std::vector<query_value_t> values;  // alternatives
+};
+
+struct query_node_t {
+    int32_t parent;                     // pattern node this node is related to, -1 for first node
+    query_relation_t relation;
+    std::string label;                  // label constraint of relation, possibly empty
+    std::vector<query_test_t> tests;
+};
+
+/**
+ * Compiled query, nodes in pattern order
+ */
+struct query_t {
+    std::vector<query_node_t> nodes;
+
+    int32_t width() const {
+        return 1 + static_cast<int32_t>(nodes.size());
+    }
+};
+
+/**
+ * Compile query
+ *
+ * @param pattern pattern
+ * @param query query to fill
+ * @param error error message with position when pattern is malformed
+ * @return false if pattern is malformed
+ */
+bool
+compileQuery(const char *pattern, query_t &query, std::string &error);
+
+/**
+ * Match query against all sentences of document
+ *
+ * @param query compiled query
+ * @param doc document
+ * @param matches flattened match tuples to append to, width() ints each: [sentence index, token matching node 0, token matching node 1, ...], token indices in sentence
+ * @param maxMatches maximum number of matches, unlimited if <= 0
+ * @return number of matches
+ */
+int32_t
+matchQuery(const query_t &query, const document_view_t &doc, std::vector<int32_t> &matches, int32_t maxMatches);
+
+#endif
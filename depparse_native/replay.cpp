@@ -0,0 +1,321 @@
+/* Copyright 2018
+ * Bernard Bou
+ * 1313ou@gmail.com */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <unistd.h>
+
+#include "depparse_native/replay.h"
+#include "depparse_native/trace.h"
+#include "depparse_native/document.h"
+
+using namespace std;
+
+// R E A D
+
+/**
+ * Cursor over a record
+ */
+struct record_reader_t {
+    const char *p;
+    const char *end;
+
+    template<typename T>
+    bool get(T &value) {
+        if (end - p < static_cast<ptrdiff_t>(sizeof(T)))
+            return false;
+        memcpy(&value, p, sizeof(T));
+        p += sizeof(T);
+        return true;
+    }
+
+    bool get(string &value, size_t n) {
+        if (static_cast<size_t>(end - p) < n)
+            return false;
+        value.assign(p, n);
+        p += n;
+        return true;
+    }
+};
+
+static bool readCall(record_reader_t &in, bool redacted, trace_call_t &call) {
+    uint8_t failed, name_length;
+    uint32_t count;
+    if (!in.get(call.model) || !in.get(call.handle) || !in.get(call.start) || !in.get(call.duration) ||
+        !in.get(failed) || !in.get(name_length) || !in.get(call.call, name_length) || !in.get(count))
+        return false;
+    call.failed = failed != 0;
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t length;
+        if (!in.get(length))
+            return false;
+        call.lengths.push_back(length);
+        if (redacted) {
+            uint64_t hash;
+            if (!in.get(hash))
+                return false;
+            call.hashes.push_back(hash);
+        } else {
+            call.texts.emplace_back();
+            if (!in.get(call.texts.back(), length))
+                return false;
+        }
+    }
+    return true;
+}
+
+bool
+readTrace(const string &path, trace_t &trace, string &error) {
+    FILE *file = fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        error = "cannot open " + path;
+        return false;
+    }
+
+    // header
+    char magic[sizeof(kTraceMagic)];
+    uint32_t flags;
+    if (fread(magic, 1, sizeof(magic), file) != sizeof(magic) || memcmp(magic, kTraceMagic, sizeof(magic)) != 0 ||
+        fread(&flags, sizeof(flags), 1, file) != 1) {
+        fclose(file);
+        error = path + " is not a trace";
+        return false;
+    }
+    trace.redacted = (flags & kTraceRedacted) != 0;
+
+    // records, the last one possibly cut short if the app died while recording
+    vector<char> record;
+    uint32_t size;
+    while (fread(&size, sizeof(size), 1, file) == 1) {
+        record.resize(size);
+        if (fread(record.data(), 1, size, file) != size)
+            break;
+        record_reader_t in{record.data(), record.data() + size};
+        uint8_t type;
+        if (!in.get(type))
+            continue;
+        if (type == kTraceModel) {
+            uint32_t id;
+            uint16_t length;
+            string identity;
+            if (in.get(id) && in.get(length) && in.get(identity, length)) {
+                if (trace.models.size() <= id)
+                    trace.models.resize(id + 1);
+                trace.models[id] = identity;
+            }
+        } else if (type == kTraceCall) {
+            trace_call_t call;
+            if (readCall(in, trace.redacted, call))
+                trace.calls.push_back(std::move(call));
+        }
+        // other record types are skipped
+    }
+    fclose(file);
+
+    // calls are recorded as they end
+    stable_sort(trace.calls.begin(), trace.calls.end(), [](const trace_call_t &a, const trace_call_t &b) {
+        return a.start < b.start;
+    });
+    return true;
+}
+
+// S T U B   B A C K E N D
+
+static long stubLoad(const char *model) {
+    (void) model;
+    return 1;
+}
+
+static void stubUnload(long handle) {
+    (void) handle;
+}
+
+/**
+ * Stub parse: whitespace tokens into a document, no model, so that replay measures call pattern and conversion costs only
+ */
+static size_t stubParse(long handle, const vector<string> &texts) {
+    (void) handle;
+    document_t doc;
+    for (const auto &text: texts) {
+        doc_sentence_t sentence{};
+        sentence.text = doc.strings.add(text);
+        sentence.docid = kEmptyString;
+        sentence.first_token = static_cast<int32_t>(doc.tokens.size());
+        size_t i = 0;
+        while (i < text.size()) {
+            size_t j = text.find_first_of(" \t\n", i);
+            if (j == string::npos)
+                j = text.size();
+            if (j > i) {
+                int32_t head = static_cast<int32_t>(doc.tokens.size()) - sentence.first_token - 1;
+                doc_token_t &token = newToken(doc);
+                token.word = doc.strings.add(text.data() + i, j - i);
+                token.start = static_cast<int32_t>(i);
+                token.end = static_cast<int32_t>(j - 1);
+                token.head = head;
+                token.label = doc.strings.intern(head < 0 ? "root" : "dep");
+            }
+            i = j + 1;
+        }
+        sentence.token_count = static_cast<int32_t>(doc.tokens.size()) - sentence.first_token;
+        doc.sentences.push_back(sentence);
+    }
+    return doc.tokens.size();
+}
+
+static const replay_backend_t kStubBackend = {"stub", stubLoad, stubUnload, stubParse};
+
+// O P T I O N S
+
+struct replay_options_t {
+    string model;
+    string trace;
+    int repeat = 1;
+    bool paced = false;
+    bool quiet = false;
+};
+
+static void usage(const char *prog, const replay_backend_t *backend) {
+    fprintf(stderr,
+            "usage: %s [-m model] [-r repeat] [-p] [-q] trace\n"
+            "  -m model   model to replay against%s\n"
+            "  -r repeat  replays of each call, the fastest being reported (default: 1)\n"
+            "  -p         paced: calls start at their recorded offsets, else back to back\n"
+            "  -q         summary only\n"
+            "  trace      trace recorded by JNI.startTrace / JNI2.startTrace\n"
+            "prints: one line per call (index, call, texts, bytes, recorded us, replayed us, difference us, ratio), then a summary\n",
+            prog, backend == nullptr ? " (ignored: stub backend only)" : ", stub backend if none");
+}
+
+static bool parseOptions(int argc, char *argv[], replay_options_t &options) {
+    int c;
+    while ((c = getopt(argc, argv, "m:r:pqh")) != -1) {
+        switch (c) {
+            case 'm':
+                options.model = optarg;
+                break;
+            case 'r':
+                options.repeat = atoi(optarg);
+                break;
+            case 'p':
+                options.paced = true;
+                break;
+            case 'q':
+                options.quiet = true;
+                break;
+            default:
+                return false;
+        }
+    }
+    if (optind != argc - 1)
+        return false;
+    options.trace = argv[optind];
+    return options.repeat > 0;
+}
+
+// R E P L A Y
+
+/**
+ * Texts of call, synthesized to recorded lengths when redacted
+ */
+static void textsOf(const trace_call_t &call, vector<string> &texts) {
+    static const char kFiller[] = "The quick brown fox jumps over the lazy dog. ";
+    if (!call.texts.empty() || call.lengths.empty()) {
+        texts = call.texts;
+        return;
+    }
+    texts.clear();
+    for (uint32_t length: call.lengths) {
+        string text;
+        text.reserve(length);
+        while (text.size() < length)
+            text.append(kFiller, min(sizeof(kFiller) - 1, length - text.size()));
+        texts.push_back(std::move(text));
+    }
+}
+
+static double percentile(vector<double> values, double p) {
+    if (values.empty())
+        return 0;
+    sort(values.begin(), values.end());
+    return values[min(values.size() - 1, static_cast<size_t>(p * static_cast<double>(values.size())))];
+}
+
+int
+runReplay(int argc, char *argv[], const replay_backend_t *backend) {
+    replay_options_t options;
+    if (!parseOptions(argc, argv, options)) {
+        usage(argv[0], backend);
+        return 1;
+    }
+
+    trace_t trace;
+    string error;
+    if (!readTrace(options.trace, trace, error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    for (size_t i = 0; i < trace.models.size(); i++)
+        fprintf(stderr, "model %zu: %s\n", i, trace.models[i].c_str());
+    fprintf(stderr, "%zu calls%s\n", trace.calls.size(), trace.redacted ? ", redacted: replayed on synthetic texts of recorded lengths" : "");
+
+    // backend, all recorded models being served by the one given
+    const replay_backend_t &replay = backend != nullptr && !options.model.empty() ? *backend : kStubBackend;
+    long handle = replay.load(options.model.c_str());
+    if (handle == 0) {
+        fprintf(stderr, "cannot load %s\n", options.model.c_str());
+        return 1;
+    }
+    if (trace.models.size() > 1)
+        fprintf(stderr, "%zu models recorded, all replayed with %s\n", trace.models.size(), options.model.empty() ? replay.name : options.model.c_str());
+
+    // calls
+    vector<double> ratios;
+    int64_t recorded_total = 0;
+    int64_t replayed_total = 0;
+    size_t tokens_total = 0;
+    vector<string> texts;
+    const auto origin = chrono::steady_clock::now();
+    for (size_t i = 0; i < trace.calls.size(); i++) {
+        const trace_call_t &call = trace.calls[i];
+        textsOf(call, texts);
+        size_t bytes = 0;
+        for (uint32_t length: call.lengths)
+            bytes += length;
+
+        if (options.paced)
+            this_thread::sleep_until(origin + chrono::microseconds(call.start));
+
+        int64_t best = INT64_MAX;
+        size_t tokens = 0;
+        for (int r = 0; r < options.repeat; r++) {
+            auto t0 = chrono::steady_clock::now();
+            tokens = replay.parse(handle, texts);
+            auto t1 = chrono::steady_clock::now();
+            best = min(best, static_cast<int64_t>(chrono::duration_cast<chrono::microseconds>(t1 - t0).count()));
+        }
+        tokens_total += tokens;
+        recorded_total += call.duration;
+        replayed_total += best;
+        double ratio = call.duration > 0 ? static_cast<double>(best) / static_cast<double>(call.duration) : 0;
+        if (call.duration > 0)
+            ratios.push_back(ratio);
+        if (!options.quiet)
+            printf("%zu\t%s\t%zu\t%zu\t%lld\t%lld\t%lld\t%.2f%s\n",
+                   i, call.call.c_str(), call.lengths.size(), bytes,
+                   static_cast<long long>(call.duration), static_cast<long long>(best), static_cast<long long>(best - call.duration),
+                   ratio, call.failed ? "\tfailed" : "");
+    }
+    replay.unload(handle);
+
+    printf("%s\tcalls=%zu\ttokens=%zu\trecorded_us=%lld\treplayed_us=%lld\tmedian_ratio=%.2f\tp90_ratio=%.2f\n",
+           replay.name, trace.calls.size(), tokens_total,
+           static_cast<long long>(recorded_total), static_cast<long long>(replayed_total),
+           percentile(ratios, 0.5), percentile(ratios, 0.9));
+    return 0;
+}
@@ -0,0 +1,84 @@
+/* Copyright 2018
+ * Bernard Bou
+ * 1313ou@gmail.com */
+
+#ifndef DEPPARSE_REPLAY_H
+#define DEPPARSE_REPLAY_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// host replayer of traces recorded by the JNI libraries (see trace.h):
+// the recorded calls are driven, in start order, against a model through a backend, or against the stub backend,
+// and the latency of each replayed call is set against the recorded one.
+// Redacted traces are replayed on synthetic texts of the recorded lengths.
+
+/**
+ * Recorded call
+ */
+struct trace_call_t {
+    uint32_t model;                 // model id
+    uint64_t handle;                // Java handle
+    int64_t start;                  // us since trace start
+    int64_t duration;               // us
+    bool failed;
+    std::string call;               // call name
+    std::vector<std::string> texts; // empty when redacted
+    std::vector<uint32_t> lengths;  // byte lengths of texts
+    std::vector<uint64_t> hashes;   // hashes of texts when redacted
+};
+
+/**
+ * Recorded trace
+ */
+struct trace_t {
+    bool redacted = false;
+    std::vector<std::string> models;    // model identity by id
+    std::vector<trace_call_t> calls;    // in start order
+};
+
+/**
+ * Read trace
+ *
+ * @param path trace file
+ * @param trace trace to fill
+ * @param error error message
+ * @return false if file could not be read or is not a trace, a truncated last record being dropped
+ */
+bool
+readTrace(const std::string &path, trace_t &trace, std::string &error);
+
+/**
+ * Backend replayed calls are driven against
+ */
+struct replay_backend_t {
+    const char *name;
+
+    /**
+     * @return backend handle, 0 on failure
+     */
+    long (*load)(const char *model);
+
+    void (*unload)(long handle);
+
+    /**
+     * Parse and convert texts
+     *
+     * @return number of tokens
+     */
+    size_t (*parse)(long handle, const std::vector<std::string> &texts);
+};
+
+/**
+ * Run replayer
+ *
+ * usage: [-m model] [-r repeat] [-p] [-q] trace
+ *
+ * @param backend model backend, null if only the stub backend is available
+ * @return exit code
+ */
+int
+runReplay(int argc, char *argv[], const replay_backend_t *backend);
+
+#endif
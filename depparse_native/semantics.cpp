@@ -0,0 +1,225 @@
+/* Copyright 2018
+ * Bernard Bou
+ * 1313ou@gmail.com */
+
+#include <cstring>
+#include <thread>
+#include <unordered_map>
+#include <algorithm>
+
+#include "depparse_native/semantics.h"
+
+using namespace std;
+
+// label masks: one bit per class, plus the root label and whether the mask is known
+static const uint8_t kMaskRoot = 1 << 6;
+static const uint8_t kMaskKnown = 1 << 7;
+
+static inline bool hasClass(uint8_t mask, semantic_class_t c) {
+    return (mask & (1 << c)) != 0;
+}
+
+// L A B E L S
+
+/**
+ * Class masks of label string ids used in document
+ */
+static void classifyLabels(const document_view_t &doc, const semantic_labels_t &labels, vector<uint8_t> &masks) {
+    unordered_map<string, uint8_t> label2mask;
+    for (int c = 0; c < kClassCount; c++) {
+        for (const string &label: labels.classes[c]) {
+            label2mask[label] |= static_cast<uint8_t>(1 << c);
+        }
+    }
+
+    masks.assign(static_cast<size_t>(doc.string_count), 0);
+    for (int32_t i = 0; i < doc.token_count; i++) {
+        int32_t label = doc.tokens[i].label;
+        if (label < 0 || (masks[label] & kMaskKnown) != 0)
+            continue;
+        const char *s = doc.str(label);
+        uint8_t mask = kMaskKnown;
+        auto it = label2mask.find(s);
+        if (it != label2mask.end())
+            mask |= it->second;
+        if (strcmp(s, "root") == 0)
+            mask |= kMaskRoot;
+        masks[label] = mask;
+    }
+}
+
+// A N A L Y Z E R
+
+/**
+ * Analyzer of one sentence at a time, buffers being reused across sentences
+ */
+class sentence_analyzer_t {
+public:
+    sentence_analyzer_t(const document_view_t &doc, const vector<uint8_t> &masks, vector<int32_t> &relations) : doc(doc), masks(masks), relations(relations) {
+    }
+
+    void analyze(int32_t sentenceIndex) {
+        const doc_sentence_t &sentence = doc.sentences[sentenceIndex];
+        s = sentenceIndex;
+        tokens = doc.tokensOf(sentence);
+        n = sentence.token_count;
+        index();
+
+        // explore from roots
+        visited.assign(static_cast<size_t>(n), 0);
+        for (int32_t i = 0; i < n; i++) {
+            if (tokens[i].head == -1 && (maskOf(i) & kMaskRoot) != 0) {
+                visited[i] = 1;
+                analyzePredicate(i);
+            }
+        }
+    }
+
+private:
+    uint8_t maskOf(int32_t token) const {
+        int32_t label = tokens[token].label;
+        return label < 0 ? 0 : masks[label];
+    }
+
+    /**
+     * Dependents of each token whose label has some class, in token order (CSR)
+     */
+    void index() {
+        offsets.assign(static_cast<size_t>(n) + 1, 0);
+        for (int32_t i = 0; i < n; i++) {
+            int32_t head = tokens[i].head;
+            if (head >= 0 && head < n && (maskOf(i) & ~(kMaskKnown | kMaskRoot)) != 0)
+                offsets[head + 1]++;
+        }
+        for (int32_t i = 0; i < n; i++) {
+            offsets[i + 1] += offsets[i];
+        }
+        dependents.resize(static_cast<size_t>(offsets[n]));
+        fill.assign(offsets.begin(), offsets.end() - 1);
+        for (int32_t i = 0; i < n; i++) {
+            int32_t head = tokens[i].head;
+            if (head >= 0 && head < n && (maskOf(i) & ~(kMaskKnown | kMaskRoot)) != 0)
+                dependents[fill[head]++] = i;
+        }
+    }
+
+    void emit(int32_t predicate, semantic_role_t role, int32_t argument) {
+        relations.push_back(s);
+        relations.push_back(predicate);
+        relations.push_back(role);
+        relations.push_back(argument);
+    }
+
+    void analyzePredicate(int32_t predicate) {
+        // predicate-subject, predicate-object
+        analyzeArguments(predicate, kClassSubject, kRoleSubject);
+        analyzeArguments(predicate, kClassObject, kRoleObject);
+
+        // predicate-predicate, term-predicate
+        analyzeModifiers(predicate);
+    }
+
+    void analyzeTerm(int32_t term) {
+        analyzeModifiers(term);
+    }
+
+    /**
+     * Relations to arguments, each argument being explored as term right after its relation
+     */
+    void analyzeArguments(int32_t predicate, semantic_class_t c, semantic_role_t role) {
+        for (int32_t k = offsets[predicate]; k < offsets[predicate + 1]; k++) {
+            int32_t argument = dependents[k];
+            if (!hasClass(maskOf(argument), c))
+                continue;
+            emit(predicate, role, argument);
+            if (!visited[argument]) {
+                visited[argument] = 1;
+                analyzeTerm(argument);
+            }
+        }
+    }
+
+    /**
+     * Relations to modifying predicates, all yielded before modifiers are explored as predicates
+     */
+    void analyzeModifiers(int32_t governor) {
+        const int32_t from = offsets[governor];
+        const int32_t to = offsets[governor + 1];
+
+        // predicate-predicate
+        for (int32_t k = from; k < to; k++) {
+            if (hasClass(maskOf(dependents[k]), kClassPredicateModifier))
+                emit(governor, kRolePredicate, dependents[k]);
+        }
+        exploreModifiers(from, to, kClassPredicateModifier);
+
+        // term-predicate
+        for (int32_t k = from; k < to; k++) {
+            if (hasClass(maskOf(dependents[k]), kClassTermModifier))
+                emit(dependents[k], kRoleTerm, governor);
+        }
+        exploreModifiers(from, to, kClassTermModifier);
+    }
+
+    void exploreModifiers(int32_t from, int32_t to, semantic_class_t c) {
+        for (int32_t k = from; k < to; k++) {
+            int32_t predicate = dependents[k];
+            if (hasClass(maskOf(predicate), c) && !visited[predicate]) {
+                visited[predicate] = 1;
+                analyzePredicate(predicate);
+            }
+        }
+    }
+
+    const document_view_t &doc;
+    const vector<uint8_t> &masks;
+    vector<int32_t> &relations;
+
+    int32_t s = 0;
+    const doc_token_t *tokens = nullptr;
+    int32_t n = 0;
+    vector<int32_t> offsets;
+    vector<int32_t> dependents;
+    vector<int32_t> fill;
+    vector<char> visited;
+};
+
+// A N A L Y Z E
+
+int32_t
+analyzeSemantics(const document_view_t &doc, const semantic_labels_t &labels, vector<int32_t> &relations, int threads) {
+    vector<uint8_t> masks;
+    classifyLabels(doc, labels, masks);
+
+    const size_t before = relations.size();
+    const int32_t sentenceCount = doc.sentence_count;
+    threads = min(threads, static_cast<int>(sentenceCount));
+    if (threads <= 1) {
+        sentence_analyzer_t analyzer(doc, masks, relations);
+        for (int32_t i = 0; i < sentenceCount; i++) {
+            analyzer.analyze(i);
+        }
+    } else {
+        // contiguous sentence ranges, one per thread, concatenated in order
+        vector<vector<int32_t>> parts(static_cast<size_t>(threads));
+        vector<thread> workers;
+        workers.reserve(static_cast<size_t>(threads));
+        for (int t = 0; t < threads; t++) {
+            int32_t from = static_cast<int32_t>(static_cast<int64_t>(sentenceCount) * t / threads);
+            int32_t to = static_cast<int32_t>(static_cast<int64_t>(sentenceCount) * (t + 1) / threads);
+            workers.emplace_back([&doc, &masks, &parts, t, from, to]() {
+                sentence_analyzer_t analyzer(doc, masks, parts[t]);
+                for (int32_t i = from; i < to; i++) {
+                    analyzer.analyze(i);
+                }
+            });
+        }
+        for (auto &worker: workers) {
+            worker.join();
+        }
+        for (const auto &part: parts) {
+            relations.insert(relations.end(), part.begin(), part.end());
+        }
+    }
+    return static_cast<int32_t>((relations.size() - before) / kRelationWidth);
+}
@@ -0,0 +1,65 @@
+/* Copyright 2018
+ * Bernard Bou
+ * 1313ou@gmail.com */
+
+#ifndef DEPPARSE_SEMANTICS_H
+#define DEPPARSE_SEMANTICS_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "depparse_native/document.h"
+
+// predicate-subject-object analysis of dependency trees, as org.grammarscope.semantics.SemanticAnalyzer does on Java sentences:
+// from each root, predicates are explored for their subjects and objects, subjects and objects for the predicates that
+// modify them, predicates for the predicates they govern, each token being explored once.
+// Relations are yielded in the same order as the Java analyzer.
+
+/**
+ * Label classes, as configured in org.grammarscope.semantics.SemanticRelations
+ */
+enum semantic_class_t {
+    kClassPredicate,
+    kClassSubject,
+    kClassObject,
+    kClassTermModifier,
+    kClassPredicateModifier,
+    kClassCount,
+};
+
+/**
+ * Relation roles, each relating a predicate token to an argument token
+ */
+enum semantic_role_t {
+    kRoleSubject,       // PS: argument is subject of predicate
+    kRoleObject,        // PO: argument is object of predicate
+    kRolePredicate,     // PP: argument is predicate governed by predicate
+    kRoleTerm,          // TP: predicate modifies argument term
+};
+
+/**
+ * Labels of each class
+ */
+struct semantic_labels_t {
+    std::vector<std::string> classes[kClassCount];
+};
+
+/**
+ * Width of relation tuples
+ */
+const int32_t kRelationWidth = 4;
+
+/**
+ * Analyze all sentences of document
+ *
+ * @param doc document, with heads and labels
+ * @param labels labels of each class
+ * @param relations flattened relation tuples to append to, kRelationWidth ints each: [sentence index, predicate token, role, argument token], token indices in sentence
+ * @param threads number of threads sentences are shared between, 1 or less to analyze on the calling thread
+ * @return number of relations
+ */
+int32_t
+analyzeSemantics(const document_view_t &doc, const semantic_labels_t &labels, std::vector<int32_t> &relations, int threads);
+
+#endif
@@ -0,0 +1,86 @@
+/* Copyright 2018
+ * Bernard Bou
+ * 1313ou@gmail.com */
+
+#include <algorithm>
+
+#include "depparse_native/slot_allocator.h"
+
+using namespace std;
+
+// S E G M E N T   T R E E
+
+slot_tree_t::slot_tree_t(int32_t size) : size(size < 1 ? 1 : size), all(4 * static_cast<size_t>(this->size), 0), any(4 * static_cast<size_t>(this->size), 0) {
+}
+
+uint64_t slot_tree_t::taken(int32_t from, int32_t to) const {
+    from = max(from, 0);
+    to = min(to, size);
+    if (from >= to)
+        return 0;
+    return query(1, 0, size, from, to);
+}
+
+void slot_tree_t::take(int32_t from, int32_t to, uint64_t mask) {
+    from = max(from, 0);
+    to = min(to, size);
+    if (from >= to)
+        return;
+    update(1, 0, size, from, to, mask);
+}
+
+uint64_t slot_tree_t::query(int32_t node, int32_t lo, int32_t hi, int32_t from, int32_t to) const {
+    if (from <= lo && hi <= to)
+        return any[node];
+    // slots taken over the whole node range are taken over any part of it
+    uint64_t result = all[node];
+    int32_t mid = lo + (hi - lo) / 2;
+    if (from < mid)
+        result |= query(2 * node, lo, mid, from, to);
+    if (to > mid)
+        result |= query(2 * node + 1, mid, hi, from, to);
+    return result;
+}
+
+void slot_tree_t::update(int32_t node, int32_t lo, int32_t hi, int32_t from, int32_t to, uint64_t mask) {
+    if (from <= lo && hi <= to) {
+        all[node] |= mask;
+        any[node] |= mask;
+        return;
+    }
+    int32_t mid = lo + (hi - lo) / 2;
+    if (from < mid)
+        update(2 * node, lo, mid, from, to, mask);
+    if (to > mid)
+        update(2 * node + 1, mid, hi, from, to, mask);
+    any[node] = all[node] | any[2 * node] | any[2 * node + 1];
+}
+
+// A L L O C A T E
+
+int32_t
+allocateSlots(const int32_t *lows, const int32_t *highs, int32_t n, int32_t *slots) {
+    if (n <= 0)
+        return 0;
+
+    // positions relative to lowest start
+    int32_t base = lows[0];
+    int32_t top = highs[0];
+    for (int32_t i = 1; i < n; i++) {
+        base = min(base, lows[i]);
+        top = max(top, highs[i]);
+    }
+    slot_tree_t tree(top - base);
+
+    uint64_t used = 0;
+    for (int32_t i = 0; i < n; i++) {
+        uint64_t taken = tree.taken(lows[i] - base, highs[i] - base);
+        int32_t slot = taken == ~0ULL ? kMaxSlots : __builtin_ctzll(~taken);
+        uint64_t mask = 1ULL << min(slot, kMaxSlots - 1);
+        tree.take(lows[i] - base, highs[i] - base, mask);
+        slots[i] = slot;
+        if (lows[i] < highs[i])
+            used |= mask;
+    }
+    return __builtin_popcountll(used);
+}
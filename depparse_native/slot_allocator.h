@@ -0,0 +1,62 @@
+/* Copyright 2018
+ * Bernard Bou
+ * 1313ou@gmail.com */
+
+#ifndef DEPPARSE_SLOT_ALLOCATOR_H
+#define DEPPARSE_SLOT_ALLOCATOR_H
+
+#include <cstdint>
+#include <vector>
+
+// vertical slot allocation of annotation spans, so that spans sharing a position never share a slot.
+// Spans are allocated first-fit in the given order, as SlotAllocatorForSequences does with per-position bitmaps:
+// here the per-position slot bitmaps are held in a segment tree over positions (flat arrays),
+// a span costing O(log positions) whatever its length, instead of one bitmap update per covered position.
+
+const int kMaxSlots = 64;
+
+/**
+ * Segment tree of slot bitmaps over positions, with range OR update and range OR query
+ */
+class slot_tree_t {
+public:
+    /**
+     * @param size number of positions
+     */
+    explicit slot_tree_t(int32_t size);
+
+    /**
+     * Slots taken at some position of [from, to)
+     */
+    uint64_t taken(int32_t from, int32_t to) const;
+
+    /**
+     * Take slots at all positions of [from, to)
+     */
+    void take(int32_t from, int32_t to, uint64_t mask);
+
+private:
+    uint64_t query(int32_t node, int32_t lo, int32_t hi, int32_t from, int32_t to) const;
+
+    void update(int32_t node, int32_t lo, int32_t hi, int32_t from, int32_t to, uint64_t mask);
+
+    const int32_t size;
+    std::vector<uint64_t> all;  // slots taken at every position of node range
+    std::vector<uint64_t> any;  // slots taken at some position of node range
+};
+
+/**
+ * Allocate slots to spans, first fit in order
+ * Span i covers positions [lows[i], highs[i]), empty spans cover nothing and get slot 0.
+ * Spans are allocated at most kMaxSlots slots: when all are taken, a span gets slot kMaxSlots and shares the last one.
+ *
+ * @param lows span starts
+ * @param highs span ends (exclusive)
+ * @param n number of spans
+ * @param slots slot of each span to fill
+ * @return number of slots in use
+ */
+int32_t
+allocateSlots(const int32_t *lows, const int32_t *highs, int32_t n, int32_t *slots);
+
+#endif
@@ -0,0 +1,203 @@
+/* Copyright 2018
+ * Bernard Bou
+ * 1313ou@gmail.com */
+
+#include <algorithm>
+#include <sys/resource.h>
+
+#include "depparse_native/speculation.h"
+#include "depparse_native/model_pool.h"
+
+using namespace std;
+
+static size_t sizeOf(const document_t &doc) {
+    return doc.sentences.size() * sizeof(doc_sentence_t) +
+           doc.tokens.size() * sizeof(doc_token_t) +
+           doc.deps.size() * sizeof(doc_dep_t) +
+           doc.strings.chars.size() +
+           doc.strings.offsets.size() * sizeof(uint32_t);
+}
+
+// S P E C U L A T O R
+
+speculator_t::speculator_t(model_pool_t &pool) : pool(pool) {
+}
+
+speculator_t::~speculator_t() {
+    stop();
+}
+
+size_t speculator_t::speculate(vector<string> &&texts, const vector<uint64_t> &hashes, speculative_parse_t backend_parse) {
+    lock_guard<mutex> lock(m);
+    if (stopping)
+        return 0;
+    parse = backend_parse;
+    queue.clear();
+    generation++;
+    for (size_t i = 0; i < texts.size(); i++) {
+        if (results.count(hashes[i]) != 0 || (parsing && in_flight == hashes[i]))
+            continue;
+        queue.push_back(pending_t{std::move(texts[i]), hashes[i]});
+    }
+    // worker started on first use
+    if (!worker.joinable() && !queue.empty())
+        worker = thread(&speculator_t::run, this);
+    cv.notify_all();
+    return queue.size();
+}
+
+void speculator_t::clear() {
+    lock_guard<mutex> lock(m);
+    queue.clear();
+    generation++;
+    cleared++;
+    results.clear();
+    order.clear();
+    bytes = 0;
+}
+
+bool speculator_t::parked(uint64_t hash) {
+    lock_guard<mutex> lock(m);
+    return results.count(hash) != 0;
+}
+
+bool speculator_t::take(uint64_t hash, document_t &doc) {
+    shared_ptr<model_t> current = pool.current();
+    result_t result;
+    {
+        lock_guard<mutex> lock(m);
+        auto it = results.find(hash);
+        if (it == results.end())
+            return false;
+        result = std::move(it->second);
+        results.erase(it);
+        order.erase(find(order.begin(), order.end(), hash));
+        bytes -= result.bytes;
+
+        // parsed by a model since replaced
+        if (result.model.lock() != current) {
+            counts[kSpeculationEvicted]++;
+            return false;
+        }
+        counts[kSpeculationHits]++;
+    }
+    appendDocument(doc, viewOf(result.doc));
+    return true;
+}
+
+void speculator_t::enter() {
+    lock_guard<mutex> lock(m);
+    foreground++;
+}
+
+void speculator_t::leave() {
+    lock_guard<mutex> lock(m);
+    if (--foreground == 0) {
+        quiet_since = chrono::steady_clock::now();
+        cv.notify_all();
+    }
+}
+
+void speculator_t::stop() {
+    {
+        lock_guard<mutex> lock(m);
+        stopping = true;
+        queue.clear();
+    }
+    cv.notify_all();
+    if (worker.joinable())
+        worker.join();
+}
+
+void speculator_t::snapshot(int64_t values[]) {
+    lock_guard<mutex> lock(m);
+    for (int i = 0; i < kSpeculationStateSize; i++)
+        values[i] = counts[i];
+    values[kSpeculationQueued] = static_cast<int64_t>(queue.size());
+    values[kSpeculationParked] = static_cast<int64_t>(results.size());
+    values[kSpeculationParkedBytes] = static_cast<int64_t>(bytes);
+}
+
+// W O R K E R
+
+void speculator_t::run() {
+    // behind foreground threads, so that it only gets idle cores (on Linux, who 0 is the calling thread)
+    setpriority(PRIO_PROCESS, 0, kSpeculationNice);
+
+    unique_lock<mutex> lock(m);
+    while (true) {
+        cv.wait(lock, [this] { return stopping || (!queue.empty() && foreground == 0); });
+        if (stopping)
+            return;
+
+        // foreground calls come in bursts (navigation): hold back until they have been quiet for a while
+        auto settled = quiet_since + kSpeculationSettle;
+        if (chrono::steady_clock::now() < settled) {
+            cv.wait_until(lock, settled);
+            continue;
+        }
+
+        pending_t next = std::move(queue.front());
+        queue.pop_front();
+        const uint64_t popped = generation;
+        const uint64_t kept = cleared;
+        const speculative_parse_t backend_parse = parse;
+        in_flight = next.hash;
+        parsing = true;
+        lock.unlock();
+
+        // idle context only, never loaded for speculation
+        shared_ptr<model_t> model;
+        document_t doc;
+        bool parsed = false;
+        bool busy = false;
+        {
+            context_lease_t context(pool, true);
+            if (context.handle() != 0) {
+                model = context.leased();
+                parsed = backend_parse(context.handle(), next.text, doc);
+            } else {
+                busy = pool.current() != nullptr;
+            }
+        }
+
+        lock.lock();
+        parsing = false;
+        if (parsed && cleared != kept) {
+            // dropped while being parsed: parking it would serve what clear() was asked to drop
+            counts[kSpeculationDropped]++;
+        } else if (parsed) {
+            counts[kSpeculationParsed]++;
+            park(next.hash, model, std::move(doc));
+        } else if (busy) {
+            // all contexts leased, a foreground call having come in: retry later unless the hint changed
+            if (generation == popped)
+                queue.push_front(std::move(next));
+            cv.wait_for(lock, kSpeculationSettle);
+        } else {
+            counts[kSpeculationDropped]++;
+        }
+    }
+}
+
+void speculator_t::park(uint64_t hash, const shared_ptr<model_t> &model, document_t &&doc) {
+    if (results.count(hash) != 0)
+        return;
+    result_t &result = results[hash];
+    result.model = model;
+    result.bytes = sizeOf(doc);
+    result.doc = std::move(doc);
+    order.push_back(hash);
+    bytes += result.bytes;
+    evict();
+}
+
+void speculator_t::evict() {
+    while (bytes > kSpeculationBudget && !order.empty()) {
+        auto it = results.find(order.front());
+        bytes -= it->second.bytes;
+        results.erase(it);
+        order.pop_front();
+        counts[kSpeculationEvicted]++;
+    }
+}
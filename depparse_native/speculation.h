@@ -0,0 +1,175 @@
+/* Copyright 2018
+ * Bernard Bou
+ * 1313ou@gmail.com */
+
+#ifndef DEPPARSE_SPECULATION_H
+#define DEPPARSE_SPECULATION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "depparse_native/document.h"
+
+// idle-time speculative parsing: texts the app is likely to ask for next (next section, next page) are queued,
+// then parsed one at a time by a low-priority worker with an idle context of the pool, and parked by content hash
+// (see preprocess.h) for the next parse call on the pool to take instead of parsing them.
+// The worker never loads a context and never starts a text while foreground calls are in flight: a foreground call
+// waits at most for the one text being parsed. It resumes once foreground calls have been quiet for kSpeculationSettle.
+
+class model_pool_t;
+class model_t;
+
+/**
+ * Parse of one text into a document, all fields converted
+ */
+typedef bool (*speculative_parse_t)(long context, const std::string &text, document_t &doc);
+
+const std::chrono::milliseconds kSpeculationSettle(50);
+
+const size_t kSpeculationBudget = 16 * 1024 * 1024;   // bytes of parked results, oldest evicted beyond
+
+const int kSpeculationNice = 10;                        // worker thread niceness
+
+/**
+ * Layout of speculation state array
+ */
+enum speculation_state_t {
+    kSpeculationQueued = 0,     // texts waiting
+    kSpeculationParked,         // results parked
+    kSpeculationParkedBytes,    // bytes of parked results
+    kSpeculationParsed,         // texts parsed ahead
+    kSpeculationHits,           // parked results taken by parse calls
+    kSpeculationEvicted,        // parked results evicted unused (budget, model swap)
+    kSpeculationDropped,        // texts dropped unparsed (no model, parse failure) or parsed across a clear
+    kSpeculationStateSize
+};
+
+/**
+ * Speculative parser of a pool
+ */
+class speculator_t {
+public:
+    explicit speculator_t(model_pool_t &pool);
+
+    ~speculator_t();
+
+    speculator_t(const speculator_t &) = delete;
+
+    speculator_t &operator=(const speculator_t &) = delete;
+
+    /**
+     * Queue texts to parse ahead, in order, replacing texts still queued (the latest hint wins),
+     * texts already parked being skipped
+     *
+     * @param texts preprocessed texts
+     * @param hashes content hashes of texts
+     * @param parse backend parse
+     * @return number of texts queued
+     */
+    size_t speculate(std::vector<std::string> &&texts, const std::vector<uint64_t> &hashes, speculative_parse_t parse);
+
+    /**
+     * Drop queued texts and parked results
+     */
+    void clear();
+
+    /**
+     * Whether a result is parked for text
+     */
+    bool parked(uint64_t hash);
+
+    /**
+     * Take parked result for text, appending it to document
+     *
+     * @return false if none is parked for text by the current model
+     */
+    bool take(uint64_t hash, document_t &doc);
+
+    /**
+     * Foreground call starts, the worker holding back until all are done
+     */
+    void enter();
+
+    /**
+     * Foreground call ends
+     */
+    void leave();
+
+    /**
+     * Stop worker, waiting for the text being parsed, if any
+     */
+    void stop();
+
+    /**
+     * Snapshot of state, kSpeculationStateSize values
+     */
+    void snapshot(int64_t values[]);
+
+private:
+    struct pending_t {
+        std::string text;
+        uint64_t hash;
+    };
+
+    struct result_t {
+        std::weak_ptr<model_t> model;
+        document_t doc;
+        size_t bytes;
+    };
+
+    void run();
+
+    void park(uint64_t hash, const std::shared_ptr<model_t> &model, document_t &&doc);
+
+    void evict();
+
+    model_pool_t &pool;
+    std::mutex m;
+    std::condition_variable cv;
+    std::thread worker;
+    bool stopping = false;
+    int foreground = 0;
+    std::chrono::steady_clock::time_point quiet_since;
+    speculative_parse_t parse = nullptr;
+    std::deque<pending_t> queue;
+    uint64_t generation = 0;        // bumped when queue is replaced
+    uint64_t cleared = 0;           // bumped when parked results are dropped
+    uint64_t in_flight = 0;
+    bool parsing = false;
+    std::unordered_map<uint64_t, result_t> results;
+    std::deque<uint64_t> order;   // parked hashes, oldest first
+    size_t bytes = 0;
+    int64_t counts[kSpeculationStateSize] = {};
+};
+
+/**
+ * Scoped foreground call
+ */
+class foreground_t {
+public:
+    explicit foreground_t(speculator_t &speculator) : speculator(speculator) {
+        speculator.enter();
+    }
+
+    ~foreground_t() {
+        speculator.leave();
+    }
+
+    foreground_t(const foreground_t &) = delete;
+
+    foreground_t &operator=(const foreground_t &) = delete;
+
+private:
+    speculator_t &speculator;
+};
+
+#endif
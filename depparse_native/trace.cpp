@@ -0,0 +1,103 @@
+/* Copyright 2018
+ * Bernard Bou
+ * 1313ou@gmail.com */
+
+#include <cstring>
+#include <algorithm>
+
+#include "depparse_native/trace.h"
+#include "depparse_native/parse_cache.h"
+#include "depparse_native/preprocess.h"
+
+using namespace std;
+
+// E N C O D I N G
+
+static void put(string &buffer, const void *data, size_t n) {
+    buffer.append(static_cast<const char *>(data), n);
+}
+
+template<typename T>
+static void put(string &buffer, T value) {
+    put(buffer, &value, sizeof(value));
+}
+
+// R E C O R D E R
+
+bool trace_recorder_t::start(const string &path, bool redact_texts) {
+    stop();
+    lock_guard<mutex> lock(m);
+    file = fopen(path.c_str(), "wb");
+    if (file == nullptr)
+        return false;
+    redact = redact_texts;
+    origin = chrono::steady_clock::now();
+    models.clear();
+    fwrite(kTraceMagic, 1, sizeof(kTraceMagic), file);
+    uint32_t flags = redact ? kTraceRedacted : 0;
+    fwrite(&flags, sizeof(flags), 1, file);
+    recording.store(true, memory_order_relaxed);
+    return true;
+}
+
+void trace_recorder_t::stop() {
+    lock_guard<mutex> lock(m);
+    recording.store(false, memory_order_relaxed);
+    if (file != nullptr) {
+        fclose(file);
+        file = nullptr;
+    }
+}
+
+void trace_recorder_t::record(const char *call, const string &model_path, int64_t handle, const vector<string> &texts,
+                              chrono::steady_clock::time_point start, bool failed) {
+    const auto end = chrono::steady_clock::now();
+    lock_guard<mutex> lock(m);
+    if (file == nullptr)
+        return;
+
+    // model, first time it is seen
+    auto it = models.find(model_path);
+    if (it == models.end()) {
+        auto id = static_cast<uint32_t>(models.size());
+        it = models.emplace(model_path, id).first;
+        string identity = modelIdentity(model_path);
+        identity.resize(min(identity.size(), static_cast<size_t>(UINT16_MAX)));
+        buffer.clear();
+        put<uint8_t>(buffer, kTraceModel);
+        put<uint32_t>(buffer, id);
+        put<uint16_t>(buffer, static_cast<uint16_t>(identity.size()));
+        put(buffer, identity.data(), identity.size());
+        uint32_t size = static_cast<uint32_t>(buffer.size());
+        fwrite(&size, sizeof(size), 1, file);
+        fwrite(buffer.data(), 1, buffer.size(), file);
+    }
+
+    // call
+    size_t name_length = min(strlen(call), static_cast<size_t>(UINT8_MAX));
+    buffer.clear();
+    put<uint8_t>(buffer, kTraceCall);
+    put<uint32_t>(buffer, it->second);
+    put<uint64_t>(buffer, static_cast<uint64_t>(handle));
+    put<int64_t>(buffer, chrono::duration_cast<chrono::microseconds>(start - origin).count());
+    put<int64_t>(buffer, chrono::duration_cast<chrono::microseconds>(end - start).count());
+    put<uint8_t>(buffer, failed ? 1 : 0);
+    put<uint8_t>(buffer, static_cast<uint8_t>(name_length));
+    put(buffer, call, name_length);
+    put<uint32_t>(buffer, static_cast<uint32_t>(texts.size()));
+    for (const auto &text: texts) {
+        put<uint32_t>(buffer, static_cast<uint32_t>(text.size()));
+        if (redact)
+            put<uint64_t>(buffer, contentHash(text));
+        else
+            put(buffer, text.data(), text.size());
+    }
+    uint32_t size = static_cast<uint32_t>(buffer.size());
+    fwrite(&size, sizeof(size), 1, file);
+    fwrite(buffer.data(), 1, buffer.size(), file);
+}
+
+trace_recorder_t &recorder() {
+    static trace_recorder_t instance;
+    return instance;
+}
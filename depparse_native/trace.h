@@ -0,0 +1,90 @@
+/* Copyright 2018
+ * Bernard Bou
+ * 1313ou@gmail.com */
+
+#ifndef DEPPARSE_TRACE_H
+#define DEPPARSE_TRACE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// opt-in trace of the parse calls of a JNI library, to be replayed on the host (see replay.h).
+// Trace files are little-endian binary, a header followed by length-prefixed records:
+//
+// header   := magic "DPTRACE1" | u32 flags (kTraceRedacted)
+// record   := u32 size of what follows | u8 type | body
+// model    := u32 model id | u16 length | identity (path|size|mtime, as modelIdentity())
+// call     := u32 model id | u64 handle | i64 start (us since trace start) | i64 duration (us) | u8 failed
+//             | u8 length | call name | u32 text count | text*
+// text     := u32 byte length | bytes, or u64 hash (contentHash() of bytes, see preprocess.h) when redacted
+//
+// Model records are written before the first call on that model. Calls are written when they end,
+// so concurrent calls are in end order: start times give the original order.
+
+const char kTraceMagic[8] = {'D', 'P', 'T', 'R', 'A', 'C', 'E', '1'};
+
+const uint32_t kTraceRedacted = 1;
+
+enum trace_record_t {
+    kTraceModel = 1,
+    kTraceCall = 2,
+};
+
+/**
+ * Recorder of the calls of a library, idle unless started
+ */
+class trace_recorder_t {
+public:
+    /**
+     * Start recording to file, ending the current trace if any
+     *
+     * @param path trace file, truncated
+     * @param redact whether texts are recorded as hashes and lengths only
+     * @return false if file could not be opened
+     */
+    bool start(const std::string &path, bool redact);
+
+    /**
+     * End trace, flushing it
+     */
+    void stop();
+
+    bool active() const {
+        return recording.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Record call, if recording
+     *
+     * @param call call name
+     * @param model_path path of model the call was served by
+     * @param handle Java handle, distinguishing handles over the same model
+     * @param texts input texts
+     * @param start time call was entered
+     * @param failed whether call left with a pending exception
+     */
+    void record(const char *call, const std::string &model_path, int64_t handle, const std::vector<std::string> &texts,
+                std::chrono::steady_clock::time_point start, bool failed);
+
+private:
+    std::atomic<bool> recording{false};
+    std::mutex m;
+    FILE *file = nullptr;
+    bool redact = false;
+    std::chrono::steady_clock::time_point origin;
+    std::unordered_map<std::string, uint32_t> models;   // model path -> model id
+    std::string buffer;
+};
+
+/**
+ * Recorder of this library
+ */
+trace_recorder_t &recorder();
+
+#endif
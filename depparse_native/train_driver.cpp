@@ -0,0 +1,200 @@
+/* Copyright 2018
+ * Bernard Bou
+ * 1313ou@gmail.com */
+
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <fstream>
+#include <algorithm>
+#include <unistd.h>
+
+#include "depparse_native/train_driver.h"
+#include "depparse_native/writers.h"
+#include "depparse_native/binary.h"
+#include "depparse_native/tree_index.h"
+#include "depparse_native/query.h"
+
+using namespace std;
+
+// field masks as used by callers (org.depparse.Fields POS and GRAPH)
+static const int32_t kFieldsPos = kFieldWord | kFieldCategory | kFieldTag | kFieldOffsets;
+static const int32_t kFieldsGraph = kFieldWord | kFieldHead | kFieldLabel | kFieldTree;
+
+static const char *const kQueries[] = {
+        "{upos:VERB} >nsubj {}",
+        "{} >obj ({} >amod {})",
+        "{lemma:be} >> {upos:NOUN}",
+};
+
+// O P T I O N S
+
+struct training_options_t {
+    vector<string> files;
+    int iterations = 10;
+};
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "usage: %s [-i iterations] corpus.conllu ...\n"
+            "  -i iterations  passes over the corpus (default: 10), the first one being a warm-up when more than one\n"
+            "  corpus         annotated CoNLL-U files, representative of parsed input (e.g. UD treebank of model language)\n"
+            "prints: backend, tokens, iterations, median and best ns per token, tokens per second, output checksum\n",
+            prog);
+}
+
+static bool parseOptions(int argc, char *argv[], training_options_t &options) {
+    int c;
+    while ((c = getopt(argc, argv, "i:h")) != -1) {
+        switch (c) {
+            case 'i':
+                options.iterations = atoi(optarg);
+                break;
+            default:
+                return false;
+        }
+    }
+    for (int i = optind; i < argc; i++) {
+        options.files.emplace_back(argv[i]);
+    }
+    return !options.files.empty() && options.iterations > 0;
+}
+
+// C H E C K S U M
+
+static uint64_t mix(uint64_t h, const void *data, size_t n) {
+    const auto *p = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < n; i++) {
+        h ^= p[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+static uint64_t mix(uint64_t h, int64_t value) {
+    return mix(h, &value, sizeof(value));
+}
+
+// W O R K L O A D
+
+/**
+ * One pass over the corpus through the library paths, in fixed order
+ *
+ * @return checksum of outputs, identical across builds of the same sources
+ */
+static uint64_t pass(const training_backend_t &backend, const vector<parsed_sentence_t> &parsed, const vector<query_t> &queries) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    document_t doc;
+
+    // projected conversions
+    const int32_t masks[] = {kFieldsPos, kFieldsGraph};
+    for (int32_t fields: masks) {
+        doc.clear();
+        backend.toDocument(parsed, doc, neededFields(fields));
+        h = mix(h, static_cast<int64_t>(doc.tokens.size()));
+    }
+
+    // full conversion
+    doc.clear();
+    backend.toDocument(parsed, doc, kFieldAll);
+    const document_view_t view = viewOf(doc);
+
+    // serializations
+    string out;
+    writeConllu(view, 1, out);
+    h = mix(h, out.data(), out.size());
+    out.clear();
+    writeTsv(view, 1, out);
+    h = mix(h, out.data(), out.size());
+
+    // binary layout, written then read back
+    vector<char> buffer(binarySize(view));
+    writeBinary(view, buffer.data());
+    document_view_t read;
+    if (readBinary(buffer.data(), buffer.size(), read))
+        h = mix(h, static_cast<int64_t>(read.token_count));
+
+    // tree indices
+    tree_index_t index;
+    vector<int32_t> packed;
+    for (int s = 0; s < view.sentence_count; s++) {
+        buildTreeIndex(view, s, index);
+        packed.clear();
+        packTreeIndex(index, packed);
+        h = mix(h, packed.data(), packed.size() * sizeof(int32_t));
+    }
+
+    // queries
+    vector<int32_t> matches;
+    for (const auto &query: queries) {
+        matches.clear();
+        h = mix(h, static_cast<int64_t>(matchQuery(query, view, matches, 0)));
+    }
+    return h;
+}
+
+// D R I V E R
+
+int
+runTraining(int argc, char *argv[], const training_backend_t &backend) {
+    training_options_t options;
+    if (!parseOptions(argc, argv, options)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // corpus, turned into parse results once, out of timing
+    vector<corpus_sentence_t> corpus;
+    for (const auto &file: options.files) {
+        ifstream in(file);
+        if (!in) {
+            fprintf(stderr, "cannot open %s\n", file.c_str());
+            return 1;
+        }
+        readConllu(in, corpus);
+    }
+    vector<parsed_sentence_t> parsed(corpus.size());
+    size_t tokens = 0;
+    for (size_t i = 0; i < corpus.size(); i++) {
+        backend.toParsed(corpus[i], parsed[i]);
+        tokens += corpus[i].tokens.size();
+    }
+    if (tokens == 0) {
+        fprintf(stderr, "empty corpus\n");
+        return 1;
+    }
+    fprintf(stderr, "%s: %zu sentences, %zu tokens\n", backend.name, corpus.size(), tokens);
+
+    vector<query_t> queries;
+    for (const char *pattern: kQueries) {
+        query_t query;
+        string error;
+        if (compileQuery(pattern, query, error))
+            queries.push_back(query);
+        else
+            fprintf(stderr, "query %s: %s\n", pattern, error.c_str());
+    }
+
+    // passes
+    vector<double> ns_per_token;
+    uint64_t checksum = 0;
+    for (int i = 0; i < options.iterations; i++) {
+        auto t0 = chrono::steady_clock::now();
+        uint64_t h = pass(backend, parsed, queries);
+        auto t1 = chrono::steady_clock::now();
+        if (i > 0 && h != checksum) {
+            fprintf(stderr, "non-deterministic output at pass %d\n", i);
+            return 2;
+        }
+        checksum = h;
+        if (i > 0 || options.iterations == 1)
+            ns_per_token.push_back(static_cast<double>(chrono::duration_cast<chrono::nanoseconds>(t1 - t0).count()) / static_cast<double>(tokens));
+    }
+
+    sort(ns_per_token.begin(), ns_per_token.end());
+    double median = ns_per_token[ns_per_token.size() / 2];
+    double best = ns_per_token.front();
+    printf("%s\ttokens=%zu\titerations=%d\tmedian_ns_per_token=%.1f\tbest_ns_per_token=%.1f\ttokens_per_s=%.0f\tchecksum=%016llx\n",
+           backend.name, tokens, options.iterations, median, best, 1e9 / median, static_cast<unsigned long long>(checksum));
+    return 0;
+}
@@ -0,0 +1,52 @@
+/* Copyright 2018
+ * Bernard Bou
+ * 1313ou@gmail.com */
+
+#ifndef DEPPARSE_TRAIN_DRIVER_H
+#define DEPPARSE_TRAIN_DRIVER_H
+
+#include <cstdint>
+#include <string>
+#include <map>
+#include <vector>
+
+#include "depparse_native/document.h"
+#include "depparse_native/corpus.h"
+
+// host training driver for profile-guided builds (see optimize.cmake):
+// replays an annotated corpus, turned into backend parse results, through the conversion code of a JNI library
+// (document conversion with field masks, serializations, tree indices, queries), in a fixed order, no model needed.
+// Run instrumented, it collects the profile; run plain or optimized, it is the benchmark.
+
+// backend parse results, as typed by iface_h.h of each backend
+typedef std::map<std::string, std::string> parsed_token_t;
+typedef std::vector<parsed_token_t> parsed_sentence_t;
+
+/**
+ * Backend under training
+ */
+struct training_backend_t {
+    const char *name;
+
+    /**
+     * Corpus sentence as backend parse result, token[0] holding sentence data
+     */
+    void (*toParsed)(const corpus_sentence_t &sentence, parsed_sentence_t &parsed);
+
+    /**
+     * Backend conversion of parse results
+     */
+    bool (*toDocument)(const std::vector<parsed_sentence_t> &parsed_sentences, document_t &doc, int32_t fields);
+};
+
+/**
+ * Run driver
+ *
+ * usage: [-i iterations] [-s] corpus.conllu ...
+ *
+ * @return exit code
+ */
+int
+runTraining(int argc, char *argv[], const training_backend_t &backend);
+
+#endif
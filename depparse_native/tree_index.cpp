@@ -0,0 +1,111 @@
+/* Copyright 2018
+ * Bernard Bou
+ * 1313ou@gmail.com */
+
+#include "depparse_native/tree_index.h"
+
+using namespace std;
+
+void
+buildTreeIndex(const document_view_t &doc, int sentenceIndex, tree_index_t &index) {
+    const doc_sentence_t &sentence = doc.sentences[sentenceIndex];
+    const doc_token_t *tokens = doc.tokensOf(sentence);
+    const int32_t n = sentence.token_count;
+
+    index.size = n;
+    index.flags = 0;
+    index.parents.assign(n, -1);
+    index.roots.clear();
+    index.child_offsets.assign(n + 1, 0);
+    index.children.assign(n, 0);
+    index.depths.assign(n, -1);
+    index.span_starts.resize(n);
+    index.span_ends.resize(n);
+
+    // parents, heads out of range or pointing to self are taken as roots
+    for (int32_t i = 0; i < n; i++) {
+        int32_t head = treeHead(doc, tokens[i]);
+        if (head < 0 || head >= n || head == i) {
+            index.roots.push_back(i);
+        } else {
+            index.parents[i] = head;
+            index.child_offsets[head + 1]++;
+        }
+    }
+    if (index.roots.size() > 1) {
+        index.flags |= kTreeMultipleRoots;
+    }
+
+    // CSR children
+    for (int32_t i = 0; i < n; i++) {
+        index.child_offsets[i + 1] += index.child_offsets[i];
+    }
+    index.children.resize(index.child_offsets[n]);
+    vector<int32_t> fill(index.child_offsets.begin(), index.child_offsets.end() - 1);
+    for (int32_t i = 0; i < n; i++) {
+        int32_t parent = index.parents[i];
+        if (parent != -1) {
+            index.children[fill[parent]++] = i;
+        }
+    }
+
+    // depths, breadth-first from roots, tokens never reached are in (or hang from) a cycle
+    vector<int32_t> order(index.roots);
+    order.reserve(n);
+    for (int32_t root: index.roots) {
+        index.depths[root] = 0;
+    }
+    for (size_t k = 0; k < order.size(); k++) {
+        int32_t i = order[k];
+        for (int32_t c = index.child_offsets[i]; c < index.child_offsets[i + 1]; c++) {
+            int32_t child = index.children[c];
+            index.depths[child] = index.depths[i] + 1;
+            order.push_back(child);
+        }
+    }
+    if (static_cast<int32_t>(order.size()) < n) {
+        index.flags |= kTreeHasCycle;
+    }
+
+    // subtree spans and sizes, accumulated bottom-up
+    vector<int32_t> sizes(n, 1);
+    for (int32_t i = 0; i < n; i++) {
+        index.span_starts[i] = i;
+        index.span_ends[i] = i;
+    }
+    for (size_t k = order.size(); k-- > 0;) {
+        int32_t i = order[k];
+        int32_t parent = index.parents[i];
+        if (parent != -1) {
+            if (index.span_starts[i] < index.span_starts[parent])
+                index.span_starts[parent] = index.span_starts[i];
+            if (index.span_ends[i] > index.span_ends[parent])
+                index.span_ends[parent] = index.span_ends[i];
+            sizes[parent] += sizes[i];
+        }
+    }
+
+    // projective if every subtree is contiguous
+    for (int32_t i: order) {
+        if (index.span_ends[i] - index.span_starts[i] + 1 != sizes[i]) {
+            index.flags |= kTreeNonProjective;
+            break;
+        }
+    }
+}
+
+void
+packTreeIndex(const tree_index_t &index, vector<int32_t> &packed) {
+    packed.clear();
+    packed.reserve(3 + index.roots.size() + (index.size + 1) + index.children.size() + 4 * index.size);
+    packed.push_back(index.flags);
+    packed.push_back(index.size);
+    packed.push_back(static_cast<int32_t>(index.roots.size()));
+    packed.insert(packed.end(), index.roots.begin(), index.roots.end());
+    packed.insert(packed.end(), index.child_offsets.begin(), index.child_offsets.end());
+    packed.insert(packed.end(), index.children.begin(), index.children.end());
+    packed.insert(packed.end(), index.parents.begin(), index.parents.end());
+    packed.insert(packed.end(), index.depths.begin(), index.depths.end());
+    packed.insert(packed.end(), index.span_starts.begin(), index.span_starts.end());
+    packed.insert(packed.end(), index.span_ends.begin(), index.span_ends.end());
+}
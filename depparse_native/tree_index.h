@@ -0,0 +1,51 @@
+/* Copyright 2018
+ * Bernard Bou
+ * 1313ou@gmail.com */
+
+#ifndef DEPPARSE_TREE_INDEX_H
+#define DEPPARSE_TREE_INDEX_H
+
+#include <cstdint>
+#include <vector>
+
+#include "depparse_native/document.h"
+
+// dependency tree index of a sentence: parents, CSR children, roots, depths, subtree spans
+
+const int32_t kTreeHasCycle = 1;        // some tokens do not reach a root
+const int32_t kTreeNonProjective = 2;   // some subtree does not cover a contiguous token span
+const int32_t kTreeMultipleRoots = 4;   // more than one root
+
+struct tree_index_t {
+    int32_t size;                       // number of tokens
+    int32_t flags;                      // kTree* flags
+    std::vector<int32_t> parents;       // tree head of token, -1 for roots
+    std::vector<int32_t> roots;         // root tokens, in token order
+    std::vector<int32_t> child_offsets; // children of token i are children[child_offsets[i] .. child_offsets[i + 1])
+    std::vector<int32_t> children;      // children, in token order
+    std::vector<int32_t> depths;        // 0 for roots, -1 for tokens that do not reach a root
+    std::vector<int32_t> span_starts;   // first token of subtree
+    std::vector<int32_t> span_ends;     // last token of subtree, inclusive
+};
+
+/**
+ * Build tree index of sentence
+ *
+ * @param doc document
+ * @param sentenceIndex sentence index in document
+ * @param index index to fill
+ */
+void
+buildTreeIndex(const document_view_t &doc, int sentenceIndex, tree_index_t &index);
+
+/**
+ * Pack tree index into a single int array:
+ * [flags, size, root count, roots..., child offsets (size + 1)..., children..., parents (size)..., depths (size)..., span starts (size)..., span ends (size)...]
+ *
+ * @param index tree index
+ * @param packed packed array to fill
+ */
+void
+packTreeIndex(const tree_index_t &index, std::vector<int32_t> &packed);
+
+#endif
@@ -0,0 +1,88 @@
+/* Copyright 2018
+ * Bernard Bou
+ * 1313ou@gmail.com */
+
+#include <vector>
+#include <memory>
+#include <malloc.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <dlfcn.h>
+#include <sys/stat.h>
+
+#include "depparse_native/trim.h"
+
+using namespace std;
+
+#ifndef M_PURGE
+#define M_PURGE (-101)
+#endif
+
+void
+purgeHeap() {
+#if defined(__BIONIC__)
+    // mallopt is API 26+, looked up so that older devices just skip it
+    typedef int (*mallopt_t)(int, int);
+    auto f = reinterpret_cast<mallopt_t>(dlsym(RTLD_DEFAULT, "mallopt"));
+    if (f != nullptr)
+        f(M_PURGE, 0);
+#elif defined(__GLIBC__)
+    malloc_trim(0);
+#endif
+}
+
+static void dropPages(const string &path) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return;
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+}
+
+void
+dropFilePages(const string &path) {
+    struct stat st{};
+    if (stat(path.c_str(), &st) != 0)
+        return;
+    if (!S_ISDIR(st.st_mode)) {
+        dropPages(path);
+        return;
+    }
+    DIR *d = opendir(path.c_str());
+    if (d == nullptr)
+        return;
+    struct dirent *e;
+    while ((e = readdir(d)) != nullptr) {
+        string file = path + '/' + e->d_name;
+        if (stat(file.c_str(), &st) == 0 && S_ISREG(st.st_mode))
+            dropPages(file);
+    }
+    closedir(d);
+}
+
+int
+trimMemory(model_pool_t &pool, int level) {
+    int trimmed = 0;
+    if (level >= kTrimRunningLow) {
+        trimmed = pool.trim(1);
+        pool.speculation.clear();
+    }
+    if (level >= kTrimRunningCritical && level != kTrimUiHidden && level != kTrimBackground)
+        dropFilePages(pool.path());
+    purgeHeap();
+    return trimmed;
+}
+
+int
+trimMemory(model_registry_t &registry, int level) {
+    int evicted = 0;
+    if (level >= kTrimBackground)
+        evicted = registry.trim(1);
+    vector<shared_ptr<model_pool_t>> pools = registry.pools();
+    for (auto &pool: pools) {
+        trimMemory(*pool, level);
+    }
+    purgeHeap();
+    return evicted;
+}
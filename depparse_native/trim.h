@@ -0,0 +1,60 @@
+/* Copyright 2018
+ * Bernard Bou
+ * 1313ou@gmail.com */
+
+#ifndef DEPPARSE_TRIM_H
+#define DEPPARSE_TRIM_H
+
+#include <string>
+
+#include "depparse_native/model_pool.h"
+#include "depparse_native/model_registry.h"
+
+// memory release under pressure, handles staying valid: what is released loads, parses or faults back in on demand.
+// What is released is free heap pages, idle parse contexts beyond the first, results parsed ahead by speculation,
+// page cache of model files and least recently used models. Backends read models into their own heap: a loaded model
+// only goes with its contexts or its eviction, dropping file pages frees the page cache left by reading it, no more.
+
+// levels, as in Android ComponentCallbacks2.onTrimMemory
+const int kTrimRunningModerate = 5;
+const int kTrimRunningLow = 10;
+const int kTrimRunningCritical = 15;
+const int kTrimUiHidden = 20;
+const int kTrimBackground = 40;
+const int kTrimModerate = 60;
+const int kTrimComplete = 80;
+
+/**
+ * Return free heap pages to the system
+ */
+void
+purgeHeap();
+
+/**
+ * Drop page cache of model file, or of files in model directory, which leaves models already read into heap as they are
+ */
+void
+dropFilePages(const std::string &path);
+
+/**
+ * Release memory held by pool according to level:
+ * - running low and above: idle contexts beyond the first are unloaded, speculative results and queued texts are dropped
+ * - running critical, moderate and above: page cache of model files is dropped
+ * - any level: free heap pages are returned to the system
+ *
+ * @return number of contexts unloaded
+ */
+int
+trimMemory(model_pool_t &pool, int level);
+
+/**
+ * Release memory held by registry according to level:
+ * - background and above: least recently used models are evicted but the most recently used one
+ * - then its pools are trimmed as above
+ *
+ * @return number of models evicted
+ */
+int
+trimMemory(model_registry_t &registry, int level);
+
+#endif
@@ -0,0 +1,155 @@
+/* Copyright 2018
+ * Bernard Bou
+ * 1313ou@gmail.com */
+
+#include <cstdio>
+#include <cerrno>
+#include <unistd.h>
+
+#include "depparse_native/writers.h"
+
+using namespace std;
+
+// H E L P E R S
+
+static inline void appendInt(string &out, long i) {
+    char buffer[24];
+    int n = snprintf(buffer, sizeof(buffer), "%ld", i);
+    out.append(buffer, static_cast<size_t>(n));
+}
+
+static inline void appendField(string &out, const document_view_t &doc, int32_t id) {
+    if (id < 0) {
+        out += '_';
+        return;
+    }
+    out.append(doc.str(id), doc.length(id));
+}
+
+/**
+ * CoNLL-U field, '_' stands for null or empty
+ */
+static inline void appendConlluField(string &out, const document_view_t &doc, int32_t id) {
+    size_t n = doc.length(id);
+    if (n == 0) {
+        out += '_';
+        return;
+    }
+    out.append(doc.str(id), n);
+}
+
+// T S V
+
+void
+writeTsvSentence(const document_view_t &doc, int sentenceIndex, long id, string &out) {
+    const doc_sentence_t &sentence = doc.sentences[sentenceIndex];
+
+    out += "# sent_id = ";
+    appendInt(out, id);
+    out += "\n# text = ";
+    appendField(out, doc, sentence.text);
+    out += '\n';
+
+    const doc_token_t *tokens = doc.tokensOf(sentence);
+    for (int j = 0; j < sentence.token_count; j++) {
+        const doc_token_t &token = tokens[j];
+        appendInt(out, j);
+        out += '\t';
+        appendField(out, doc, token.word);
+        out += '\t';
+        appendInt(out, token.start);
+        out += '\t';
+        appendInt(out, token.end);
+        out += '\t';
+        appendField(out, doc, token.category);
+        out += '\t';
+        appendInt(out, token.head);
+        out += '\t';
+        appendField(out, doc, token.label);
+        out += '\t';
+        appendInt(out, token.breaklevel);
+        out += '\t';
+        appendField(out, doc, token.deps);
+        out += '\t';
+        appendField(out, doc, token.tag);
+        out += '\n';
+    }
+    out += '\n';
+}
+
+void
+writeTsv(const document_view_t &doc, long firstId, string &out) {
+    for (int i = 0; i < doc.sentence_count; i++) {
+        writeTsvSentence(doc, i, firstId + i, out);
+    }
+}
+
+// C O N L L - U
+
+void
+writeConlluSentence(const document_view_t &doc, int sentenceIndex, long id, string &out) {
+    const doc_sentence_t &sentence = doc.sentences[sentenceIndex];
+
+    out += "# sent_id = ";
+    appendInt(out, id);
+    out += "\n# text = ";
+    appendField(out, doc, sentence.text);
+    out += '\n';
+
+    const doc_token_t *tokens = doc.tokensOf(sentence);
+    for (int j = 0; j < sentence.token_count; j++) {
+        const doc_token_t &token = tokens[j];
+
+        // ID FORM LEMMA UPOS XPOS FEATS
+        appendInt(out, j + 1);
+        out += '\t';
+        appendConlluField(out, doc, token.word);
+        out += '\t';
+        appendConlluField(out, doc, token.lemma);
+        out += '\t';
+        appendConlluField(out, doc, token.upostag != kEmptyString ? token.upostag : token.category);
+        out += '\t';
+        appendConlluField(out, doc, token.xpostag);
+        out += '\t';
+        appendConlluField(out, doc, token.feats);
+        out += '\t';
+
+        // HEAD DEPREL DEPS
+        appendInt(out, treeHead(doc, token) + 1);
+        out += '\t';
+        appendConlluField(out, doc, token.label);
+        out += '\t';
+        appendConlluField(out, doc, token.deps);
+        out += '\t';
+
+        // MISC
+        bool noSpaceAfter = j + 1 < sentence.token_count && tokens[j + 1].breaklevel == 0;
+        out += noSpaceAfter ? "SpaceAfter=No" : "_";
+        out += '\n';
+    }
+    out += '\n';
+}
+
+void
+writeConllu(const document_view_t &doc, long firstId, string &out) {
+    for (int i = 0; i < doc.sentence_count; i++) {
+        writeConlluSentence(doc, i, firstId + i, out);
+    }
+}
+
+// F I L E   D E S C R I P T O R
+
+bool
+writeFully(int fd, const char *data, size_t size) {
+    while (size > 0) {
+        ssize_t n = write(fd, data, size);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
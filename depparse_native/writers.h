@@ -0,0 +1,68 @@
+/* Copyright 2018
+ * Bernard Bou
+ * 1313ou@gmail.com */
+
+#ifndef DEPPARSE_WRITERS_H
+#define DEPPARSE_WRITERS_H
+
+#include <string>
+
+#include "depparse_native/document.h"
+
+// text serialization of documents
+
+/**
+ * Append sentence as tab-separated token lines, fields as handed to Java:
+ * index, word, start, end, category, head, label, breaklevel, deps, tag
+ *
+ * @param doc document
+ * @param sentenceIndex sentence index in document
+ * @param id sentence id to print in comment
+ * @param out output buffer to append to
+ */
+void
+writeTsvSentence(const document_view_t &doc, int sentenceIndex, long id, std::string &out);
+
+/**
+ * Append document sentences as tab-separated token lines
+ *
+ * @param doc document
+ * @param firstId id of first sentence
+ * @param out output buffer to append to
+ */
+void
+writeTsv(const document_view_t &doc, long firstId, std::string &out);
+
+/**
+ * Append sentence in CoNLL-U format
+ *
+ * @param doc document
+ * @param sentenceIndex sentence index in document
+ * @param id sentence id to print in sent_id comment
+ * @param out output buffer to append to
+ */
+void
+writeConlluSentence(const document_view_t &doc, int sentenceIndex, long id, std::string &out);
+
+/**
+ * Append document sentences in CoNLL-U format
+ *
+ * @param doc document
+ * @param firstId id of first sentence
+ * @param out output buffer to append to
+ */
+void
+writeConllu(const document_view_t &doc, long firstId, std::string &out);
+
+/**
+ * Write whole buffer to file descriptor, retrying on short writes and interrupts
+ *
+ * @param fd file descriptor
+ * @param data data
+ * @param size data size
+ * @return false on error (errno is set)
+ */
+bool
+writeFully(int fd, const char *data, size_t size);
+
+#endif
@@ -1,9 +1,11 @@
 package org.grammarscope.graph
 
 import android.util.Log
+import org.depparse.NativeDocument
 import org.depparse.Sentence
 import org.depparse.Token
 import org.depparse.common.BaseParse
+import org.grammarscope.semantics.Analysis
 import org.grammarscope.semantics.Relation
 import org.grammarscope.semantics.SemanticAnalyzer
 import java.util.function.Consumer
@@ -14,6 +16,36 @@ class SemanticGraphParse(consumer: Consumer<SentenceGraph<Token, Relation>?>, pr
         return sentences?.let {
             val analyzer = SemanticAnalyzer()
             val analyses = analyzer.analyze(*sentences)
+            toGraph(sentences, analyses, reverse)
+        }
+    }
+
+    companion object {
+
+        private const val TAG = "SemanticGraphsParse"
+
+        /**
+         * Semantic graph of natively parsed document, relations being extracted natively
+         *
+         * @param document native document
+         * @param reverse whether edges go from predicate to term
+         * @param threads number of threads sentences are shared between, 1 to analyze on the calling thread
+         * @return graph
+         */
+        fun toGraph(document: NativeDocument, reverse: Boolean = false, threads: Int = 1): SentenceGraph<Token, Relation> {
+            val analyses = SemanticAnalyzer().analyze(document, threads)
+            return toGraph(document.toArray(), analyses, reverse)
+        }
+
+        /**
+         * Semantic graph of analyses
+         *
+         * @param sentences sentences
+         * @param analyses analyses of sentences
+         * @param reverse whether edges go from predicate to term
+         * @return graph
+         */
+        fun toGraph(sentences: Array<Sentence>, analyses: Array<Analysis>, reverse: Boolean = false): SentenceGraph<Token, Relation> {
             val graph = SentenceGraph<Token, Relation>(sentences)
             for (analysis in analyses) {
                 for (relation in analysis) {
@@ -35,12 +67,7 @@ class SemanticGraphParse(consumer: Consumer<SentenceGraph<Token, Relation>?>, pr
                 graph.apply { initFunctions() }
             }
             Log.d(TAG, graph.toString())
-            graph
+            return graph
         }
     }
-
-    companion object {
-
-        private const val TAG = "SemanticGraphsParse"
-    }
 }
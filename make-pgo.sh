@@ -0,0 +1,105 @@
+#!/bin/bash
+#
+# Copyright (c) 2025. Bernard Bou <1313ou@gmail.com>.
+#
+
+# Profile-guided (PGO + ThinLTO) build of a JNI library's conversion code:
+# trains on the host with the corpus, merges the profile, then benchmarks the plain build against the optimized one.
+# The merged profile is then consumed by the release build of the library:
+#   ./gradlew :udpipe_jni:assembleRelease -Pdepparse.profile=depparse_native/profiles/udpipe.profdata
+#
+# usage: make-pgo.sh udpipe|syntaxnet2 corpus.conllu ...
+# env: CXX (clang++), PROFDATA (llvm-profdata), ITERATIONS (10, per training or benchmark run), RUNS (5 benchmark runs per build)
+# The LLVM major version of CXX and PROFDATA should match the NDK clang that consumes the profile.
+
+source define_colors.sh
+
+case "$1" in
+udpipe)
+	src=udpipe_jni
+	driver=udpipe_train
+	;;
+syntaxnet2)
+	src=syntaxnet2_jni
+	driver=syntaxnet_train
+	;;
+*)
+	echo "usage: ${0##*/} udpipe|syntaxnet2 corpus.conllu ..."
+	exit 1
+	;;
+esac
+lib=$1
+shift
+if [ $# -eq 0 ]; then
+	echo "no corpus"
+	exit 1
+fi
+corpus=()
+for f in "$@"; do
+	corpus+=("$(realpath "$f")")
+done
+
+CXX=${CXX:-clang++}
+PROFDATA=${PROFDATA:-llvm-profdata}
+ITERATIONS=${ITERATIONS:-10}
+RUNS=${RUNS:-5}
+
+top=$(pwd)
+build=${top}/build/pgo/${lib}
+profiles=${top}/depparse_native/profiles
+raw=${build}/raw
+profile=${profiles}/${lib}.profdata
+mkdir -p ${profiles}
+rm -rf ${raw}
+
+if [ -n "${ANDROID_NDK_HOME}" ]; then
+	ndk_clang=$(ls ${ANDROID_NDK_HOME}/toolchains/llvm/prebuilt/*/bin/clang 2>/dev/null | head -1)
+	if [ -n "${ndk_clang}" ]; then
+		echo -e "${C}host: $(${CXX} --version | head -1)${Z}"
+		echo -e "${C}ndk:  $(${ndk_clang} --version | head -1)${Z}"
+	fi
+fi
+
+configure_build() {
+	local dir=$1
+	shift
+	cmake -S ${top}/${src} -B ${dir} -DCMAKE_CXX_COMPILER=${CXX} -DCMAKE_BUILD_TYPE=Release "$@" >/dev/null || exit 2
+	cmake --build ${dir} --target ${driver} -j"$(nproc)" >/dev/null || exit 2
+}
+
+echo -e "${M}plain${Z}"
+configure_build ${build}/plain
+
+echo -e "${M}instrumented, training${Z}"
+configure_build ${build}/instrumented -DDEPPARSE_PROFILE_GENERATE=${raw}
+${build}/instrumented/${driver} -i ${ITERATIONS} "${corpus[@]}" || exit 3
+${PROFDATA} merge -output=${profile} ${raw}/*.profraw || exit 3
+echo -e "${G}${profile}${Z}"
+
+echo -e "${M}optimized${Z}"
+configure_build ${build}/optimized -DDEPPARSE_PROFILE_USE=${profile}
+
+# alternate runs so that both builds see the same machine conditions
+echo -e "${M}benchmark${Z}"
+: >${build}/plain.txt
+: >${build}/optimized.txt
+for ((r = 0; r < RUNS; r++)); do
+	${build}/plain/${driver} -i ${ITERATIONS} "${corpus[@]}" 2>/dev/null >>${build}/plain.txt
+	${build}/optimized/${driver} -i ${ITERATIONS} "${corpus[@]}" 2>/dev/null >>${build}/optimized.txt
+done
+
+median() {
+	sed -n 's/.*median_ns_per_token=\([0-9.]*\).*/\1/p' $1 | sort -n | awk '{v[NR]=$1} END {print v[int((NR+1)/2)]}'
+}
+checksums() {
+	sed -n 's/.*checksum=\([0-9a-f]*\).*/\1/p' $1 | sort -u
+}
+plain=$(median ${build}/plain.txt)
+optimized=$(median ${build}/optimized.txt)
+if [ "$(checksums ${build}/plain.txt)" != "$(checksums ${build}/optimized.txt)" ]; then
+	echo -e "${R}outputs of plain and optimized builds differ${Z}"
+	exit 4
+fi
+echo -e "plain:     ${plain} ns/token"
+echo -e "optimized: ${optimized} ns/token"
+echo -e "${G}speedup:   $(awk -v p=${plain} -v o=${optimized} 'BEGIN {printf "%.2f", p / o}')${Z}"
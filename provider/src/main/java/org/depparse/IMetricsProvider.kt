@@ -0,0 +1,11 @@
+package org.depparse
+
+interface IMetricsProvider {
+
+    /**
+     * Snapshot of native metrics: latency histograms and throughput counters (see org.depparse.Metrics for layout)
+     *
+     * @return packed snapshot, null if not available
+     */
+    fun metrics(): LongArray?
+}
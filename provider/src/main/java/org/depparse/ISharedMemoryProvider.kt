@@ -0,0 +1,16 @@
+package org.depparse
+
+import android.os.ParcelFileDescriptor
+
+interface ISharedMemoryProvider {
+
+    /**
+     * Process args into read-only shared memory holding the binary document layout (see BinaryDocument),
+     * so that only a file descriptor crosses process boundaries
+     *
+     * @param args args
+     * @return file descriptor of shared memory, owned by caller, null if shared memory is not available
+     */
+    @Throws(IllegalStateException::class)
+    fun processToSharedMemory(args: Array<String>): ParcelFileDescriptor?
+}
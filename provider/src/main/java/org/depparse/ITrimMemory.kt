@@ -0,0 +1,11 @@
+package org.depparse
+
+interface ITrimMemory {
+
+    /**
+     * Release memory under pressure, staying loaded: what is released loads back on demand, no cold reload
+     *
+     * @param level level, as in ComponentCallbacks2.onTrimMemory
+     */
+    fun trim(level: Int)
+}
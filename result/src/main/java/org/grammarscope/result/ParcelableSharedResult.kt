@@ -0,0 +1,59 @@
+package org.grammarscope.result
+
+import android.os.Parcel
+import android.os.ParcelFileDescriptor
+import android.os.Parcelable
+import org.depparse.BinaryDocument
+import org.depparse.Sentence
+
+/**
+ * Result held in read-only shared memory: only the file descriptor is parcelled,
+ * whatever the result size, the receiver maps it and decodes sentences
+ */
+class ParcelableSharedResult : Parcelable {
+
+    /**
+     * Shared memory holding the binary document
+     */
+    val fd: ParcelFileDescriptor
+
+    constructor(fd0: ParcelFileDescriptor) {
+        fd = fd0
+    }
+
+    constructor(parcel: Parcel) {
+        fd = ParcelFileDescriptor.CREATOR.createFromParcel(parcel)
+    }
+
+    /**
+     * Decode result, shared memory is released
+     */
+    val result: Array<Sentence>
+        get() = BinaryDocument.read(fd)
+
+    override fun describeContents(): Int {
+        return Parcelable.CONTENTS_FILE_DESCRIPTOR
+    }
+
+    // W R I T E
+
+    override fun writeToParcel(parcel: Parcel, flags: Int) {
+        fd.writeToParcel(parcel, flags)
+    }
+
+    companion object {
+
+        @Suppress("unused")
+        @JvmField
+        val CREATOR: Parcelable.Creator<ParcelableSharedResult> = object : Parcelable.Creator<ParcelableSharedResult> {
+
+            override fun createFromParcel(`in`: Parcel): ParcelableSharedResult {
+                return ParcelableSharedResult(`in`)
+            }
+
+            override fun newArray(size: Int): Array<ParcelableSharedResult?> {
+                return arrayOfNulls(size)
+            }
+        }
+    }
+}
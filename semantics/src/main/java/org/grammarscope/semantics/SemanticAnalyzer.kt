@@ -1,6 +1,8 @@
 package org.grammarscope.semantics
 
 import android.util.Log
+import org.depparse.NativeDocument
+import org.depparse.SemanticTuples
 import org.depparse.Sentence
 import org.depparse.Token
 
@@ -20,7 +22,8 @@ class SemanticAnalyzer {
 
     private fun getRoots(sentence: Sentence): Collection<Token> {
         val result: MutableList<Token> = ArrayList()
-        for (token in sentence.tokens) {
+        val candidates = sentence.tree?.roots()?.map { sentence.tokens[it] } ?: sentence.tokens.asList()
+        for (token in candidates) {
             if (token.head == -1 && "root" == token.label) {
                 result.add(token)
             }
@@ -77,6 +80,43 @@ class SemanticAnalyzer {
         return analyses
     }
 
+    /**
+     * Analyze natively parsed document, relations being extracted natively.
+     * Only sentences that have relations are materialized.
+     *
+     * @param document native document
+     * @param threads number of threads sentences are shared between, 1 to analyze on the calling thread
+     * @return analyses, one per sentence
+     */
+    fun analyze(document: NativeDocument, threads: Int = 1): Array<Analysis> {
+        val labels = arrayOf(
+            SemanticRelations.PredicateRelations,
+            SemanticRelations.SubjectRelations,
+            SemanticRelations.ObjectRelations,
+            SemanticRelations.TermModifierRelations,
+            SemanticRelations.PredicateModifierRelations
+        )
+            .map { it.toTypedArray() }
+            .toTypedArray()
+        val tuples = document.semantics(labels, threads)
+
+        val analyses = Array(document.size) { Analysis(document.text(it)) }
+        for (r in 0..<tuples.size) {
+            val sentenceIdx = tuples.sentence(r)
+            val tokens = document[sentenceIdx].tokens
+            val predicate = tokens[tuples.predicate(r)]
+            val argument = tokens[tuples.argument(r)]
+            val relation = when (tuples.role(r)) {
+                SemanticTuples.ROLE_SUBJECT -> PS(sentenceIdx + 1, predicate, argument, argument.label)
+                SemanticTuples.ROLE_OBJECT -> PO(sentenceIdx + 1, predicate, argument, argument.label)
+                SemanticTuples.ROLE_PREDICATE -> PP(sentenceIdx + 1, predicate, argument, argument.label)
+                else -> TP(sentenceIdx + 1, argument, predicate, predicate.label)
+            }
+            analyses[sentenceIdx].add(relation)
+        }
+        return analyses
+    }
+
     /**
      * Analyze predicate
      *
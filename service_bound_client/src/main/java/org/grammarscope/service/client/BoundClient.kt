@@ -5,6 +5,7 @@ import android.content.Context
 import android.content.Intent
 import android.content.ServiceConnection
 import android.os.IBinder
+import android.os.ParcelFileDescriptor
 import android.util.Log
 import org.depparse.Broadcast
 import org.depparse.IProvider
@@ -124,6 +125,17 @@ abstract class BoundClient<R>(private val context: Context, service0: String) :
         return binder!!.process(args)
     }
 
+    /**
+     * Process args into shared memory, to be decoded by org.depparse.BinaryDocument
+     *
+     * @param args args
+     * @return file descriptor of shared memory, owned by caller, null if service does not support it
+     */
+    @Throws(IllegalStateException::class)
+    fun processToSharedMemory(args: Array<String>): ParcelFileDescriptor? {
+        return binder!!.processToSharedMemory(args)
+    }
+
     override fun request(args: Array<String>) {
         if (resultSink != null) {
             resultSink!!.onResult(binder!!.process(args))
@@ -142,6 +154,15 @@ abstract class BoundClient<R>(private val context: Context, service0: String) :
         } else binder!!.getVersion()
     }
 
+    /**
+     * Poll native metrics of service, to be decoded by org.depparse.Metrics
+     *
+     * @return packed snapshot, null if not bound or if service does not support it
+     */
+    fun getMetrics(): LongArray? {
+        return binder?.getMetrics()
+    }
+
     // L I F E C Y C L E
 
     override fun kill() {
@@ -4,12 +4,17 @@ import android.app.Service
 import android.content.Intent
 import android.os.Binder
 import android.os.IBinder
+import android.os.ParcelFileDescriptor
 import android.util.Log
 import kotlinx.coroutines.CoroutineScope
 import kotlinx.coroutines.Dispatchers
 import kotlinx.coroutines.SupervisorJob
 import kotlinx.coroutines.cancel
+import kotlinx.coroutines.launch
+import org.depparse.IMetricsProvider
 import org.depparse.IProvider
+import org.depparse.ISharedMemoryProvider
+import org.depparse.ITrimMemory
 import org.grammarscope.service.IParceler
 import org.grammarscope.service.iface.IServiceBinder
 
@@ -30,6 +35,11 @@ abstract class BoundService<R> : Service() {
             return provider.process(args)
         }
 
+        @Throws(IllegalStateException::class)
+        override fun processToSharedMemory(args: Array<String>): ParcelFileDescriptor? {
+            return (provider as? ISharedMemoryProvider)?.processToSharedMemory(args)
+        }
+
         override fun getStatus(): Int {
             return provider.getStatus() or IProvider.STATUS_EMBEDDED
         }
@@ -37,6 +47,10 @@ abstract class BoundService<R> : Service() {
         override fun getVersion(): String {
             return provider.getVersion()
         }
+
+        override fun getMetrics(): LongArray? {
+            return (provider as? IMetricsProvider)?.metrics()
+        }
     }
 
     /**
@@ -62,6 +76,39 @@ abstract class BoundService<R> : Service() {
         return ServiceBinder(provider)
     }
 
+    /**
+     * Handle model updates pushed to the running service (ACTION_SWAP_MODEL with EXTRA_MODEL_PATH)
+     */
+    override fun onStartCommand(intent: Intent?, flags: Int, startId: Int): Int {
+        if (intent?.action == ACTION_SWAP_MODEL) {
+            val modelPath = intent.getStringExtra(EXTRA_MODEL_PATH)
+            if (modelPath != null) {
+                Log.d(TAG, "Swapping model $modelPath")
+                serviceScope.launch {
+                    swapModel(modelPath)
+                }
+            }
+        }
+        return START_NOT_STICKY
+    }
+
+    /**
+     * Replace model while requests keep being served, nothing by default
+     *
+     * @param modelPath model path
+     */
+    protected open suspend fun swapModel(modelPath: String) {
+    }
+
+    /**
+     * Release provider memory under pressure, provider staying loaded
+     */
+    override fun onTrimMemory(level: Int) {
+        super.onTrimMemory(level)
+        Log.d(TAG, "Trimming memory $level")
+        (provider as? ITrimMemory)?.trim(level)
+    }
+
     /**
      * Called by the system to notify a Service that it is no longer used and is being removed.  The
      * service should clean up any resources it holds (threads, registered
@@ -76,5 +123,9 @@ abstract class BoundService<R> : Service() {
     companion object {
 
         private const val TAG = "SBound"
+
+        const val ACTION_SWAP_MODEL = "org.grammarscope.service.SWAP_MODEL"
+
+        const val EXTRA_MODEL_PATH = "model_path"
     }
 }
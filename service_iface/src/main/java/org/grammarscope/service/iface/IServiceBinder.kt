@@ -1,5 +1,7 @@
 package org.grammarscope.service.iface
 
+import android.os.ParcelFileDescriptor
+
 interface IServiceBinder<R> {
 
     /**
@@ -23,4 +25,25 @@ interface IServiceBinder<R> {
      */
     @Throws(IllegalStateException::class)
     fun process(args: Array<String>): R
+
+    /**
+     * Process args into read-only shared memory holding the binary document layout,
+     * so that large results cross process boundaries as a single file descriptor
+     *
+     * @param args args
+     * @return file descriptor of shared memory, owned by caller, null if not supported
+     */
+    @Throws(IllegalStateException::class)
+    fun processToSharedMemory(args: Array<String>): ParcelFileDescriptor? {
+        return null
+    }
+
+    /**
+     * Get native metrics of provider, to be polled (see org.depparse.Metrics for layout)
+     *
+     * @return packed snapshot, null if not supported
+     */
+    fun getMetrics(): LongArray? {
+        return null
+    }
 }
@@ -3,4 +3,9 @@ package org.depparse
 interface IAsyncLoading {
 
     suspend fun loadAsync(modelPath: String)
+
+    /**
+     * Replace loaded model, requests being served throughout by engines that support it, plain load otherwise
+     */
+    suspend fun swapAsync(modelPath: String) = loadAsync(modelPath)
 }
@@ -5,6 +5,14 @@ plugins {
 private val vCompileSdk by lazy { rootProject.extra["compileSdk"] as Int }
 private val vMinSdk by lazy { rootProject.extra["minSdk"] as Int }
 
+// optimized native release: -Pdepparse.profile=<file.profdata> (PGO and ThinLTO, profile made by make-pgo.sh) or -Pdepparse.lto=true (ThinLTO)
+private val vOptimizeArguments by lazy {
+    val arguments = mutableListOf<String>()
+    (findProperty("depparse.profile") as String?)?.let { arguments += "-DDEPPARSE_PROFILE_USE=${rootProject.file(it).absolutePath}" }
+    if (findProperty("depparse.lto")?.toString() == "true") arguments += "-DDEPPARSE_LTO=ON"
+    arguments
+}
+
 android {
 
     namespace = "org.depparse.syntaxnet2"
@@ -41,6 +49,11 @@ android {
         release {
             proguardFiles(getDefaultProguardFile("proguard-android-optimize.txt"), "proguard-rules.pro")
             isJniDebuggable = false
+            externalNativeBuild {
+                cmake {
+                    arguments(*vOptimizeArguments.toTypedArray())
+                }
+            }
         }
 
         debug {
@@ -0,0 +1,181 @@
+/* Copyright 2018
+ * Bernard Bou
+ * 1313ou@gmail.com */
+
+#include <string>
+#include <vector>
+#include <cstdlib>
+
+#include "syntaxnet2/convert.h"
+#include "depparse_native/char_indices.h"
+#include "depparse_native/metrics.h"
+
+using namespace std;
+
+// K E Y S
+
+static const string kText = "text";
+static const string kDocId = "docid";
+static const string kWord = "word";
+static const string kCategory = "category";
+static const string kTag = "tag";
+static const string kHead = "head";
+static const string kLabel = "label";
+static const string kStart = "start";
+static const string kEnd = "end";
+static const string kBreakLevel = "breaklevel";
+
+static const string kEmpty;
+
+// L O O K U P   H E L P E R S
+
+static inline const string &valueOf(const token_t &token, const string &key) {
+    auto it = token.find(key);
+    return it != token.end() ? it->second : kEmpty;
+}
+
+static inline int intValueOf(const token_t &token, const string &key) {
+    auto it = token.find(key);
+    return it != token.end() ? static_cast<int>(strtol(it->second.c_str(), nullptr, 10)) : -1;
+}
+
+// C O N V E R T
+
+/**
+ * Append a parsed sentence to document
+ *
+ * @param parsed_sentence parsed syntaxnet sentence, token[0] holding sentence data
+ * @param doc document to append to
+ * @param token_base byte offset subtracted from token offsets to make them relative to sentence text
+ * @param fields fields to convert (bit mask), others are left out
+ * @return false if sentence has no token
+ */
+static bool
+toDocumentSentence(const sentence_t &parsed_sentence, document_t &doc, int token_base, int32_t fields) {
+
+    int nTokens = (int) parsed_sentence.size();
+    if (nTokens == 0) {
+        return false;
+    }
+
+    // Sentence text as token[0] (text as token[0]["text"], docid as token[0]["docid"]
+
+    const token_t &token0 = parsed_sentence[0];
+
+    const string &text = valueOf(token0, kText);
+    const bool offsets = (fields & kFieldOffsets) != 0;
+    vector<int> toCharIndices;
+    if (offsets)
+        getCharIndices(text, toCharIndices);
+
+    doc.sentences.emplace_back();
+    doc_sentence_t &sentence = doc.sentences.back();
+    sentence.text = doc.strings.add(text);
+    sentence.docid = doc.strings.intern(valueOf(token0, kDocId));
+    sentence.start = offsets ? toCharIndex(toCharIndices, intValueOf(token0, kStart)) : -1;
+    sentence.end = offsets ? toCharIndex(toCharIndices, intValueOf(token0, kEnd)) : -1;
+    sentence.first_token = static_cast<int32_t>(doc.tokens.size());
+    sentence.token_count = nTokens - 1;
+
+    // Tokens, syntaxnet has no enhanced dependencies (deps stay null), fields left out keep newToken defaults
+
+    for (int j = 1; j < nTokens; j++) {
+
+        const token_t &token = parsed_sentence[j];
+        doc_token_t &t = newToken(doc);
+
+        if ((fields & kFieldWord) != 0)
+            t.word = doc.strings.add(valueOf(token, kWord));
+        if ((fields & kFieldCategory) != 0)
+            t.category = doc.strings.intern(valueOf(token, kCategory));
+        if ((fields & kFieldTag) != 0)
+            t.tag = doc.strings.intern(valueOf(token, kTag));
+        if ((fields & kFieldLabel) != 0)
+            t.label = doc.strings.intern(valueOf(token, kLabel));
+        if ((fields & kFieldHead) != 0)
+            t.head = intValueOf(token, kHead);
+        if (offsets) {
+            t.start = toCharIndex(toCharIndices, intValueOf(token, kStart) - token_base);
+            t.end = toCharIndex(toCharIndices, intValueOf(token, kEnd) - token_base);
+        }
+        if ((fields & kFieldBreakLevel) != 0)
+            t.breaklevel = intValueOf(token, kBreakLevel);
+    }
+    return true;
+}
+
+bool
+toDocumentSentence(const sentence_t &parsed_sentence, document_t &doc) {
+    return toDocumentSentence(parsed_sentence, doc, 0, kFieldAll);
+}
+
+bool
+toDocument(const vector<sentence_t> &parsed_sentences, document_t &doc, int32_t fields) {
+    scoped_timer_t timer(metrics().convert);
+    const size_t sentences = doc.sentences.size();
+    const size_t tokens = doc.tokens.size();
+    for (const auto &parsed_sentence: parsed_sentences) {
+        if (!toDocumentSentence(parsed_sentence, doc, 0, fields)) {
+            return false;
+        }
+    }
+    recordConverted(doc.sentences.size() - sentences, doc.tokens.size() - tokens);
+    return true;
+}
+
+bool
+toDocument(const vector<sentence_t> &parsed_sentences, document_t &doc) {
+    return toDocument(parsed_sentences, doc, kFieldAll);
+}
+
+bool
+toDocumentSplit(const string &paragraph, int paragraphIndex, const vector<sentence_t> &split_parsed_sentences, document_t &doc) {
+    scoped_timer_t timer(metrics().convert);
+    const size_t sentences = doc.sentences.size();
+    const size_t tokens = doc.tokens.size();
+
+    vector<int> toCharIndices;
+    getCharIndices(paragraph, toCharIndices);
+    const string docid = to_string(paragraphIndex);
+
+    string::size_type from = 0;
+    for (const auto &parsed_sentence: split_parsed_sentences) {
+        if (parsed_sentence.empty()) {
+            return false;
+        }
+
+        // byte offset of sentence in paragraph: as reported if it checks out, else searched for past the previous sentence
+        const token_t &token0 = parsed_sentence[0];
+        const string &text = valueOf(token0, kText);
+        int reported = intValueOf(token0, kStart);
+        string::size_type base;
+        if (reported >= 0 && paragraph.compare(static_cast<string::size_type>(reported), text.size(), text) == 0)
+            base = static_cast<string::size_type>(reported);
+        else
+            base = text.empty() ? string::npos : paragraph.find(text, from);
+
+        // token offsets are paragraph-relative when the first one lies past the sentence start
+        int token_base = 0;
+        if (base != string::npos && base > 0 && parsed_sentence.size() > 1 && intValueOf(parsed_sentence[1], kStart) >= static_cast<int>(base))
+            token_base = static_cast<int>(base);
+
+        toDocumentSentence(parsed_sentence, doc, token_base, kFieldAll);
+
+        // sentence offsets are paragraph-relative char indices, end inclusive
+        doc_sentence_t &sentence = doc.sentences.back();
+        if (base != string::npos) {
+            sentence.start = toCharIndex(toCharIndices, static_cast<int>(base));
+            sentence.end = text.empty() ? sentence.start : toCharIndex(toCharIndices, static_cast<int>(base + text.size() - 1));
+            from = base + text.size();
+        } else {
+            sentence.start = -1;
+            sentence.end = -1;
+        }
+
+        // paragraph index as docid unless the backend sets one
+        if (sentence.docid == kEmptyString)
+            sentence.docid = doc.strings.intern(docid);
+    }
+    recordConverted(doc.sentences.size() - sentences, doc.tokens.size() - tokens);
+    return true;
+}
@@ -7,13 +7,25 @@
 #include <vector>
 #include <unistd.h>
 #include <iostream>
-#include <unistd.h>
-#include <codecvt>
-#include <locale>
+#include <cstring>
+#include <cerrno>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <sys/stat.h>
 
 #include <android/log.h>
 
 #include "syntaxnet2/iface_h.h"
+#include "syntaxnet2/iface_hp.h"
+#include "syntaxnet2/convert.h"
+#include "depparse_native/jni_sentences.h"
+#include "depparse_native/jni_document.h"
+#include "depparse_native/binary.h"
+#include "depparse_native/jni_pool.h"
+#include "depparse_native/jni_metrics.h"
+#include "depparse_native/preprocess.h"
+#include "depparse_native/trim.h"
 
 #define LOG_TAG    "SYNTAXNET_JNI"
 
@@ -26,11 +38,6 @@ using namespace std;
 
 const char kIllegalStateException[] = "java/lang/IllegalStateException";
 
-const char sentenceClass[] = "org/depparse/Sentence";
-const char tokenClass[] = "org/depparse/Token";
-const char sentenceCtor[] = "(Ljava/lang/String;II[Lorg/depparse/Token;Ljava/lang/String;)V";
-const char tokenCtor[] = "(IILjava/lang/String;IILjava/lang/String;Ljava/lang/String;ILjava/lang/String;ILjava/lang/String;)V";
-
 // C H E C K   H E L P E R S
 
 /**
@@ -49,51 +56,6 @@ T CheckNotNull(JNIEnv *env, T &&t) {
     return std::forward<T>(t);
 }
 
-// T O   C H A R   I N D E X   H E L P E R
-
-/**
- * Creates a mapping from UTF-8 byte positions to character indices.
- *
- * @param text The UTF-8 encoded string to process
- * @return A vector where each index represents a byte position, and the value is the corresponding character index
- */
-vector<int> getCharIndices(const string &text) {
-    // Get the byte size of the UTF-8 string
-    size_t byteSize = text.size();
-
-    // Create vector for byte-to-char index mapping (size + 1 to include position after last byte)
-    vector<int> byteToCharIndex(byteSize + 1);
-
-    // Convert to wstring to work with Unicode code points properly
-    wstring_convert<codecvt_utf8<wchar_t>> converter;
-    wstring wideText = converter.from_bytes(text);
-
-    // Iterate through each Unicode character
-    size_t bytePos = 0;
-    for (size_t i = 0; i < wideText.size(); ++i) {
-        wchar_t ch = wideText[i];
-
-        // Convert this single character back to UTF-8 to get its byte count
-        string charBytes = converter.to_bytes(ch);
-        size_t charByteCount = charBytes.size();
-
-        // Fill in the byte-to-char mapping for each byte in this character
-        for (size_t j = 0; j < charByteCount; ++j) {
-            if (bytePos + j < byteToCharIndex.size()) {
-                byteToCharIndex[bytePos + j] = static_cast<int>(i);
-            }
-        }
-        bytePos += charByteCount;
-    }
-
-    // Set the final position
-    if (bytePos < byteToCharIndex.size()) {
-        byteToCharIndex[bytePos] = static_cast<int>(wideText.size());
-    }
-
-    return byteToCharIndex;
-}
-
 // C O N V E R S I O N   H E L P E R S
 
 /*
@@ -107,14 +69,24 @@ void stringVectorToCStringArray(const vector<string> &texts, const char *c_texts
 
 // F R O M   J A V A
 
+/**
+ * Input texts, preprocessed in one pass each (see preprocess.h)
+ *
+ * @param flags kPreprocess* flags
+ * @param hashes content hashes of preprocessed texts to fill, if not null
+ */
 extern
-vector<string> jniStringArrayToVector(JNIEnv *env, jobjectArray string_array) {
+vector<string> jniStringArrayToVector(JNIEnv *env, jobjectArray string_array, int32_t flags, vector<uint64_t> *hashes = nullptr) {
     int count = env->GetArrayLength(string_array);
-    vector<string> result;
+    vector<string> result(count);
+    if (hashes != nullptr)
+        hashes->resize(count);
     for (int i = 0; i < count; i++) {
         auto jstr = reinterpret_cast<jstring>(env->GetObjectArrayElement(string_array, i));
         const char *raw_str = env->GetStringUTFChars(jstr, JNI_FALSE);
-        result.emplace_back(raw_str);
+        uint64_t hash = preprocessText(raw_str, static_cast<size_t>(env->GetStringUTFLength(jstr)), flags, result[i]);
+        if (hashes != nullptr)
+            (*hashes)[i] = hash;
         env->ReleaseStringUTFChars(jstr, raw_str);
     }
     return result;
@@ -130,256 +102,520 @@ string jniStringToString(JNIEnv *env, jstring jstr) {
 // T O   J A V A
 
 /**
- * Returns a Java sentence
+ * Returns an array of Java sentences
  *
  * @param env environment
- * @param parsed_sentence parsed C sentence, non-null
- * @param sentenceIndex sentence index
- * @param sentence_class java class of sentence
- * @param sentence_ctor java constructor
- * @param token_class java class of token
- * @param token_ctor java constructor of token
- * @return Sentence with tokens field being Array<Token!!>!! otherwise
- * @throws IllegalStateException whenever CheckNull encounters a null value, that is
- * -word is null (should not happen)
- * -category, label, tag are guarded against being null by being set to empty string at token level
- * -text, docIds are guarded against being null by being set to empty string at sentence level
- */
-jobject
-toJavaSentence(
+ * @param parsed_sentences non-null array of parsed sentences
+ * @param fields fields to convert and materialize (bit mask of kField*)
+ * @return array of java sentences, Array<Array<Token!!>!!>!! or an exception is thrown
+ * @throws IllegalStateException whenever
+ * - classes Sentence and Token and their constructors could not be retrieved
+ * - array of sentences could not be created
+ * - one parsed sentence has no token
+ */
+jobjectArray
+toJavaSentences(
         JNIEnv *env,
-        const sentence_t &parsed_sentence,
-        int sentenceIndex,
-        jclass sentence_class,
-        jmethodID sentence_ctor,
-        jclass token_class,
-        jmethodID token_ctor) {
+        const vector<sentence_t> &parsed_sentences,
+        int32_t fields = kFieldAll) {
+
+    // convert
+    fields = neededFields(fields);
+    document_t doc;
+    if (!toDocument(parsed_sentences, doc, fields)) {
+        env->ThrowNew(env->FindClass(kIllegalStateException), "No token in sentence");
+        return nullptr;
+    }
+    LOGD("Converted %zu sentences, %zu tokens\n", doc.sentences.size(), doc.tokens.size());
 
-    int nTokens = (int) parsed_sentence.size();
+    // materialize
+    return toJavaSentences(env, viewOf(doc), fields);
+}
 
-    // make java array of tokens Token[] to be field of Sentence class and return back to Java
+// N A T I V E   I N T E R F A C E
 
-    jobjectArray jtoken_array = CheckNotNull(env, env->NewObjectArray(nTokens - 1, token_class, nullptr));
-    if (env->ExceptionCheck()) {
-        return nullptr;
-    }
+/**
+ * Path of last model loaded or swapped in, by any thread
+ */
+static mutex model_path_mutex;
+static string model_path;
 
-    // Sentence text as token[0] (text as token[0]["text"], docid as token[0]["docid"]
+static void setModelPath(const string &path) {
+    lock_guard<mutex> lock(model_path_mutex);
+    model_path = path;
+}
 
-    const token_t &token0 = parsed_sentence[0];
+static string lastModelPath() {
+    lock_guard<mutex> lock(model_path_mutex);
+    return model_path;
+}
 
-    const string &text = token0.at("text");
-    const vector<int> toCharIndices = getCharIndices(text);
+// u t i l s
 
-    auto it0 = token0.find("docid");
-    const string &docid = it0 != token0.end() ? it0->second : "";
+/**
+ * Native version function callable from Java
+ */
+extern "C" JNIEXPORT
+jint
+JNICALL Java_org_syntaxnet2_JNI2_version(
+        JNIEnv *env,
+        jobject type) {
 
-    it0 = token0.find("start");
-    const string &s_start = it0 != token0.end() ? it0->second : "-1";
-    int s_istart = strtol(s_start.c_str(), nullptr, 10);
-    if (s_istart != -1)
-        s_istart = toCharIndices[s_istart];
+    (void) env;
+    (void) type;
+    int version = sni_version();
+    return version;
+}
 
-    it0 = token0.find("end");
-    const string &s_end = it0 != token0.end() ? it0->second : "-1";
-    int s_iend = strtol(s_end.c_str(), nullptr, 10);
-    if (s_iend != -1)
-        s_iend = toCharIndices[s_iend];
+/**
+ * Native modelPath function callable from Java
+ */
+extern "C" JNIEXPORT
+jstring
+JNICALL Java_org_syntaxnet2_JNI2_modelPath(
+        JNIEnv *env,
+        jobject /* thiz */) {
 
-    // Tokens
+    const string s = lastModelPath();
+    return env->NewStringUTF(s.c_str());
+}
 
-    for (int j = 1; j < nTokens; j++) {
+// l o a d / u n l o a d
 
-        // collect token data
+/**
+ * Name of the frozen (pre-optimized) graph inside a model directory
+ */
+const char kFrozenGraph[] = "frozen_graph.pb";
 
-        const token_t &token = parsed_sentence[j];
+/**
+ * Duration of last load, in milliseconds
+ */
+static atomic<long> load_millis(-1);
 
-        const string &word = token.at("word");
+/**
+ * Whether model is a frozen graph: a .pb file or a directory holding one
+ */
+static bool isFrozenModel(const string &path) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        return false;
+    }
+    if (S_ISREG(st.st_mode)) {
+        return path.size() > 3 && path.compare(path.size() - 3, 3, ".pb") == 0;
+    }
+    if (S_ISDIR(st.st_mode)) {
+        string graph = path + '/' + kFrozenGraph;
+        return stat(graph.c_str(), &st) == 0 && S_ISREG(st.st_mode);
+    }
+    return false;
+}
 
-        auto it = token.find("category");
-        const string &category = it != token.end() ? it->second : "";
+static long loadRegular(const char *model) {
+    return sni_load_h(model);
+}
 
-        it = token.find("tag");
-        const string &tag = it != token.end() ? it->second : "";
+static long loadFrozen(const char *model) {
+    return sni_load_h(model, true);
+}
 
-        it = token.find("head");
-        const string &head = it != token.end() ? it->second : "-1";
+/**
+ * Backend entry points for parse context pools, regular and frozen models
+ */
+const backend_t kBackend = {loadRegular, sni_unload_h};
+const backend_t kFrozenBackend = {loadFrozen, sni_unload_h};
 
-        it = token.find("label");
-        const string &label = it != token.end() ? it->second : "";
+/**
+ * Load model into a pool of parse contexts, frozen graphs through the fast path, and time it
+ *
+ * @return Java handle, 0 if model could not be loaded
+ */
+static jlong loadTimed(const string &path, bool is_frozen, int size) {
+    auto t0 = chrono::steady_clock::now();
+    auto *pool = new model_pool_t(is_frozen ? kFrozenBackend : kBackend, size);
+    bool loaded = pool->load(path);
+    auto t1 = chrono::steady_clock::now();
+    long millis = static_cast<long>(chrono::duration_cast<chrono::milliseconds>(t1 - t0).count());
+    load_millis = millis;
+    LOGD("Loaded %s model %s in %ld ms\n", is_frozen ? "frozen" : "regular", path.c_str(), millis);
+    if (!loaded) {
+        delete pool;
+        return 0;
+    }
+    return toHandle(pool);
+}
 
-        it = token.find("start");
-        const string &t_start = it != token.end() ? it->second : "-1";
+/**
+ * Native load function callable from Java, single parse context
+ * Frozen models are detected and loaded through the fast path
+ */
+extern "C" JNIEXPORT
+jlong
+JNICALL Java_org_syntaxnet2_JNI2_load(
+        JNIEnv *env,
+        jobject type,
+        jstring j_model_path) {
 
-        it = token.find("end");
-        const string &t_end = it != token.end() ? it->second : "-1";
+    (void) type;
+    string path = jniStringToString(env, j_model_path);
+    setModelPath(path);
 
-        it = token.find("breaklevel");
-        const string &breaklevel = it != token.end() ? it->second : "-1";
+    return loadTimed(path, isFrozenModel(path), 1);
+}
 
-        LOGD("Token #%d '%s' l=%s t=%s h=%s\n", j, word.c_str(), label.c_str(), tag.c_str(), head.c_str());
+/**
+ * Native loadModel function callable from Java
+ * Model kind is given by caller
+ */
+extern "C" JNIEXPORT
+jlong
+JNICALL Java_org_syntaxnet2_JNI2_loadModel(
+        JNIEnv *env,
+        jobject type,
+        jstring j_model_path,
+        jboolean is_frozen) {
 
-        // token constructor parameters
+    (void) type;
+    string path = jniStringToString(env, j_model_path);
+    setModelPath(path);
 
-        jstring jword = CheckNotNull(env, env->NewStringUTF(word.c_str()));
-        int t_istart = strtol(t_start.c_str(), nullptr, 10);
-        int t_iend = strtol(t_end.c_str(), nullptr, 10);
-        if (t_istart != -1)
-            t_istart = toCharIndices[t_istart];
-        if (t_iend != -1)
-            t_iend = toCharIndices[t_iend];
-        jstring jcategory = CheckNotNull(env, env->NewStringUTF(category.c_str()));
-        jstring jtag = CheckNotNull(env, env->NewStringUTF(tag.c_str()));
-        jstring jlabel = CheckNotNull(env, env->NewStringUTF(label.c_str()));
-        int ihead = strtol(head.c_str(), nullptr, 10);
-        int ibreaklevel = strtol(breaklevel.c_str(), nullptr, 10);
+    return loadTimed(path, is_frozen != JNI_FALSE, 1);
+}
 
-        // make java token
-        // jword: String!!, possibly ""
-        // istart: Int!!, possibly -1
-        // iend: Int!!, possibly -1
-        // jcategory!!: String!!, possibly ""
-        // jtag: String!!
-        // ihead: Int!!, possibly -1
-        // jlabel: String!!, possibly ""
-        // ibreaklevel: Int!!, possibly -1
-        jobject jtoken = CheckNotNull(env, env->NewObject(token_class, token_ctor, sentenceIndex, j - 1, jword, t_istart, t_iend, jcategory, jtag, ihead, jlabel, ibreaklevel, nullptr));
-        if (env->ExceptionCheck()) {
-            return nullptr;
-        }
+/**
+ * Native loadPool function callable from Java
+ * Up to size parse contexts are loaded on demand so that as many parse calls can run concurrently,
+ * each context being a model instance of its own
+ */
+extern "C" JNIEXPORT
+jlong
+JNICALL Java_org_syntaxnet2_JNI2_loadPool(
+        JNIEnv *env,
+        jobject type,
+        jstring j_model_path,
+        jint size) {
 
-        // set token in array
+    (void) type;
+    string path = jniStringToString(env, j_model_path);
+    setModelPath(path);
 
-        env->SetObjectArrayElement(jtoken_array, j - 1, jtoken);
-    }
+    return loadTimed(path, isFrozenModel(path), size);
+}
 
-    // make sentence
+/**
+ * Native loadMillis function callable from Java
+ *
+ * @return duration of last load in milliseconds, -1 if none
+ */
+extern "C" JNIEXPORT
+jlong
+JNICALL Java_org_syntaxnet2_JNI2_loadMillis(
+        JNIEnv *env,
+        jobject type) {
 
-    jstring jtext = CheckNotNull(env, env->NewStringUTF(text.c_str()));
-    jstring jdocid = CheckNotNull(env, env->NewStringUTF(docid.c_str()));
-    jobject jsentence = env->NewObject(sentence_class, sentence_ctor, jtext, s_istart, s_iend, jtoken_array, jdocid);
-    return jsentence;
+    (void) env;
+    (void) type;
+    return load_millis;
 }
 
 /**
- * Returns an array of Java sentences
+ * Native swap function callable from Java
+ * The new model is loaded while calls keep being served by the current one, new calls then go to the new model,
+ * the current one being unloaded once calls in flight are done with it
+ * Frozen models are detected and loaded through the fast path
  *
- * @param env environment
- * @param parsed_sentences non-null array of parsed sentences
- * @return array of java sentences, Array<Array<Token!!>!!>!! or an exception is thrown
- * @throws IllegalStateException whenever
- * - classes Sentence and Token and their constructors could not be retrieved
- * - array of sentences could not be created
- * - one parsed sentence has no token
+ * @return false if the new model could not be loaded, the current model being kept
  */
-jobjectArray
-toJavaSentences(
+extern "C" JNIEXPORT
+jboolean
+JNICALL Java_org_syntaxnet2_JNI2_swap(
         JNIEnv *env,
-        const vector<sentence_t> &parsed_sentences) {
+        jobject type,
+        jlong handle,
+        jstring j_model_path) {
 
-    // check
-    int i = 0;
-    for (const auto &parsed_sentence: parsed_sentences) {
-        LOGD("Sentence #%d: %zu tokens\n", i++, parsed_sentence.size());
-        if (parsed_sentence.empty()) {
-            env->ThrowNew(env->FindClass(kIllegalStateException), "No token in sentence");
-            return nullptr;
-        }
+    (void) type;
+    shared_ptr<model_pool_t> pool = poolOf(handle);
+    if (!pool) {
+        env->ThrowNew(env->FindClass(kIllegalStateException), "Cannot swap null handle");
+        return JNI_FALSE;
     }
+    string path = jniStringToString(env, j_model_path);
+    bool is_frozen = isFrozenModel(path);
+    auto t0 = chrono::steady_clock::now();
+    bool loaded = pool->load(path, is_frozen ? kFrozenBackend : kBackend);
+    auto t1 = chrono::steady_clock::now();
+    long millis = static_cast<long>(chrono::duration_cast<chrono::milliseconds>(t1 - t0).count());
+    load_millis = millis;
+    LOGD("Swapped in %s model %s in %ld ms\n", is_frozen ? "frozen" : "regular", path.c_str(), millis);
+    if (!loaded)
+        return JNI_FALSE;
+    setModelPath(path);
+    return JNI_TRUE;
+}
 
-    // classes and constructors
+/**
+ * Native trim function callable from Java
+ * Releases memory according to level (that of onTrimMemory), handle staying valid: idle contexts beyond the first
+ * are unloaded and load back on demand, speculative results are dropped, page cache of model files is dropped
+ * (models already read into memory stay), free heap pages are returned
+ *
+ * @return number of contexts unloaded
+ */
+extern "C" JNIEXPORT
+jint
+JNICALL Java_org_syntaxnet2_JNI2_trim(
+        JNIEnv *env,
+        jobject type,
+        jlong handle,
+        jint level) {
 
-    jclass sentence_class = CheckNotNull(env, env->FindClass(sentenceClass));
-    if (env->ExceptionCheck()) {
-        return nullptr;
-    }
-    jmethodID sentence_ctor = CheckNotNull(env, env->GetMethodID(sentence_class, "<init>", sentenceCtor));
-    if (env->ExceptionCheck()) {
-        return nullptr;
+    (void) type;
+    shared_ptr<model_pool_t> pool = poolOf(handle);
+    if (!pool) {
+        env->ThrowNew(env->FindClass(kIllegalStateException), "Cannot trim null handle");
+        return 0;
     }
-    jclass token_class = CheckNotNull(env, env->FindClass(tokenClass));
-    if (env->ExceptionCheck()) {
+    int trimmed = trimMemory(*pool, level);
+    LOGD("Trimmed %d contexts at level %d\n", trimmed, level);
+    return trimmed;
+}
+
+/**
+ * Native batchState function callable from Java
+ * State of batch sizing, indexed by batch_state_t
+ */
+extern "C" JNIEXPORT
+jlongArray
+JNICALL Java_org_syntaxnet2_JNI2_batchState(
+        JNIEnv *env,
+        jobject type,
+        jlong handle) {
+
+    (void) type;
+    shared_ptr<model_pool_t> pool = poolOf(handle);
+    if (!pool) {
+        env->ThrowNew(env->FindClass(kIllegalStateException), "Cannot query null handle");
         return nullptr;
     }
-    jmethodID token_ctor = CheckNotNull(env, env->GetMethodID(token_class, "<init>", tokenCtor));
-    if (env->ExceptionCheck()) {
+    jlong state[kBatchStateSize];
+    int64_t values[kBatchStateSize];
+    pool->batching.snapshot(values);
+    for (int i = 0; i < kBatchStateSize; i++)
+        state[i] = static_cast<jlong>(values[i]);
+    jlongArray array = env->NewLongArray(kBatchStateSize);
+    if (array == nullptr)
         return nullptr;
-    }
+    env->SetLongArrayRegion(array, 0, kBatchStateSize, state);
+    return array;
+}
 
-    // make Array<Sentence> to return back to Java
+/**
+ * Native setBatchTarget function callable from Java
+ * Batches are sized so that each takes about the target latency
+ */
+extern "C" JNIEXPORT
+void
+JNICALL Java_org_syntaxnet2_JNI2_setBatchTarget(
+        JNIEnv *env,
+        jobject type,
+        jlong handle,
+        jint millis) {
 
-    int n = static_cast<int>(parsed_sentences.size());
-    jobjectArray sentence_array = CheckNotNull(env, env->NewObjectArray(n, sentence_class, nullptr));
-    if (env->ExceptionCheck()) {
-        return nullptr;
+    (void) type;
+    shared_ptr<model_pool_t> pool = poolOf(handle);
+    if (!pool) {
+        env->ThrowNew(env->FindClass(kIllegalStateException), "Cannot configure null handle");
+        return;
     }
+    pool->batching.setTarget(static_cast<int64_t>(millis) * 1000000);
+}
 
-    // fill Array<Sentence> to return back to Java
+/**
+ * Native setPreprocessing function callable from Java
+ * Preprocessing of input texts of subsequent parse calls (kPreprocess* flags in preprocess.h)
+ */
+extern "C" JNIEXPORT
+void
+JNICALL Java_org_syntaxnet2_JNI2_setPreprocessing(
+        JNIEnv *env,
+        jobject type,
+        jlong handle,
+        jint flags) {
 
-    i = 0;
-    for (const auto &parsed_sentence: parsed_sentences) {
-        jobject jsentence = toJavaSentence(env, parsed_sentence, i, sentence_class, sentence_ctor, token_class, token_ctor);
-        env->SetObjectArrayElement(sentence_array, i, jsentence);
-        i++;
+    (void) type;
+    shared_ptr<model_pool_t> pool = poolOf(handle);
+    if (!pool) {
+        env->ThrowNew(env->FindClass(kIllegalStateException), "Cannot configure null handle");
+        return;
     }
-    return sentence_array;
+    pool->preprocessing = static_cast<int32_t>(flags);
 }
 
-// N A T I V E   I N T E R F A C E
+// b a t c h
 
-string model_path;
+/**
+ * Parse texts and convert them into document in batches sized by the pool's controller (see withBatches)
+ *
+ * @param parsed_by if not null, set to the path of the model that parsed all batches, empty if a swap came in between
+ * @return false if no context could be acquired or a sentence has no token, an IllegalStateException being pending
+ */
+static bool parseInBatches(JNIEnv *env, model_pool_t &pool, const vector<string> &texts, document_t &doc, string *parsed_by = nullptr) {
+    vector<sentence_t> parsed_sentences;
+    bool parsed = withBatches(env, pool, texts,
+                              [&](long context, const vector<string> &batch) {
+                                  parsed_sentences.clear();
+                                  sni_parse_h(context, batch, parsed_sentences);
+                              },
+                              [&](size_t &tokens) {
+                                  size_t before = doc.tokens.size();
+                                  bool converted = toDocument(parsed_sentences, doc);
+                                  tokens = doc.tokens.size() - before;
+                                  return converted;
+                              },
+                              parsed_by);
+    if (!parsed && !env->ExceptionCheck())
+        env->ThrowNew(env->FindClass(kIllegalStateException), "No token in sentence");
+    return parsed;
+}
 
-// u t i l s
+// s p e c u l a t e
 
 /**
- * Native version function callable from Java
+ * Parse of one text ahead of the call asking for it, run by the speculation worker
+ */
+static bool speculativeParse(long context, const string &text, document_t &doc) {
+    vector<sentence_t> parsed_sentences;
+    sni_parse_h(context, vector<string>(1, text), parsed_sentences);
+    return toDocument(parsed_sentences, doc);
+}
+
+/**
+ * Native speculate function callable from Java
+ * Texts likely to be asked for next are parsed on idle time, in order, replacing texts still queued,
+ * the results being taken by the next parse and parseToDocument calls on these texts
+ *
+ * @return number of texts queued
  */
 extern "C" JNIEXPORT
 jint
-JNICALL Java_org_syntaxnet2_JNI2_version(
+JNICALL Java_org_syntaxnet2_JNI2_speculate(
         JNIEnv *env,
-        jobject type) {
+        jobject type,
+        jlong handle,
+        jobjectArray input_texts) {
 
-    (void) env;
     (void) type;
-    int version = sni_version();
-    return version;
+    shared_ptr<model_pool_t> pool = poolOf(handle);
+    if (!pool) {
+        env->ThrowNew(env->FindClass(kIllegalStateException), "Cannot parse with null handle");
+        return 0;
+    }
+    vector<uint64_t> hashes;
+    vector<string> texts = jniStringArrayToVector(env, input_texts, pool->preprocessing, &hashes);
+    return static_cast<jint>(pool->speculation.speculate(std::move(texts), hashes, speculativeParse));
 }
 
 /**
- * Native modelPath function callable from Java
+ * Native clearSpeculation function callable from Java
+ * Queued texts and parsed results not taken yet are dropped
  */
 extern "C" JNIEXPORT
-jstring
-JNICALL Java_org_syntaxnet2_JNI2_modelPath(
+void
+JNICALL Java_org_syntaxnet2_JNI2_clearSpeculation(
         JNIEnv *env,
-        jobject /* thiz */) {
+        jobject type,
+        jlong handle) {
 
-    const string &s = model_path;
-    return env->NewStringUTF(s.c_str());
+    (void) type;
+    shared_ptr<model_pool_t> pool = poolOf(handle);
+    if (!pool) {
+        env->ThrowNew(env->FindClass(kIllegalStateException), "Cannot configure null handle");
+        return;
+    }
+    pool->speculation.clear();
 }
 
-// l o a d / u n l o a d
+/**
+ * Native speculationState function callable from Java
+ * State of speculative parsing (layout in speculation.h)
+ */
+extern "C" JNIEXPORT
+jlongArray
+JNICALL Java_org_syntaxnet2_JNI2_speculationState(
+        JNIEnv *env,
+        jobject type,
+        jlong handle) {
+
+    (void) type;
+    shared_ptr<model_pool_t> pool = poolOf(handle);
+    if (!pool) {
+        env->ThrowNew(env->FindClass(kIllegalStateException), "Cannot query null handle");
+        return nullptr;
+    }
+    jlong state[kSpeculationStateSize];
+    int64_t values[kSpeculationStateSize];
+    pool->speculation.snapshot(values);
+    for (int i = 0; i < kSpeculationStateSize; i++)
+        state[i] = static_cast<jlong>(values[i]);
+    jlongArray array = env->NewLongArray(kSpeculationStateSize);
+    if (array == nullptr)
+        return nullptr;
+    env->SetLongArrayRegion(array, 0, kSpeculationStateSize, state);
+    return array;
+}
 
 /**
- * Native load function callable from Java
+ * Native metricsSnapshot function callable from Java
+ * Latency histograms and throughput counters of this library since loaded (layout in metrics.h)
  */
 extern "C" JNIEXPORT
-jlong
-JNICALL Java_org_syntaxnet2_JNI2_load(
+jlongArray
+JNICALL Java_org_syntaxnet2_JNI2_metricsSnapshot(
+        JNIEnv *env,
+        jobject type) {
+
+    (void) type;
+    return toJavaMetrics(env);
+}
+
+/**
+ * Native startTrace function callable from Java
+ * Parse calls of this library are recorded to trace file until stopTrace (format in trace.h)
+ *
+ * @return false if trace file could not be opened
+ */
+extern "C" JNIEXPORT
+jboolean
+JNICALL Java_org_syntaxnet2_JNI2_startTrace(
         JNIEnv *env,
         jobject type,
-        jstring j_model_path) {
+        jstring j_path,
+        jboolean redact) {
 
     (void) type;
-    model_path = jniStringToString(env, j_model_path);
+    const char *path = env->GetStringUTFChars(j_path, JNI_FALSE);
+    bool started = recorder().start(path, redact == JNI_TRUE);
+    env->ReleaseStringUTFChars(j_path, path);
+    return started ? JNI_TRUE : JNI_FALSE;
+}
 
-    long handle = sni_load_h(model_path.c_str());
-    return handle;
+/**
+ * Native stopTrace function callable from Java
+ */
+extern "C" JNIEXPORT
+void
+JNICALL Java_org_syntaxnet2_JNI2_stopTrace(
+        JNIEnv *env,
+        jobject type) {
+
+    (void) env;
+    (void) type;
+    recorder().stop();
 }
 
 /**
  * Native unload function callable from Java
+ * Handle is dropped at once, the pool and its contexts being freed once parse calls in flight on it are done
  */
 extern "C" JNIEXPORT
 void
@@ -389,17 +625,16 @@ JNICALL Java_org_syntaxnet2_JNI2_unload(
         jlong handle) {
 
     (void) type;
-    if (handle == 0) {
+    if (!handles<model_pool_t>().remove(handle)) {
         env->ThrowNew(env->FindClass(kIllegalStateException), "Cannot free null handle");
-        return;
     }
-    sni_unload_h(static_cast<long>(handle));
 }
 
 // p a r s e
 
 /**
  * Native parse function callable from Java
+ * Only fields in mask are converted and materialized (see org.depparse.Fields)
  */
 extern "C" JNIEXPORT
 jobjectArray
@@ -407,31 +642,207 @@ JNICALL Java_org_syntaxnet2_JNI2_parse(
         JNIEnv *env,
         jobject type,
         jlong handle,
-        jobjectArray input_texts) {
+        jobjectArray input_texts,
+        jint fields) {
 
     (void) type;
-    if (handle == 0) {
+    shared_ptr<model_pool_t> pool = poolOf(handle);
+    if (!pool) {
         env->ThrowNew(env->FindClass(kIllegalStateException), "Cannot parse with null handle");
         return nullptr;
     }
 
     // input
-    const vector<string> texts = jniStringArrayToVector(env, input_texts);
+    vector<uint64_t> hashes;
+    const vector<string> texts = jniStringArrayToVector(env, input_texts, pool->preprocessing, &hashes);
+    call_metrics_t call(env, texts, "parse", pool.get());
 
-    // parse
+    // parse and convert in batches, texts parsed ahead being taken as they are
+    fields = neededFields(fields);
+    document_t doc;
     vector<sentence_t> parsed_sentences;
-    sni_parse_h(static_cast<long>(handle), texts, parsed_sentences);
-    LOGD("Parsed %zu sentences\n", parsed_sentences.size());
+    bool parsed = withSpeculation(env, *pool, texts, hashes, doc,
+                                  [&](long context, const vector<string> &batch) {
+                                      parsed_sentences.clear();
+                                      sni_parse_h(context, batch, parsed_sentences);
+                                  },
+                                  [&](size_t &tokens) {
+                                      size_t before = doc.tokens.size();
+                                      bool converted = toDocument(parsed_sentences, doc, fields);
+                                      tokens = doc.tokens.size() - before;
+                                      return converted;
+                                  });
+    if (!parsed) {
+        if (!env->ExceptionCheck())
+            env->ThrowNew(env->FindClass(kIllegalStateException), "No token in sentence");
+        return nullptr;
+    }
+    LOGD("Parsed %zu sentences\n", doc.sentences.size());
 
     // interpret
-    jobjectArray sentence_array = toJavaSentences(env, parsed_sentences);
+    jobjectArray sentence_array = toJavaSentences(env, viewOf(doc), fields);
 
     LOGD("Parsing done\n");
     return sentence_array;
 }
 
+/**
+ * Native parseToDocument function callable from Java
+ * Parse result is kept in native storage, sentences are materialized on access by org.depparse.NativeDocument
+ *
+ * @return pointer to native document, to be owned by a NativeDocument
+ */
+extern "C" JNIEXPORT
+jlong
+JNICALL Java_org_syntaxnet2_JNI2_parseToDocument(
+        JNIEnv *env,
+        jobject type,
+        jlong handle,
+        jobjectArray input_texts) {
+
+    (void) type;
+    shared_ptr<model_pool_t> pool = poolOf(handle);
+    if (!pool) {
+        env->ThrowNew(env->FindClass(kIllegalStateException), "Cannot parse with null handle");
+        return 0;
+    }
+
+    // input
+    vector<uint64_t> hashes;
+    const vector<string> texts = jniStringArrayToVector(env, input_texts, pool->preprocessing, &hashes);
+    call_metrics_t call(env, texts, "parseToDocument", pool.get());
+
+    // parse and convert in batches, texts parsed ahead being taken as they are, no java object is built
+    document_t doc;
+    vector<sentence_t> parsed_sentences;
+    bool parsed = withSpeculation(env, *pool, texts, hashes, doc,
+                                  [&](long context, const vector<string> &batch) {
+                                      parsed_sentences.clear();
+                                      sni_parse_h(context, batch, parsed_sentences);
+                                  },
+                                  [&](size_t &tokens) {
+                                      size_t before = doc.tokens.size();
+                                      bool converted = toDocument(parsed_sentences, doc);
+                                      tokens = doc.tokens.size() - before;
+                                      return converted;
+                                  });
+    if (!parsed) {
+        if (!env->ExceptionCheck())
+            env->ThrowNew(env->FindClass(kIllegalStateException), "No token in sentence");
+        return 0;
+    }
+    LOGD("Parsed %zu sentences\n", doc.sentences.size());
+    return toNativeDocument(doc);
+}
+
+/**
+ * Native parseToDocumentCached function callable from Java
+ * Parse result is looked up in the persistent cache (keyed by model identity and input texts) and served in place if found,
+ * else parsed and stored
+ *
+ * @return pointer to native document, to be owned by a NativeDocument
+ */
+extern "C" JNIEXPORT
+jlong
+JNICALL Java_org_syntaxnet2_JNI2_parseToDocumentCached(
+        JNIEnv *env,
+        jobject type,
+        jlong handle,
+        jlong cache_ptr,
+        jobjectArray input_texts) {
+
+    (void) type;
+    shared_ptr<model_pool_t> pool = poolOf(handle);
+    if (!pool) {
+        env->ThrowNew(env->FindClass(kIllegalStateException), "Cannot parse with null handle");
+        return 0;
+    }
+    shared_ptr<parse_cache_t> cached_parses = cacheOf(cache_ptr);
+    if (!cached_parses) {
+        env->ThrowNew(env->FindClass(kIllegalStateException), "Cannot parse with null cache");
+        return 0;
+    }
+    parse_cache_t &cache = *cached_parses;
+
+    // input
+    vector<uint64_t> hashes;
+    const vector<string> texts = jniStringArrayToVector(env, input_texts, pool->preprocessing, &hashes);
+    call_metrics_t call(env, texts, "parseToDocumentCached", pool.get());
+
+    // lookup
+    const string key = cacheKey(modelIdentity(pool->path()), hashes, "parse");
+    jlong cached = toNativeDocument(cache, key);
+    if (cached != 0) {
+        LOGD("Cache hit %s\n", key.c_str());
+        return cached;
+    }
+
+    // parse and convert in batches, remembering the model that parsed: a swap may have come in since lookup
+    document_t doc;
+    string parsed_path;
+    if (!parseInBatches(env, *pool, texts, doc, &parsed_path)) {
+        return 0;
+    }
+    LOGD("Parsed %zu sentences\n", doc.sentences.size());
+
+    // store under the key of the model that parsed, not at all if batches were parsed by different models
+    if (parsed_path.empty()) {
+        LOGD("Not stored, model swapped while parsing\n");
+        return toNativeDocument(doc);
+    }
+    const string stored_key = cacheKey(modelIdentity(parsed_path), hashes, "parse");
+    if (!cache.store(stored_key, viewOf(doc))) {
+        LOGD("Cannot store %s\n", stored_key.c_str());
+    }
+    return toNativeDocument(doc);
+}
+
+/**
+ * Native parseToSharedMemory function callable from Java
+ * Parse result is written in binary layout (see binary.h) to a sealed shared memory file
+ * that can be handed over to another process and mapped read-only
+ *
+ * @return file descriptor owned by caller, -1 if shared memory is not available
+ */
+extern "C" JNIEXPORT
+jint
+JNICALL Java_org_syntaxnet2_JNI2_parseToSharedMemory(
+        JNIEnv *env,
+        jobject type,
+        jlong handle,
+        jobjectArray input_texts) {
+
+    (void) type;
+    shared_ptr<model_pool_t> pool = poolOf(handle);
+    if (!pool) {
+        env->ThrowNew(env->FindClass(kIllegalStateException), "Cannot parse with null handle");
+        return -1;
+    }
+
+    // input
+    const vector<string> texts = jniStringArrayToVector(env, input_texts, pool->preprocessing);
+    call_metrics_t call(env, texts, "parseToSharedMemory", pool.get());
+
+    // parse and convert in batches
+    document_t doc;
+    if (!parseInBatches(env, *pool, texts, doc)) {
+        return -1;
+    }
+    LOGD("Parsed %zu sentences\n", doc.sentences.size());
+
+    // write
+    int fd = writeBinaryToSharedMemory(viewOf(doc), "parse");
+    if (fd < 0) {
+        LOGD("No shared memory: %s\n", strerror(errno));
+    }
+    return fd;
+}
+
 /**
  * Native splitParse function callable from Java
+ * Splits paragraphs into sentences and parses them in one native pass.
+ * Sentence offsets are relative to their paragraph, sentence indices run across the whole input,
+ * docid holds the paragraph index unless the model sets one.
  */
 extern "C" JNIEXPORT
 jobjectArray
@@ -442,21 +853,45 @@ JNICALL Java_org_syntaxnet2_JNI2_splitParse(
         jobjectArray input_texts) {
 
     (void) type;
-    if (handle == 0) {
+    shared_ptr<model_pool_t> pool = poolOf(handle);
+    if (!pool) {
         env->ThrowNew(env->FindClass(kIllegalStateException), "Cannot parse with null handle");
         return nullptr;
     }
 
     // input
-    const vector<string> texts = jniStringArrayToVector(env, input_texts);
+    const vector<string> paragraphs = jniStringArrayToVector(env, input_texts, pool->preprocessing);
+    call_metrics_t call(env, paragraphs, "splitParse", pool.get());
 
-    // parse
-    vector<sentence_t> parsed_sentences;
-    sni_parse_h(static_cast<long>(handle), texts, parsed_sentences);
-    LOGD("Parsed %zu sentences\n", parsed_sentences.size());
+    // split, parse, convert in batches of paragraphs, one paragraph at a time so that sentences can be traced back to their paragraph
+    document_t doc;
+    vector<vector<sentence_t>> split_parsed_paragraphs;
+    int i = 0;
+    bool parsed = withBatches(env, *pool, paragraphs,
+                              [&](long context, const vector<string> &batch) {
+                                  split_parsed_paragraphs.assign(batch.size(), vector<sentence_t>());
+                                  for (size_t k = 0; k < batch.size(); k++)
+                                      sni_split_parse_h(context, batch[k].c_str(), split_parsed_paragraphs[k]);
+                              },
+                              [&](size_t &tokens) {
+                                  size_t before = doc.tokens.size();
+                                  for (const auto &split_parsed_sentences: split_parsed_paragraphs) {
+                                      LOGD("Paragraph #%d: split-parsed %zu sentences\n", i, split_parsed_sentences.size());
+                                      if (!toDocumentSplit(paragraphs[i], i, split_parsed_sentences, doc))
+                                          return false;
+                                      i++;
+                                  }
+                                  tokens = doc.tokens.size() - before;
+                                  return true;
+                              });
+    if (!parsed) {
+        if (!env->ExceptionCheck())
+            env->ThrowNew(env->FindClass(kIllegalStateException), "No token in sentence");
+        return nullptr;
+    }
 
     // interpret
-    jobjectArray sentence_array = toJavaSentences(env, parsed_sentences);
+    jobjectArray sentence_array = toJavaSentences(env, viewOf(doc));
 
     LOGD("Parsing done\n");
     return sentence_array;
@@ -474,17 +909,21 @@ JNICALL Java_org_syntaxnet2_JNI2_segment(
         jobjectArray input_texts) {
 
     (void) type;
-    if (handle == 0) {
+    shared_ptr<model_pool_t> pool = poolOf(handle);
+    if (!pool) {
         env->ThrowNew(env->FindClass(kIllegalStateException), "Cannot parse with null handle");
         return nullptr;
     }
 
     // input
-    const vector<string> texts = jniStringArrayToVector(env, input_texts);
+    const vector<string> texts = jniStringArrayToVector(env, input_texts, pool->preprocessing);
+    call_metrics_t call(env, texts, "segment", pool.get());
 
     // parse
     vector<sentence_t> segmented_sentences;
-    sni_segment_h(static_cast<long>(handle), texts, segmented_sentences);
+    if (!withContext(env, *pool, [&](long context) { sni_segment_h(context, texts, segmented_sentences); })) {
+        return nullptr;
+    }
     LOGD("Segmented %zu sentences\n", segmented_sentences.size());
 
     // interpret
@@ -493,3 +932,43 @@ JNICALL Java_org_syntaxnet2_JNI2_segment(
     LOGD("Segmenting done\n");
     return sentence_array;
 }
+
+// q u e r y
+
+/**
+ * Native query function callable from Java
+ * Parses and matches a structural pattern straight on native results, no Java sentence is built
+ *
+ * @return [width, sentence index, token..., ...], width ints per match, token indices being 0-based in sentence
+ */
+extern "C" JNIEXPORT
+jintArray
+JNICALL Java_org_syntaxnet2_JNI2_query(
+        JNIEnv *env,
+        jobject type,
+        jlong handle,
+        jobjectArray input_texts,
+        jstring pattern,
+        jint max_matches) {
+
+    (void) type;
+    shared_ptr<model_pool_t> pool = poolOf(handle);
+    if (!pool) {
+        env->ThrowNew(env->FindClass(kIllegalStateException), "Cannot parse with null handle");
+        return nullptr;
+    }
+
+    // input
+    const vector<string> texts = jniStringArrayToVector(env, input_texts, pool->preprocessing);
+    call_metrics_t call(env, texts, "query", pool.get());
+
+    // parse and convert in batches
+    document_t doc;
+    if (!parseInBatches(env, *pool, texts, doc)) {
+        return nullptr;
+    }
+    LOGD("Parsed %zu sentences\n", doc.sentences.size());
+
+    // match
+    return toJavaMatches(env, viewOf(doc), pattern, max_matches);
+}
@@ -10,6 +10,8 @@
 
 #include "syntaxnet2/iface_h.h"
 #include "syntaxnet2/iface_hp.h"
+#include "depparse_native/jni_pool.h"
+#include "depparse_native/jni_metrics.h"
 
 #define  LOG_TAG    "SYNTAXNET_JNI"
 
@@ -36,7 +38,7 @@ T CheckNotNull(JNIEnv *env, T &&t) {
 // C O N V E R S I O N   H E L P E R S
 
 extern
-vector<string> jniStringArrayToVector(JNIEnv *env, jobjectArray string_array);
+vector<string> jniStringArrayToVector(JNIEnv *env, jobjectArray string_array, int32_t flags, vector<uint64_t> *hashes = nullptr);
 
 jobjectArray toJavaByteArray(JNIEnv *env, const vector<string> &protos) {
     // element class
@@ -65,17 +67,21 @@ jobjectArray toJavaByteArray(JNIEnv *env, const vector<string> &protos) {
 
 extern "C" JNIEXPORT jobjectArray
 JNICALL Java_org_syntaxnet2_JNI2_parseProtos(JNIEnv *env, jobject /*thiz*/, jlong handle, jobjectArray input_texts) {
-    if (handle == 0) {
+    shared_ptr<model_pool_t> pool = poolOf(handle);
+    if (!pool) {
         env->ThrowNew(env->FindClass(kIllegalStateException), "Cannot parse with null handle");
         return nullptr;
     }
 
     // input
-    const vector<string> texts = jniStringArrayToVector(env, input_texts);
+    const vector<string> texts = jniStringArrayToVector(env, input_texts, pool->preprocessing);
+    call_metrics_t call(env, texts, "parseProtos", pool.get());
 
     // parse
     vector<string> parsed_sentence_protos;
-    sni_parse_hp(handle, texts, parsed_sentence_protos);
+    if (!withContext(env, *pool, [&](long context) { sni_parse_hp(context, texts, parsed_sentence_protos); })) {
+        return nullptr;
+    }
     LOGD("Parsed %zu sentences\n", parsed_sentence_protos.size());
 
     // interpret
@@ -89,17 +95,21 @@ JNICALL Java_org_syntaxnet2_JNI2_parseProtos(JNIEnv *env, jobject /*thiz*/, jlon
 
 extern "C" JNIEXPORT jobjectArray
 JNICALL Java_org_syntaxnet2_JNI2_splitParseProtos(JNIEnv *env, jobject /*thiz*/, jlong handle, jobjectArray input_texts) {
-    if (handle == 0) {
+    shared_ptr<model_pool_t> pool = poolOf(handle);
+    if (!pool) {
         env->ThrowNew(env->FindClass(kIllegalStateException), "Cannot parse with null handle");
         return nullptr;
     }
 
     // input
-    const vector<string> texts = jniStringArrayToVector(env, input_texts);
+    const vector<string> texts = jniStringArrayToVector(env, input_texts, pool->preprocessing);
+    call_metrics_t call(env, texts, "splitParseProtos", pool.get());
 
     // parse
     vector<string> split_parsed_sentence_protos;
-    sni_split_parse_hp(handle, texts, split_parsed_sentence_protos);
+    if (!withContext(env, *pool, [&](long context) { sni_split_parse_hp(context, texts, split_parsed_sentence_protos); })) {
+        return nullptr;
+    }
     LOGD("Parsed %zu sentences\n", split_parsed_sentence_protos.size());
 
     // interpret
@@ -113,17 +123,21 @@ JNICALL Java_org_syntaxnet2_JNI2_splitParseProtos(JNIEnv *env, jobject /*thiz*/,
 
 extern "C" JNIEXPORT jobjectArray
 JNICALL Java_org_syntaxnet2_JNI2_segmentProtos(JNIEnv *env, jobject /*thiz*/, jlong handle, jobjectArray input_texts) {
-    if (handle == 0) {
+    shared_ptr<model_pool_t> pool = poolOf(handle);
+    if (!pool) {
         env->ThrowNew(env->FindClass(kIllegalStateException), "Cannot parse with null handle");
         return nullptr;
     }
 
     // input
-    const vector<string> texts = jniStringArrayToVector(env, input_texts);
+    const vector<string> texts = jniStringArrayToVector(env, input_texts, pool->preprocessing);
+    call_metrics_t call(env, texts, "segmentProtos", pool.get());
 
     // parse
     vector<string> segmented_sentence_protos;
-    sni_segment_hp(handle, texts, segmented_sentence_protos);
+    if (!withContext(env, *pool, [&](long context) { sni_segment_hp(context, texts, segmented_sentence_protos); })) {
+        return nullptr;
+    }
     LOGD("Segmented %zu sentences\n", segmented_sentence_protos.size());
 
     // result
@@ -0,0 +1,12 @@
+/* Copyright 2018
+ * Bernard Bou
+ * 1313ou@gmail.com */
+
+// Host replayer of syntaxnet2 JNI library traces (see depparse_native/replay.h).
+// There is no host build of the syntaxnet2 inference library: calls are replayed against the stub backend only.
+
+#include "depparse_native/replay.h"
+
+int main(int argc, char *argv[]) {
+    return runReplay(argc, argv, nullptr);
+}
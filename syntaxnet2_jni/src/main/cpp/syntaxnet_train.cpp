@@ -0,0 +1,39 @@
+/* Copyright 2018
+ * Bernard Bou
+ * 1313ou@gmail.com */
+
+// Host training driver of the syntaxnet2 JNI library conversion code, for profile-guided builds (see depparse_native/optimize.cmake).
+// Corpus sentences are handed over as syntaxnet parse results: head 0-based (-1 for root), byte offsets with inclusive ends.
+
+#include <string>
+
+#include "syntaxnet2/convert.h"
+#include "depparse_native/train_driver.h"
+
+using namespace std;
+
+static void toParsed(const corpus_sentence_t &sentence, parsed_sentence_t &parsed) {
+    parsed.clear();
+    parsed.emplace_back();
+    parsed_token_t &token0 = parsed.back();
+    token0["text"] = sentence.text;
+    token0["start"] = "0";
+    token0["end"] = to_string(static_cast<int>(sentence.text.size()) - 1);
+    for (const auto &t: sentence.tokens) {
+        parsed.emplace_back();
+        parsed_token_t &token = parsed.back();
+        token["word"] = t.form;
+        token["category"] = t.upos;
+        token["tag"] = t.xpos;
+        token["head"] = to_string(t.head - 1);
+        token["label"] = t.deprel;
+        token["start"] = to_string(t.start);
+        token["end"] = to_string(t.end - 1);
+        token["breaklevel"] = "1";
+    }
+}
+
+int main(int argc, char *argv[]) {
+    const training_backend_t backend = {"syntaxnet2", toParsed, toDocument};
+    return runTraining(argc, argv, backend);
+}
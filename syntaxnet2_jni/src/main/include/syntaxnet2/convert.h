@@ -0,0 +1,58 @@
+/* Copyright 2018
+ * Bernard Bou
+ * 1313ou@gmail.com */
+
+#ifndef SYNTAXNET2_CONVERT_H
+#define SYNTAXNET2_CONVERT_H
+
+#include <string>
+#include <vector>
+
+#include "syntaxnet2/iface_h.h"
+#include "depparse_native/document.h"
+
+// conversion of syntaxnet parse results to backend-neutral documents (no JNI)
+
+/**
+ * Append a parsed sentence to document
+ *
+ * @param parsed_sentence parsed syntaxnet sentence, token[0] holding sentence data
+ * @param doc document to append to
+ * @return false if sentence has no token
+ */
+bool
+toDocumentSentence(const sentence_t &parsed_sentence, document_t &doc);
+
+/**
+ * Append parsed sentences to document
+ *
+ * @param parsed_sentences parsed syntaxnet sentences
+ * @param doc document to append to
+ * @return false if one parsed sentence has no token
+ */
+bool
+toDocument(const std::vector<sentence_t> &parsed_sentences, document_t &doc);
+
+/**
+ * Append parsed sentences to document, projected on fields
+ *
+ * @param fields fields to convert (bit mask of kField*), others are left out
+ */
+bool
+toDocument(const std::vector<sentence_t> &parsed_sentences, document_t &doc, int32_t fields);
+
+/**
+ * Append sentences split and parsed out of a paragraph to document.
+ * Sentence offsets are made relative to the paragraph, token offsets relative to their sentence text,
+ * docid defaults to the paragraph index.
+ *
+ * @param paragraph paragraph text
+ * @param paragraphIndex paragraph index in input
+ * @param split_parsed_sentences sentences split and parsed out of paragraph, in text order
+ * @param doc document to append to
+ * @return false if one parsed sentence has no token
+ */
+bool
+toDocumentSplit(const std::string &paragraph, int paragraphIndex, const std::vector<sentence_t> &split_parsed_sentences, document_t &doc);
+
+#endif
@@ -23,6 +23,10 @@ class SyntaxnetBoundService : BoundService<Array<Sentence>>() {
         }
     }
 
+    override suspend fun swapModel(modelPath: String) {
+        syntaxnetEngine.swapAsync(modelPath)
+    }
+
     override fun onDestroy() {
         syntaxnetEngine.unload()
         super.onDestroy()
@@ -6,8 +6,10 @@ import org.syntaxnet2.JNI2
 
 /**
  * Loader
+ *
+ * @property poolSize maximum number of concurrent parse calls on loaded model
  */
-class Loader : Task<String, Void, Long?>() {
+class Loader(private val poolSize: Int = 1) : Task<String, Void, Long?>() {
 
     init {
         Log.d(TAG, "JNI version " + JNI2.version())
@@ -15,7 +17,8 @@ class Loader : Task<String, Void, Long?>() {
 
     override suspend fun doJob(params: String): Long? {
         try {
-            val handle = JNI2.load(params)
+            val handle = JNI2.loadPool(params, poolSize)
+            Log.i(TAG, "Loaded $params in ${JNI2.loadMillis()} ms")
             return if (handle != 0L) {
                 handle
             } else null
@@ -23,6 +23,10 @@ class UDPipeBoundService : BoundService<Array<Sentence>>() {
         }
     }
 
+    override suspend fun swapModel(modelPath: String) {
+        udPipeEngine.swapAsync(modelPath)
+    }
+
     override fun onDestroy() {
         udPipeEngine.unload()
         super.onDestroy()
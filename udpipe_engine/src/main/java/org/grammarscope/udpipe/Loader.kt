@@ -6,8 +6,10 @@ import org.udpipe.JNI
 
 /**
  * Loader
+ *
+ * @property poolSize maximum number of concurrent parse calls on loaded model
  */
-class Loader : Task<String?, Void?, Long?>() {
+class Loader(private val poolSize: Int = 1) : Task<String?, Void?, Long?>() {
 
     init {
         val v = JNI.version()
@@ -16,7 +18,7 @@ class Loader : Task<String?, Void?, Long?>() {
 
     override suspend fun doJob(params: String?): Long? {
         try {
-            val handle = JNI.load("$params/model.udpipe")
+            val handle = JNI.loadPool("$params/model.udpipe", poolSize)
             return if (handle != 0L) {
                 handle
             } else null
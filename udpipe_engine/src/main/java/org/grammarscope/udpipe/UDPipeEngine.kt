@@ -2,39 +2,76 @@ package org.grammarscope.udpipe
 
 import android.content.Context
 import android.content.Intent
+import android.os.ParcelFileDescriptor
 import android.util.Log
 import kotlinx.coroutines.Dispatchers
 import kotlinx.coroutines.runBlocking
+import kotlinx.coroutines.withContext
+import org.depparse.BatchState
 import org.depparse.Broadcast
 import org.depparse.IAsyncLoading
 import org.depparse.IEngine
+import org.depparse.IMetricsProvider
 import org.depparse.IProvider
+import org.depparse.ISharedMemoryProvider
+import org.depparse.ITrimMemory
+import org.depparse.NativeDocument
+import org.depparse.ParseCache
+import org.depparse.QueryMatches
 import org.depparse.Sentence
+import org.depparse.SpeculationState
 import org.depparse.Storage
 import org.udpipe.JNI
 import java.io.File
+import java.io.IOException
 import java.util.function.Consumer
 
-class UDPipeEngine(private val context: Context) : IEngine<Array<Sentence>>, IAsyncLoading, Consumer<Long?> {
+class UDPipeEngine(private val context: Context) : IEngine<Array<Sentence>>, IAsyncLoading, ISharedMemoryProvider, ITrimMemory, IMetricsProvider, Consumer<Long?> {
 
     private var handle: Long? = null
     override var isEmbedded = false
+
+    /**
+     * Maximum number of concurrent parse calls, each needing a model instance of its own, to be set before loading
+     */
+    var poolSize = 1
     val modelDir: File
         get() = Storage.getAppStorage(context)
 
     override fun load(modelPath: String) {
         Log.i(TAG, "loading from $modelPath")
-        handle = JNI.load("$modelPath/model.udpipe")
+        handle = JNI.loadPool("$modelPath/model.udpipe", poolSize)
         Log.d(TAG, "loaded $handle")
     }
 
     override suspend fun loadAsync(modelPath: String) {
         Log.i(TAG, "Loading from $modelPath/model.udpipe")
-        Loader().runAndConsumeResult(Dispatchers.IO, modelPath) { result: Long? ->
+        Loader(poolSize).runAndConsumeResult(Dispatchers.IO, modelPath) { result: Long? ->
             accept(result)
         }
     }
 
+    /**
+     * Replace model without downtime: the new model loads while requests keep being served by the current one,
+     * new requests then go to the new model, the current one being freed once requests in flight are done with it.
+     * The current model is kept if the new one fails to load.
+     */
+    override suspend fun swapAsync(modelPath: String) {
+        val current = handle
+        if (current == null) {
+            loadAsync(modelPath)
+            return
+        }
+        Log.i(TAG, "Swapping in $modelPath")
+        val swapped = withContext(Dispatchers.IO) { JNI.swap(current, "$modelPath/model.udpipe") }
+        if (swapped) {
+            Log.i(TAG, "Swapped $current")
+            broadcastEvent(if (isEmbedded) Broadcast.EventType.EMBEDDED_LOADED.name else Broadcast.EventType.LOADED.name)
+        } else {
+            Log.e(TAG, "Failed to swap in $modelPath, keeping current model")
+        }
+    }
+
     override fun accept(handle: Long?) {
         Log.i(TAG, "Loaded $handle")
         this.handle = handle
@@ -46,6 +83,81 @@ class UDPipeEngine(private val context: Context) : IEngine<Array<Sentence>>, IAs
         broadcastEvent(event.name)
     }
 
+    override fun trim(level: Int) {
+        val current = handle ?: return
+        val trimmed = JNI.trim(current, level)
+        Log.i(TAG, "Trimmed $current at level $level, unloaded $trimmed contexts")
+    }
+
+    /**
+     * State of adaptive batch sizing of parse calls, null if not loaded
+     */
+    val batchState: BatchState?
+        get() = handle?.let { BatchState(JNI.batchState(it)) }
+
+    /**
+     * Latency target of parse batches in milliseconds: parse calls are split natively so that each batch takes about that long,
+     * letting concurrent calls interleave between batches
+     */
+    fun setBatchTarget(millis: Int) {
+        val current = handle ?: return
+        JNI.setBatchTarget(current, millis)
+    }
+
+    /**
+     * Preprocessing of input texts of parse calls (org.depparse.Preprocessing flags), kept across model swaps
+     */
+    fun setPreprocessing(flags: Int) {
+        val current = handle ?: return
+        JNI.setPreprocessing(current, flags)
+    }
+
+    /**
+     * Parse texts likely to be asked for next (next section, next page) on idle time, so that parsing them then is instant
+     *
+     * @return number of texts queued
+     */
+    fun speculate(texts: Array<String>): Int {
+        val current = handle ?: return 0
+        return JNI.speculate(current, texts)
+    }
+
+    /**
+     * Drop texts queued to be parsed ahead and results not taken yet
+     */
+    fun clearSpeculation() {
+        val current = handle ?: return
+        JNI.clearSpeculation(current)
+    }
+
+    /**
+     * State of speculative parsing, null if not loaded
+     */
+    val speculationState: SpeculationState?
+        get() = handle?.let { SpeculationState(JNI.speculationState(it)) }
+
+    override fun metrics(): LongArray {
+        return JNI.metricsSnapshot()
+    }
+
+    /**
+     * Record parse calls to trace file, for replay on the host
+     *
+     * @param path trace file, truncated
+     * @param redact whether texts are recorded as hashes and lengths only
+     * @return false if trace file could not be opened
+     */
+    fun startTrace(path: String, redact: Boolean = true): Boolean {
+        return JNI.startTrace(path, redact)
+    }
+
+    /**
+     * End trace being recorded, if any
+     */
+    fun stopTrace() {
+        JNI.stopTrace()
+    }
+
     override fun unload() {
         if (handle == null) {
             Log.e(TAG, "Unloading exception (not initialized)")
@@ -70,6 +182,133 @@ class UDPipeEngine(private val context: Context) : IEngine<Array<Sentence>>, IAs
         return result
     }
 
+    /**
+     * Parse, building only the given token fields
+     *
+     * @param args input texts
+     * @param fields fields to build (bit mask of org.depparse.Fields), e.g. Fields.POS or Fields.GRAPH
+     * @return sentences
+     */
+    @Throws(IllegalStateException::class)
+    fun process(args: Array<String>, fields: Int): Array<Sentence> {
+        if (handle == null) {
+            Log.e(TAG, "Trying to process while not initialized.")
+            throw IllegalStateException("Trying to process while not initialized.")
+        }
+        return JNI.parse(handle!!, args, fields)
+    }
+
+    /**
+     * Parse paragraphs, udpipe splitting them into sentences, no sentence detection needed upstream
+     *
+     * @param paragraphs input paragraphs
+     * @return sentences, offsets relative to the paragraphs joined by one separator char, docid holding the paragraph index
+     */
+    @Throws(IllegalStateException::class)
+    fun processParagraphs(paragraphs: Array<String>): Array<Sentence> {
+        if (handle == null) {
+            Log.e(TAG, "Trying to process while not initialized.")
+            throw IllegalStateException("Trying to process while not initialized.")
+        }
+        Log.d(TAG, "Processing paragraphs $handle")
+        val result = JNI.splitParse(handle!!, paragraphs)
+        Log.d(TAG, "Processed paragraphs $handle")
+        return result
+    }
+
+    /**
+     * Parse to CoNLL-U without building sentence objects
+     *
+     * @param args input texts
+     * @return UTF-8 CoNLL-U
+     */
+    @Throws(IllegalStateException::class)
+    fun processToConllu(args: Array<String>): ByteArray {
+        if (handle == null) {
+            Log.e(TAG, "Trying to process while not initialized.")
+            throw IllegalStateException("Trying to process while not initialized.")
+        }
+        return JNI.parseToConllu(handle!!, args)
+    }
+
+    /**
+     * Parse and stream CoNLL-U to file
+     *
+     * @param args input texts
+     * @param fd file descriptor open for writing (left open)
+     * @return number of bytes written
+     */
+    @Throws(IllegalStateException::class, IOException::class)
+    fun processToConllu(args: Array<String>, fd: Int): Long {
+        if (handle == null) {
+            Log.e(TAG, "Trying to process while not initialized.")
+            throw IllegalStateException("Trying to process while not initialized.")
+        }
+        return JNI.parseToConlluFd(handle!!, args, fd)
+    }
+
+    /**
+     * Parse, sentences and tokens being materialized only when accessed
+     *
+     * @param args input texts
+     * @return native-backed document, to be closed when done with (else released when collected)
+     */
+    @Throws(IllegalStateException::class)
+    fun processLazily(args: Array<String>): NativeDocument {
+        if (handle == null) {
+            Log.e(TAG, "Trying to process while not initialized.")
+            throw IllegalStateException("Trying to process while not initialized.")
+        }
+        return NativeDocument(JNI.parseToDocument(handle!!, args))
+    }
+
+    /**
+     * Persistent parse cache under app storage, opened on first use
+     */
+    val parseCache: ParseCache by lazy { ParseCache(File(modelDir, ParseCache.DIR), CACHE_MAX_BYTES) }
+
+    /**
+     * Parse through persistent cache, reopening previously parsed texts costing no parse
+     *
+     * @param args input texts
+     * @return native-backed document, to be closed when done with (else released when collected)
+     */
+    @Throws(IllegalStateException::class)
+    fun processCached(args: Array<String>): NativeDocument {
+        if (handle == null) {
+            Log.e(TAG, "Trying to process while not initialized.")
+            throw IllegalStateException("Trying to process while not initialized.")
+        }
+        return NativeDocument(JNI.parseToDocumentCached(handle!!, parseCache.handle, args))
+    }
+
+    @Throws(IllegalStateException::class)
+    override fun processToSharedMemory(args: Array<String>): ParcelFileDescriptor? {
+        if (handle == null) {
+            Log.e(TAG, "Trying to process while not initialized.")
+            throw IllegalStateException("Trying to process while not initialized.")
+        }
+        val fd = JNI.parseToSharedMemory(handle!!, args)
+        return if (fd < 0) null else ParcelFileDescriptor.adoptFd(fd)
+    }
+
+    /**
+     * Parse and match structural pattern natively
+     *
+     * @param args input texts
+     * @param pattern query pattern
+     * @param maxMatches maximum number of matches, unlimited if <= 0
+     * @return matches
+     */
+    @Throws(IllegalStateException::class, IllegalArgumentException::class)
+    fun query(args: Array<String>, pattern: String, maxMatches: Int = 0): QueryMatches {
+        if (handle == null) {
+            Log.e(TAG, "Trying to process while not initialized.")
+            throw IllegalStateException("Trying to process while not initialized.")
+        }
+        return QueryMatches(JNI.query(handle!!, args, pattern, maxMatches))
+    }
+
     /**
      * Send broadcast from activity to all receivers listening to the action "ENGINE"
      */
@@ -102,6 +341,8 @@ class UDPipeEngine(private val context: Context) : IEngine<Array<Sentence>>, IAs
 
         private const val TAG = "Engine"
 
+        private const val CACHE_MAX_BYTES = 64L * 1024 * 1024
+
         init {
             JNI.init()
         }
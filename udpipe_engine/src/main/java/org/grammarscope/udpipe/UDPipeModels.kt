@@ -0,0 +1,79 @@
+package org.grammarscope.udpipe
+
+import android.util.Log
+import org.depparse.Sentence
+import org.udpipe.JNI
+import java.io.File
+
+/**
+ * Models of several languages kept loaded side by side, so that mixed-language workloads do not go through full reloads.
+ * Models are looked up as modelDir/language/model.udpipe, loaded on first use (or prefetch),
+ * least recently used ones being evicted when the memory budget is exceeded.
+ *
+ * @property modelDir directory of per-language model directories
+ * @param budget memory budget in bytes, estimated from model file sizes, unlimited if 0
+ * @param poolSize maximum number of concurrent parse calls on each model
+ */
+class UDPipeModels(private val modelDir: File, budget: Long, poolSize: Int = 1) : AutoCloseable {
+
+    private var registry: Long = JNI.loadModels(budget, poolSize)
+
+    val size: Long
+        get() = JNI.modelsSize(checkOpen())
+
+    fun modelPath(language: String): String {
+        return File(File(modelDir, language), "model.udpipe").absolutePath
+    }
+
+    /**
+     * Start loading model for language in the background
+     */
+    fun prefetch(language: String) {
+        JNI.prefetch(checkOpen(), modelPath(language))
+    }
+
+    fun evict(language: String) {
+        JNI.evict(checkOpen(), modelPath(language))
+    }
+
+    /**
+     * Release memory under pressure
+     *
+     * @param level level, as in ComponentCallbacks2.onTrimMemory
+     */
+    fun trim(level: Int) {
+        val evicted = JNI.trimModels(checkOpen(), level)
+        Log.d(TAG, "Trimmed at level $level, evicted $evicted")
+    }
+
+    /**
+     * Parse with model for language, waiting for it to load on a miss
+     *
+     * @param language language, model subdirectory name
+     * @param args input texts
+     * @return sentences
+     */
+    @Throws(IllegalStateException::class)
+    fun process(language: String, args: Array<String>): Array<Sentence> {
+        Log.d(TAG, "Processing with $language")
+        return JNI.parseWith(checkOpen(), modelPath(language), args)
+    }
+
+    @Synchronized
+    override fun close() {
+        if (registry != 0L) {
+            JNI.unloadModels(registry)
+            registry = 0L
+        }
+    }
+
+    private fun checkOpen(): Long {
+        check(registry != 0L) { "Models are closed" }
+        return registry
+    }
+
+    companion object {
+
+        private const val TAG = "Models"
+    }
+}
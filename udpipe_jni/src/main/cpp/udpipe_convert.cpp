@@ -0,0 +1,251 @@
+/* Copyright 2018
+ * Bernard Bou
+ * 1313ou@gmail.com */
+
+#include <string>
+#include <vector>
+#include <cctype>
+#include <cstdlib>
+
+#include "udpipe/convert.h"
+#include "depparse_native/char_indices.h"
+#include "depparse_native/metrics.h"
+
+using namespace std;
+
+// K E Y S
+
+static const string kText = "text";
+static const string kDocId = "docid";
+static const string kWord = "word";
+static const string kCategory = "category";
+static const string kUPosTag = "upostag";
+static const string kXPosTag = "xpostag";
+static const string kLemma = "lemma";
+static const string kFeats = "feats";
+static const string kHead = "head";
+static const string kLabel = "label";
+static const string kStart = "start";
+static const string kEnd = "end";
+static const string kBreakLevel = "breaklevel";
+static const string kDeps = "deps";
+
+static const string kEmpty;
+
+// L O O K U P   H E L P E R S
+
+static inline const string &valueOf(const token_t &token, const string &key) {
+    auto it = token.find(key);
+    return it != token.end() ? it->second : kEmpty;
+}
+
+static inline int intValueOf(const token_t &token, const string &key) {
+    auto it = token.find(key);
+    return it != token.end() ? static_cast<int>(strtol(it->second.c_str(), nullptr, 10)) : -1;
+}
+
+// S P L I T
+
+static void split(const string &s, const char c, vector<string> &v) {
+    string::size_type i = 0;
+    string::size_type j = s.find(c);
+    while (j != string::npos) {
+        v.push_back(s.substr(i, j - i));
+        i = ++j;
+        j = s.find(c, j);
+        if (j == string::npos)
+            v.push_back(s.substr(i, s.length()));
+    }
+}
+
+// T A G
+
+/**
+ * Build composite tag out of upostag, xpostag, lemma and feats
+ */
+static void makeTag(const string &upostag, const string &xpostag, const string &lemma, const string &feats, string &tag) {
+    if (!upostag.empty()) {
+        tag += "name: 'upostag' value: '";
+        tag += upostag;
+        tag += "'";
+    }
+    if (!xpostag.empty()) {
+        if (!tag.empty())
+            tag += " ";
+        tag += "name: 'xpostag' value: '";
+        tag += xpostag;
+        tag += "'";
+    }
+    if (!lemma.empty()) {
+        if (!tag.empty())
+            tag += " ";
+        tag += "name: 'lemma' value: '";
+        tag += lemma;
+        tag += "'";
+    }
+    if (!feats.empty()) {
+        if (!tag.empty())
+            tag += " ";
+        vector<string> features;
+        split(feats, '|', features);
+        for (const auto &feature: features) {
+            vector<string> name_value;
+            split(feature, '=', name_value);
+            if (name_value.size() == 2) {
+                string &name = name_value[0];
+                string &value = name_value[1];
+                name[0] = static_cast<char>(tolower(name[0]));
+                tag += "name: '";
+                tag += name;
+                tag += "' value: '";
+                tag += value;
+                tag += "'";
+            }
+        }
+    }
+}
+
+// C O N V E R T
+
+bool
+toDocumentSentence(const sentence_t &parsed_sentence, document_t &doc, int32_t fields) {
+
+    int nTokens = (int) parsed_sentence.size();
+    if (nTokens == 0) {
+        return false;
+    }
+
+    // Sentence text as token[0] (text as token[0]["text"], docid as token[0]["docid"]
+
+    const token_t &token0 = parsed_sentence[0];
+
+    const string &text = valueOf(token0, kText);
+    const bool offsets = (fields & kFieldOffsets) != 0;
+    vector<int> toCharIndices;
+    if (offsets)
+        getCharIndices(text, toCharIndices);
+
+    doc.sentences.emplace_back();
+    doc_sentence_t &sentence = doc.sentences.back();
+    sentence.text = doc.strings.add(text);
+    sentence.docid = doc.strings.intern(valueOf(token0, kDocId));
+    // udpipe ends are exclusive byte offsets, sentence end is an inclusive char index as that of tokens
+    sentence.start = offsets ? toCharIndex(toCharIndices, intValueOf(token0, kStart)) : -1;
+    sentence.end = offsets ? toCharIndex(toCharIndices, intValueOf(token0, kEnd) - 1) : -1;
+    sentence.first_token = static_cast<int32_t>(doc.tokens.size());
+    sentence.token_count = nTokens - 1;
+
+    // Tokens, fields left out keep newToken defaults
+
+    int sentence_start = 0;
+    string tag;
+    for (int j = 1; j < nTokens; j++) {
+
+        const token_t &token = parsed_sentence[j];
+        doc_token_t &t = newToken(doc);
+
+        if ((fields & kFieldWord) != 0)
+            t.word = doc.strings.add(valueOf(token, kWord));
+        if ((fields & kFieldCategory) != 0)
+            t.category = doc.strings.intern(valueOf(token, kCategory));
+
+        if ((fields & kFieldTag) != 0) {
+            const string &upostag = valueOf(token, kUPosTag);
+            const string &xpostag = valueOf(token, kXPosTag);
+            const string &lemma = valueOf(token, kLemma);
+            const string &feats = valueOf(token, kFeats);
+            t.upostag = doc.strings.intern(upostag);
+            t.xpostag = doc.strings.intern(xpostag);
+            t.lemma = doc.strings.add(lemma);
+            t.feats = doc.strings.intern(feats);
+            tag.clear();
+            makeTag(upostag, xpostag, lemma, feats, tag);
+            t.tag = doc.strings.add(tag);
+        }
+
+        if ((fields & kFieldLabel) != 0)
+            t.label = doc.strings.intern(valueOf(token, kLabel));
+        if ((fields & kFieldDeps) != 0) {
+            const string &deps = valueOf(token, kDeps);
+            t.deps = doc.strings.add(deps);
+            parseEnhancedDeps(deps, doc);
+        }
+
+        // offsets are made relative to sentence, then converted to char indices
+        if (offsets) {
+            int t_istart = intValueOf(token, kStart);
+            int t_iend = intValueOf(token, kEnd) - 1;
+            if (j == 1 && t_istart != 0) {
+                sentence_start = t_istart;
+            }
+            t_istart -= sentence_start;
+            t_iend -= sentence_start;
+            t.start = toCharIndex(toCharIndices, t_istart);
+            t.end = toCharIndex(toCharIndices, t_iend);
+        }
+
+        if ((fields & kFieldHead) != 0) {
+            int ihead = intValueOf(token, kHead);
+            if (ihead > 0) // O-based
+                ihead--;
+            t.head = ihead;
+        }
+
+        if ((fields & kFieldBreakLevel) != 0)
+            t.breaklevel = intValueOf(token, kBreakLevel);
+    }
+    return true;
+}
+
+bool
+toDocumentSentence(const sentence_t &parsed_sentence, document_t &doc) {
+    return toDocumentSentence(parsed_sentence, doc, kFieldAll);
+}
+
+bool
+toDocument(const vector<sentence_t> &parsed_sentences, document_t &doc, int32_t fields) {
+    scoped_timer_t timer(metrics().convert);
+    const size_t sentences = doc.sentences.size();
+    const size_t tokens = doc.tokens.size();
+    for (const auto &parsed_sentence: parsed_sentences) {
+        if (!toDocumentSentence(parsed_sentence, doc, fields)) {
+            return false;
+        }
+    }
+    recordConverted(doc.sentences.size() - sentences, doc.tokens.size() - tokens);
+    return true;
+}
+
+bool
+toDocument(const vector<sentence_t> &parsed_sentences, document_t &doc) {
+    return toDocument(parsed_sentences, doc, kFieldAll);
+}
+
+bool
+toDocumentParagraph(const string &paragraph, int paragraph_index, int32_t base, const vector<sentence_t> &parsed_sentences, document_t &doc) {
+    scoped_timer_t timer(metrics().convert);
+    const size_t sentences = doc.sentences.size();
+    const size_t tokens = doc.tokens.size();
+    vector<int> toCharIndices;
+    getCharIndices(paragraph, toCharIndices);
+    const string docid = to_string(paragraph_index);
+    for (const auto &parsed_sentence: parsed_sentences) {
+        if (!toDocumentSentence(parsed_sentence, doc)) {
+            return false;
+        }
+
+        // sentence offsets are document-relative char indices, end inclusive
+        const token_t &token0 = parsed_sentence[0];
+        doc_sentence_t &sentence = doc.sentences.back();
+        int start = toCharIndex(toCharIndices, intValueOf(token0, kStart));
+        int end = toCharIndex(toCharIndices, intValueOf(token0, kEnd) - 1);
+        sentence.start = start >= 0 ? base + start : -1;
+        sentence.end = end >= 0 ? base + end : -1;
+
+        // paragraph index as docid unless the backend sets one
+        if (sentence.docid == kEmptyString)
+            sentence.docid = doc.strings.intern(docid);
+    }
+    recordConverted(doc.sentences.size() - sentences, doc.tokens.size() - tokens);
+    return true;
+}
@@ -7,12 +7,23 @@
 #include <vector>
 #include <iostream>
 #include <unistd.h>
-#include <codecvt>
-#include <locale>
+#include <cstring>
+#include <cerrno>
+#include <mutex>
 
 #include <android/log.h>
 
 #include "udpipe/iface_h.h"
+#include "udpipe/convert.h"
+#include "depparse_native/writers.h"
+#include "depparse_native/jni_sentences.h"
+#include "depparse_native/jni_document.h"
+#include "depparse_native/binary.h"
+#include "depparse_native/jni_pool.h"
+#include "depparse_native/jni_metrics.h"
+#include "depparse_native/preprocess.h"
+#include "depparse_native/trim.h"
+#include "depparse_native/char_indices.h"
 
 #define LOG_TAG    "UDPIPE_JNI"
 
@@ -24,11 +35,7 @@
 using namespace std;
 
 const char kIllegalStateException[] = "java/lang/IllegalStateException";
-
-const char sentenceClass[] = "org/depparse/Sentence";
-const char tokenClass[] = "org/depparse/Token";
-const char sentenceCtor[] = "(Ljava/lang/String;II[Lorg/depparse/Token;Ljava/lang/String;)V";
-const char tokenCtor[] = "(IILjava/lang/String;IILjava/lang/String;Ljava/lang/String;ILjava/lang/String;ILjava/lang/String;)V";
+const char kIOException[] = "java/io/IOException";
 
 // C H E C K   H E L P E R S
 
@@ -48,75 +55,26 @@ T CheckNotNull(JNIEnv *env, T &&t) {
     return std::forward<T>(t);
 }
 
-// T O   C H A R   I N D E X   H E L P E R
+// F R O M   J A V A
 
 /**
- * Creates a mapping from UTF-8 byte positions to character indices.
+ * Input texts, preprocessed in one pass each (see preprocess.h)
  *
- * @param text The UTF-8 encoded string to process
- * @return A vector where each index represents a byte position, and the value is the corresponding character index
+ * @param flags kPreprocess* flags
+ * @param hashes content hashes of preprocessed texts to fill, if not null
  */
-vector<int> getCharIndices(const string &text) {
-    // Get the byte size of the UTF-8 string
-    size_t byteSize = text.size();
-
-    // Create vector for byte-to-char index mapping (size + 1 to include position after last byte)
-    vector<int> byteToCharIndex(byteSize + 1);
-
-    // Convert to wstring to work with Unicode code points properly
-    wstring_convert<codecvt_utf8<wchar_t>> converter;
-    wstring wideText = converter.from_bytes(text);
-
-    // Iterate through each Unicode character
-    size_t bytePos = 0;
-    for (size_t i = 0; i < wideText.size(); ++i) {
-        wchar_t ch = wideText[i];
-
-        // Convert this single character back to UTF-8 to get its byte count
-        string charBytes = converter.to_bytes(ch);
-        size_t charByteCount = charBytes.size();
-
-        // Fill in the byte-to-char mapping for each byte in this character
-        for (size_t j = 0; j < charByteCount; ++j) {
-            if (bytePos + j < byteToCharIndex.size()) {
-                byteToCharIndex[bytePos + j] = static_cast<int>(i);
-            }
-        }
-        bytePos += charByteCount;
-    }
-
-    // Set the final position
-    if (bytePos < byteToCharIndex.size()) {
-        byteToCharIndex[bytePos] = static_cast<int>(wideText.size());
-    }
-
-    return byteToCharIndex;
-}
-
-// S P L I T
-
-void split(const string &s, const char c, vector<string> &v) {
-    string::size_type i = 0;
-    string::size_type j = s.find(c);
-    while (j != string::npos) {
-        v.push_back(s.substr(i, j - i));
-        i = ++j;
-        j = s.find(c, j);
-        if (j == string::npos)
-            v.push_back(s.substr(i, s.length()));
-    }
-}
-
-// F R O M   J A V A
-
 extern
-vector<string> jniStringArrayToVector(JNIEnv *env, jobjectArray string_array) {
+vector<string> jniStringArrayToVector(JNIEnv *env, jobjectArray string_array, int32_t flags, vector<uint64_t> *hashes = nullptr) {
     int count = env->GetArrayLength(string_array);
-    vector<string> result;
+    vector<string> result(count);
+    if (hashes != nullptr)
+        hashes->resize(count);
     for (int i = 0; i < count; i++) {
         auto jstr = reinterpret_cast<jstring>(env->GetObjectArrayElement(string_array, i));
         const char *raw_str = env->GetStringUTFChars(jstr, JNI_FALSE);
-        result.emplace_back(raw_str);
+        uint64_t hash = preprocessText(raw_str, static_cast<size_t>(env->GetStringUTFLength(jstr)), flags, result[i]);
+        if (hashes != nullptr)
+            (*hashes)[i] = hash;
         env->ReleaseStringUTFChars(jstr, raw_str);
     }
     return result;
@@ -131,205 +89,12 @@ string jniStringToString(JNIEnv *env, jstring jstr) {
 
 // T O   J A V A
 
-/**
- * Returns a Java sentence
- *
- * @param env environment
- * @param parsed_sentence parsed C sentence, non-null
- * @param sentenceIndex sentence index
- * @param sentence_class java class of sentence
- * @param sentence_ctor java constructor
- * @param token_class java class of token
- * @param token_ctor java constructor of token
- * @return Sentence with tokens field being Array<Token!!>!! otherwise
- * @throws IllegalStateException whenever CheckNull encounters a null value, that is
- * -word is null (should not happen)
- * -category, label, tag are guarded against being null by being set to empty string at token level
- * -text, docids are guarded against being null by being set to empty string at sentence level
- */
-jobject
-toJavaSentence(
-        JNIEnv *env,
-        const sentence_t &parsed_sentence,
-        int sentenceIndex,
-        jclass sentence_class,
-        jmethodID sentence_ctor,
-        jclass token_class,
-        jmethodID token_ctor) {
-
-    int nTokens = (int) parsed_sentence.size();
-
-    // make java array of tokens Token[] to be field of Sentence class and return back to Java
-
-    jobjectArray jtoken_array = CheckNotNull(env, env->NewObjectArray(nTokens - 1, token_class, nullptr));
-    if (env->ExceptionCheck()) {
-        return nullptr;
-    }
-
-    int sentence_start = 0;
-
-    // Sentence text as token[0] (text as token[0]["text"], docid as token[0]["docid"]
-
-    const token_t &token0 = parsed_sentence[0];
-
-    const string &text = token0.at("text");
-    const vector<int> toCharIndices = getCharIndices(text);
-
-    auto it0 = token0.find("docid");
-    const string &docid = it0 != token0.end() ? it0->second : "";
-
-    it0 = token0.find("start");
-    const string &s_start = it0 != token0.end() ? it0->second : "-1";
-    int s_istart = strtol(s_start.c_str(), nullptr, 10);
-    if (s_istart != -1)
-        s_istart = toCharIndices[s_istart];
-
-    it0 = token0.find("end");
-    const string &s_end = it0 != token0.end() ? it0->second : "-1";
-    int s_iend = strtol(s_end.c_str(), nullptr, 10);
-    if (s_iend != -1)
-        s_iend = toCharIndices[s_iend];
-
-    // Tokens
-
-    for (int j = 1; j < nTokens; j++) {
-
-        // collect token data
-
-        const token_t &token = parsed_sentence[j];
-
-        const string &word = token.at("word");
-
-        auto it = token.find("category");
-        const string &category = it != token.end() ? it->second : "";
-
-        string tag;
-        it = token.find("upostag");
-        const string &upostag = it != token.end() ? it->second : "";
-        if (!upostag.empty()) {
-            tag += "name: 'upostag' value: '";
-            tag += upostag;
-            tag += "'";
-        }
-        it = token.find("xpostag");
-        const string &xpostag = it != token.end() ? it->second : "";
-        if (!xpostag.empty()) {
-            if (!tag.empty())
-                tag += " ";
-            tag += "name: 'xpostag' value: '";
-            tag += xpostag;
-            tag += "'";
-        }
-        it = token.find("lemma");
-        const string &lemma = it != token.end() ? it->second : "";
-        if (!lemma.empty()) {
-            if (!tag.empty())
-                tag += " ";
-            tag += "name: 'lemma' value: '";
-            tag += lemma;
-            tag += "'";
-        }
-        it = token.find("feats");
-        const string &feats = it != token.end() ? it->second : "";
-        if (!feats.empty()) {
-            if (!tag.empty())
-                tag += " ";
-            //tag += "name: 'feats' value: '";
-            //tag += feats;
-            //tag += "'";
-            vector<string> features;
-            split(feats, '|', features);
-            for (const auto &feature: features) {
-                vector<string> name_value;
-                split(feature, '=', name_value);
-                if (name_value.size() == 2) {
-                    string &name = name_value[0];
-                    string &value = name_value[1];
-                    name[0] = static_cast<char>(tolower(name[0]));
-                    tag += "name: '";
-                    tag += name;
-                    tag += "' value: '";
-                    tag += value;
-                    tag += "'";
-                }
-            }
-        }
-
-        it = token.find("head");
-        const string &head = it != token.end() ? it->second : "-1";
-
-        it = token.find("label");
-        const string &label = it != token.end() ? it->second : "";
-
-        it = token.find("start");
-        const string &t_start = it != token.end() ? it->second : "-1";
-
-        it = token.find("end");
-        const string &t_end = it != token.end() ? it->second : "-1";
-
-        it = token.find("breaklevel");
-        const string &breaklevel = it != token.end() ? it->second : "-1";
-
-        it = token.find("deps");
-        const string &deps = it != token.end() ? it->second : "";
-
-        LOGD("Token #%d '%s' l=%s t=%s h=%s x=<%s>\n", j, word.c_str(), label.c_str(), tag.c_str(), head.c_str(), deps.c_str());
-
-        // token constructor parameters
-
-        jstring jword = CheckNotNull(env, env->NewStringUTF(word.c_str()));
-        int t_istart = strtol(t_start.c_str(), nullptr, 10);
-        int t_iend = strtol(t_end.c_str(), nullptr, 10) - 1;
-        if (j == 1 && t_istart != 0) {
-            sentence_start = t_istart;
-        }
-        t_istart -= sentence_start;
-        t_iend -= sentence_start;
-        if (t_istart != -1)
-            t_istart = toCharIndices[t_istart];
-        if (t_iend != -1)
-            t_iend = toCharIndices[t_iend];
-        jstring jcategory = CheckNotNull(env, env->NewStringUTF(category.c_str()));
-        jstring jtag = CheckNotNull(env, env->NewStringUTF(tag.c_str()));
-        jstring jlabel = CheckNotNull(env, env->NewStringUTF(label.c_str()));
-        int ihead = strtol(head.c_str(), nullptr, 10);
-        if (ihead > 0) // O-based
-            ihead--;
-        int ibreaklevel = strtol(breaklevel.c_str(), nullptr, 10);
-        jstring jdeps = CheckNotNull(env, env->NewStringUTF(deps.c_str()));
-
-        // make java token
-        // jword: String!!, possibly ""
-        // istart: Int!!, possibly -1
-        // iend: Int!!, possibly -1
-        // jcategory!!: String!!, possibly ""
-        // jtag: String!!
-        // ihead: Int!!, possibly -1
-        // jlabel: String!!, possibly ""
-        // ibreaklevel: Int!!, possibly -1
-        jobject jtoken = CheckNotNull(env, env->NewObject(token_class, token_ctor, sentenceIndex, j - 1, jword, t_istart, t_iend, jcategory, jtag, ihead, jlabel, ibreaklevel, jdeps));
-        if (env->ExceptionCheck()) {
-            return nullptr;
-        }
-
-        // set token in array
-
-        env->SetObjectArrayElement(jtoken_array, j - 1, jtoken);
-    }
-
-    // make sentence
-
-    jstring jtext = CheckNotNull(env, env->NewStringUTF(text.c_str()));
-    jstring jdocid = CheckNotNull(env, env->NewStringUTF(docid.c_str()));
-    jobject jsentence = env->NewObject(sentence_class, sentence_ctor, jtext, s_istart, s_iend, jtoken_array, jdocid);
-    return jsentence;
-}
-
 /**
  * Returns an array of Java sentences
  *
  * @param env environment
  * @param parsed_sentences non-null array of parsed sentences
+ * @param fields fields to convert and materialize (bit mask of kField*)
  * @return array of java sentences, Array<Array<Token!!>!!>!! or an exception is thrown
  * @throws IllegalStateException whenever
  * - classes Sentence and Token and their constructors could not be retrieved
@@ -339,59 +104,36 @@ toJavaSentence(
 jobjectArray
 toJavaSentences(
         JNIEnv *env,
-        const vector<sentence_t> &parsed_sentences) {
-
-    // check
-    int i = 0;
-    for (const auto &parsed_sentence: parsed_sentences) {
-        LOGD("Sentence #%d: %zu tokens\n", i++, parsed_sentence.size());
-        if (parsed_sentence.empty()) {
-            env->ThrowNew(env->FindClass(kIllegalStateException), "No token in sentence");
-            return nullptr;
-        }
-    }
-
-    // classes and constructors
-
-    jclass sentence_class = CheckNotNull(env, env->FindClass(sentenceClass));
-    if (env->ExceptionCheck()) {
-        return nullptr;
-    }
-    jmethodID sentence_ctor = CheckNotNull(env, env->GetMethodID(sentence_class, "<init>", sentenceCtor));
-    if (env->ExceptionCheck()) {
+        const vector<sentence_t> &parsed_sentences,
+        int32_t fields = kFieldAll) {
+
+    // convert
+    fields = neededFields(fields);
+    document_t doc;
+    if (!toDocument(parsed_sentences, doc, fields)) {
+        env->ThrowNew(env->FindClass(kIllegalStateException), "No token in sentence");
         return nullptr;
     }
-    jclass token_class = CheckNotNull(env, env->FindClass(tokenClass));
-    if (env->ExceptionCheck()) {
-        return nullptr;
-    }
-    jmethodID token_ctor = CheckNotNull(env, env->GetMethodID(token_class, "<init>", tokenCtor));
-    if (env->ExceptionCheck()) {
-        return nullptr;
-    }
-
-    // make Array<Sentence> to return back to Java
+    return toJavaSentences(env, viewOf(doc), fields);
+}
 
-    int n = static_cast<int>(parsed_sentences.size());
-    jobjectArray sentence_array = CheckNotNull(env, env->NewObjectArray(n, sentence_class, nullptr));
-    if (env->ExceptionCheck()) {
-        return nullptr;
-    }
+// N A T I V E   I N T E R F A C E
 
-    // fill Array<Sentence> to return back to Java
+/**
+ * Path of last model loaded or swapped in, by any thread
+ */
+static mutex model_path_mutex;
+static string model_path;
 
-    i = 0;
-    for (const auto &parsed_sentence: parsed_sentences) {
-        jobject jsentence = toJavaSentence(env, parsed_sentence, i, sentence_class, sentence_ctor, token_class, token_ctor);
-        env->SetObjectArrayElement(sentence_array, i, jsentence);
-        i++;
-    }
-    return sentence_array;
+static void setModelPath(const string &path) {
+    lock_guard<mutex> lock(model_path_mutex);
+    model_path = path;
 }
 
-// N A T I V E   I N T E R F A C E
-
-string model_path;
+static string lastModelPath() {
+    lock_guard<mutex> lock(model_path_mutex);
+    return model_path;
+}
 
 // u t i l s
 
@@ -419,14 +161,19 @@ JNICALL Java_org_udpipe_JNI_modelPath(
         JNIEnv *env,
         jobject /* thiz */) {
 
-    const string &s = model_path;
+    const string s = lastModelPath();
     return env->NewStringUTF(s.c_str());
 }
 
 // l o a d / u n l o a d
 
 /**
- * Native load function callable from Java
+ * Backend entry points for parse context pools
+ */
+const backend_t kBackend = {udpipe_load_h, udpipe_unload_h};
+
+/**
+ * Native load function callable from Java, single parse context
  */
 extern "C" JNIEXPORT
 jlong
@@ -436,14 +183,335 @@ JNICALL Java_org_udpipe_JNI_load(
         jstring j_model_path) {
 
     (void) type;
-    model_path = jniStringToString(env, j_model_path);
+    string path = jniStringToString(env, j_model_path);
+    setModelPath(path);
+
+    auto *pool = new model_pool_t(kBackend, 1);
+    if (!pool->load(path)) {
+        delete pool;
+        return 0;
+    }
+    return toHandle(pool);
+}
+
+/**
+ * Native loadPool function callable from Java
+ * Up to size parse contexts are loaded on demand so that as many parse calls can run concurrently,
+ * each context being a model instance of its own
+ */
+extern "C" JNIEXPORT
+jlong
+JNICALL Java_org_udpipe_JNI_loadPool(
+        JNIEnv *env,
+        jobject type,
+        jstring j_model_path,
+        jint size) {
+
+    (void) type;
+    string path = jniStringToString(env, j_model_path);
+    setModelPath(path);
+
+    auto *pool = new model_pool_t(kBackend, size);
+    if (!pool->load(path)) {
+        delete pool;
+        return 0;
+    }
+    return toHandle(pool);
+}
+
+/**
+ * Native swap function callable from Java
+ * The new model is loaded while calls keep being served by the current one, new calls then go to the new model,
+ * the current one being unloaded once calls in flight are done with it
+ *
+ * @return false if the new model could not be loaded, the current model being kept
+ */
+extern "C" JNIEXPORT
+jboolean
+JNICALL Java_org_udpipe_JNI_swap(
+        JNIEnv *env,
+        jobject type,
+        jlong handle,
+        jstring j_model_path) {
+
+    (void) type;
+    shared_ptr<model_pool_t> pool = poolOf(handle);
+    if (!pool) {
+        env->ThrowNew(env->FindClass(kIllegalStateException), "Cannot swap null handle");
+        return JNI_FALSE;
+    }
+    string path = jniStringToString(env, j_model_path);
+    if (!pool->load(path)) {
+        LOGD("Failed to swap in model %s\n", path.c_str());
+        return JNI_FALSE;
+    }
+    setModelPath(path);
+    return JNI_TRUE;
+}
+
+/**
+ * Native trim function callable from Java
+ * Releases memory according to level (that of onTrimMemory), handle staying valid: idle contexts beyond the first
+ * are unloaded and load back on demand, speculative results are dropped, page cache of model files is dropped
+ * (models already read into memory stay), free heap pages are returned
+ *
+ * @return number of contexts unloaded
+ */
+extern "C" JNIEXPORT
+jint
+JNICALL Java_org_udpipe_JNI_trim(
+        JNIEnv *env,
+        jobject type,
+        jlong handle,
+        jint level) {
+
+    (void) type;
+    shared_ptr<model_pool_t> pool = poolOf(handle);
+    if (!pool) {
+        env->ThrowNew(env->FindClass(kIllegalStateException), "Cannot trim null handle");
+        return 0;
+    }
+    int trimmed = trimMemory(*pool, level);
+    LOGD("Trimmed %d contexts at level %d\n", trimmed, level);
+    return trimmed;
+}
+
+/**
+ * Native batchState function callable from Java
+ * State of batch sizing, indexed by batch_state_t
+ */
+extern "C" JNIEXPORT
+jlongArray
+JNICALL Java_org_udpipe_JNI_batchState(
+        JNIEnv *env,
+        jobject type,
+        jlong handle) {
+
+    (void) type;
+    shared_ptr<model_pool_t> pool = poolOf(handle);
+    if (!pool) {
+        env->ThrowNew(env->FindClass(kIllegalStateException), "Cannot query null handle");
+        return nullptr;
+    }
+    jlong state[kBatchStateSize];
+    int64_t values[kBatchStateSize];
+    pool->batching.snapshot(values);
+    for (int i = 0; i < kBatchStateSize; i++)
+        state[i] = static_cast<jlong>(values[i]);
+    jlongArray array = env->NewLongArray(kBatchStateSize);
+    if (array == nullptr)
+        return nullptr;
+    env->SetLongArrayRegion(array, 0, kBatchStateSize, state);
+    return array;
+}
+
+/**
+ * Native setBatchTarget function callable from Java
+ * Batches are sized so that each takes about the target latency
+ */
+extern "C" JNIEXPORT
+void
+JNICALL Java_org_udpipe_JNI_setBatchTarget(
+        JNIEnv *env,
+        jobject type,
+        jlong handle,
+        jint millis) {
+
+    (void) type;
+    shared_ptr<model_pool_t> pool = poolOf(handle);
+    if (!pool) {
+        env->ThrowNew(env->FindClass(kIllegalStateException), "Cannot configure null handle");
+        return;
+    }
+    pool->batching.setTarget(static_cast<int64_t>(millis) * 1000000);
+}
+
+/**
+ * Native setPreprocessing function callable from Java
+ * Preprocessing of input texts of subsequent parse calls (kPreprocess* flags in preprocess.h)
+ */
+extern "C" JNIEXPORT
+void
+JNICALL Java_org_udpipe_JNI_setPreprocessing(
+        JNIEnv *env,
+        jobject type,
+        jlong handle,
+        jint flags) {
 
-    long handle = udpipe_load_h(model_path.c_str());
-    return handle;
+    (void) type;
+    shared_ptr<model_pool_t> pool = poolOf(handle);
+    if (!pool) {
+        env->ThrowNew(env->FindClass(kIllegalStateException), "Cannot configure null handle");
+        return;
+    }
+    pool->preprocessing = static_cast<int32_t>(flags);
+}
+
+// b a t c h
+
+/**
+ * Parse texts and convert them into document in batches sized by the pool's controller (see withBatches)
+ *
+ * @param parsed_by if not null, set to the path of the model that parsed all batches, empty if a swap came in between
+ * @return false if no context could be acquired or a sentence has no token, an IllegalStateException being pending
+ */
+static bool parseInBatches(JNIEnv *env, model_pool_t &pool, const vector<string> &texts, document_t &doc, string *parsed_by = nullptr) {
+    vector<sentence_t> parsed_sentences;
+    bool parsed = withBatches(env, pool, texts,
+                              [&](long context, const vector<string> &batch) {
+                                  parsed_sentences.clear();
+                                  udpipe_parse_h(context, batch, parsed_sentences);
+                              },
+                              [&](size_t &tokens) {
+                                  size_t before = doc.tokens.size();
+                                  bool converted = toDocument(parsed_sentences, doc);
+                                  tokens = doc.tokens.size() - before;
+                                  return converted;
+                              },
+                              parsed_by);
+    if (!parsed && !env->ExceptionCheck())
+        env->ThrowNew(env->FindClass(kIllegalStateException), "No token in sentence");
+    return parsed;
+}
+
+// s p e c u l a t e
+
+/**
+ * Parse of one text ahead of the call asking for it, run by the speculation worker
+ */
+static bool speculativeParse(long context, const string &text, document_t &doc) {
+    vector<sentence_t> parsed_sentences;
+    udpipe_parse_h(context, vector<string>(1, text), parsed_sentences);
+    return toDocument(parsed_sentences, doc);
+}
+
+/**
+ * Native speculate function callable from Java
+ * Texts likely to be asked for next are parsed on idle time, in order, replacing texts still queued,
+ * the results being taken by the next parse and parseToDocument calls on these texts
+ *
+ * @return number of texts queued
+ */
+extern "C" JNIEXPORT
+jint
+JNICALL Java_org_udpipe_JNI_speculate(
+        JNIEnv *env,
+        jobject type,
+        jlong handle,
+        jobjectArray input_texts) {
+
+    (void) type;
+    shared_ptr<model_pool_t> pool = poolOf(handle);
+    if (!pool) {
+        env->ThrowNew(env->FindClass(kIllegalStateException), "Cannot parse with null handle");
+        return 0;
+    }
+    vector<uint64_t> hashes;
+    vector<string> texts = jniStringArrayToVector(env, input_texts, pool->preprocessing, &hashes);
+    return static_cast<jint>(pool->speculation.speculate(std::move(texts), hashes, speculativeParse));
+}
+
+/**
+ * Native clearSpeculation function callable from Java
+ * Queued texts and parsed results not taken yet are dropped
+ */
+extern "C" JNIEXPORT
+void
+JNICALL Java_org_udpipe_JNI_clearSpeculation(
+        JNIEnv *env,
+        jobject type,
+        jlong handle) {
+
+    (void) type;
+    shared_ptr<model_pool_t> pool = poolOf(handle);
+    if (!pool) {
+        env->ThrowNew(env->FindClass(kIllegalStateException), "Cannot configure null handle");
+        return;
+    }
+    pool->speculation.clear();
+}
+
+/**
+ * Native speculationState function callable from Java
+ * State of speculative parsing (layout in speculation.h)
+ */
+extern "C" JNIEXPORT
+jlongArray
+JNICALL Java_org_udpipe_JNI_speculationState(
+        JNIEnv *env,
+        jobject type,
+        jlong handle) {
+
+    (void) type;
+    shared_ptr<model_pool_t> pool = poolOf(handle);
+    if (!pool) {
+        env->ThrowNew(env->FindClass(kIllegalStateException), "Cannot query null handle");
+        return nullptr;
+    }
+    jlong state[kSpeculationStateSize];
+    int64_t values[kSpeculationStateSize];
+    pool->speculation.snapshot(values);
+    for (int i = 0; i < kSpeculationStateSize; i++)
+        state[i] = static_cast<jlong>(values[i]);
+    jlongArray array = env->NewLongArray(kSpeculationStateSize);
+    if (array == nullptr)
+        return nullptr;
+    env->SetLongArrayRegion(array, 0, kSpeculationStateSize, state);
+    return array;
+}
+
+/**
+ * Native metricsSnapshot function callable from Java
+ * Latency histograms and throughput counters of this library since loaded (layout in metrics.h)
+ */
+extern "C" JNIEXPORT
+jlongArray
+JNICALL Java_org_udpipe_JNI_metricsSnapshot(
+        JNIEnv *env,
+        jobject type) {
+
+    (void) type;
+    return toJavaMetrics(env);
+}
+
+/**
+ * Native startTrace function callable from Java
+ * Parse calls of this library are recorded to trace file until stopTrace (format in trace.h)
+ *
+ * @return false if trace file could not be opened
+ */
+extern "C" JNIEXPORT
+jboolean
+JNICALL Java_org_udpipe_JNI_startTrace(
+        JNIEnv *env,
+        jobject type,
+        jstring j_path,
+        jboolean redact) {
+
+    (void) type;
+    const char *path = env->GetStringUTFChars(j_path, JNI_FALSE);
+    bool started = recorder().start(path, redact == JNI_TRUE);
+    env->ReleaseStringUTFChars(j_path, path);
+    return started ? JNI_TRUE : JNI_FALSE;
+}
+
+/**
+ * Native stopTrace function callable from Java
+ */
+extern "C" JNIEXPORT
+void
+JNICALL Java_org_udpipe_JNI_stopTrace(
+        JNIEnv *env,
+        jobject type) {
+
+    (void) env;
+    (void) type;
+    recorder().stop();
 }
 
 /**
  * Native unload function callable from Java
+ * Handle is dropped at once, the pool and its contexts being freed once parse calls in flight on it are done
  */
 extern "C" JNIEXPORT
 void
@@ -453,17 +521,189 @@ JNICALL Java_org_udpipe_JNI_unload(
         jlong handle) {
 
     (void) type;
-    if (handle == 0) {
+    if (!handles<model_pool_t>().remove(handle)) {
         env->ThrowNew(env->FindClass(kIllegalStateException), "Cannot free null handle");
+    }
+}
+
+// m o d e l s
+
+/**
+ * Native loadModels function callable from Java
+ * Models of several languages are kept loaded side by side within a memory budget, least recently used ones being evicted
+ *
+ * @param budget memory budget in bytes, estimated from model file sizes, unlimited if 0
+ * @param size pool size of each model
+ * @return registry handle
+ */
+extern "C" JNIEXPORT
+jlong
+JNICALL Java_org_udpipe_JNI_loadModels(
+        JNIEnv *env,
+        jobject type,
+        jlong budget,
+        jint size) {
+
+    (void) env;
+    (void) type;
+    auto *registry = new model_registry_t(kBackend, budget > 0 ? static_cast<size_t>(budget) : 0, size);
+    return toHandle(registry);
+}
+
+/**
+ * Native unloadModels function callable from Java
+ * Registry handle is dropped at once, the registry being freed, waiting for background loads to end,
+ * once calls in flight on it are done
+ */
+extern "C" JNIEXPORT
+void
+JNICALL Java_org_udpipe_JNI_unloadModels(
+        JNIEnv *env,
+        jobject type,
+        jlong registry) {
+
+    (void) type;
+    if (!handles<model_registry_t>().remove(registry)) {
+        env->ThrowNew(env->FindClass(kIllegalStateException), "Cannot free null registry");
+    }
+}
+
+/**
+ * Native prefetch function callable from Java
+ * Starts loading model in the background if not loaded
+ */
+extern "C" JNIEXPORT
+void
+JNICALL Java_org_udpipe_JNI_prefetch(
+        JNIEnv *env,
+        jobject type,
+        jlong registry,
+        jstring j_model_path) {
+
+    (void) type;
+    shared_ptr<model_registry_t> models = registryOf(registry);
+    if (!models) {
+        env->ThrowNew(env->FindClass(kIllegalStateException), "Cannot prefetch with null registry");
         return;
     }
-    udpipe_unload_h(static_cast<long>(handle));
+    models->prefetch(jniStringToString(env, j_model_path));
+}
+
+/**
+ * Native evict function callable from Java
+ * Drops model, calls in flight finishing on it
+ */
+extern "C" JNIEXPORT
+void
+JNICALL Java_org_udpipe_JNI_evict(
+        JNIEnv *env,
+        jobject type,
+        jlong registry,
+        jstring j_model_path) {
+
+    (void) type;
+    shared_ptr<model_registry_t> models = registryOf(registry);
+    if (!models) {
+        env->ThrowNew(env->FindClass(kIllegalStateException), "Cannot evict with null registry");
+        return;
+    }
+    models->evict(jniStringToString(env, j_model_path));
+}
+
+/**
+ * Native modelsSize function callable from Java
+ *
+ * @return estimated memory used by loaded models in bytes
+ */
+extern "C" JNIEXPORT
+jlong
+JNICALL Java_org_udpipe_JNI_modelsSize(
+        JNIEnv *env,
+        jobject type,
+        jlong registry) {
+
+    (void) type;
+    shared_ptr<model_registry_t> models = registryOf(registry);
+    if (!models) {
+        env->ThrowNew(env->FindClass(kIllegalStateException), "Cannot size null registry");
+        return 0;
+    }
+    return static_cast<jlong>(models->used());
+}
+
+/**
+ * Native trimModels function callable from Java
+ * Releases memory according to level: least recently used models but one are evicted from background level on,
+ * then models are trimmed as with trim
+ *
+ * @return number of models evicted
+ */
+extern "C" JNIEXPORT
+jint
+JNICALL Java_org_udpipe_JNI_trimModels(
+        JNIEnv *env,
+        jobject type,
+        jlong registry,
+        jint level) {
+
+    (void) type;
+    shared_ptr<model_registry_t> models = registryOf(registry);
+    if (!models) {
+        env->ThrowNew(env->FindClass(kIllegalStateException), "Cannot trim null registry");
+        return 0;
+    }
+    return trimMemory(*models, level);
+}
+
+/**
+ * Native parseWith function callable from Java
+ * Parses with model selected by path, loading it on a miss
+ */
+extern "C" JNIEXPORT
+jobjectArray
+JNICALL Java_org_udpipe_JNI_parseWith(
+        JNIEnv *env,
+        jobject type,
+        jlong registry,
+        jstring j_model_path,
+        jobjectArray input_texts) {
+
+    (void) type;
+    shared_ptr<model_registry_t> models = registryOf(registry);
+    if (!models) {
+        env->ThrowNew(env->FindClass(kIllegalStateException), "Cannot parse with null registry");
+        return nullptr;
+    }
+
+    // model
+    string path = jniStringToString(env, j_model_path);
+    shared_ptr<model_pool_t> pool = models->get(path, true);
+    if (!pool) {
+        string message = "Cannot load model " + path;
+        env->ThrowNew(env->FindClass(kIllegalStateException), message.c_str());
+        return nullptr;
+    }
+
+    // input
+    const vector<string> texts = jniStringArrayToVector(env, input_texts, pool->preprocessing);
+    call_metrics_t call(env, texts, "parseWith", pool.get());
+
+    // parse and convert in batches
+    document_t doc;
+    if (!parseInBatches(env, *pool, texts, doc)) {
+        return nullptr;
+    }
+    LOGD("Parsed %zu sentences with %s\n", doc.sentences.size(), path.c_str());
+
+    // interpret
+    return toJavaSentences(env, viewOf(doc));
 }
 
 // p a r s e
 
 /**
  * Native parse function callable from Java
+ * Only fields in mask are converted and materialized (see org.depparse.Fields)
  */
 extern "C" JNIEXPORT
 jobjectArray
@@ -471,25 +711,426 @@ JNICALL Java_org_udpipe_JNI_parse(
         JNIEnv *env,
         jobject type,
         jlong handle,
-        jobjectArray input_texts) {
+        jobjectArray input_texts,
+        jint fields) {
+
+    (void) type;
+    shared_ptr<model_pool_t> pool = poolOf(handle);
+    if (!pool) {
+        env->ThrowNew(env->FindClass(kIllegalStateException), "Cannot parse with null handle");
+        return nullptr;
+    }
+
+    // input
+    vector<uint64_t> hashes;
+    const vector<string> texts = jniStringArrayToVector(env, input_texts, pool->preprocessing, &hashes);
+    call_metrics_t call(env, texts, "parse", pool.get());
+
+    // parse and convert in batches, texts parsed ahead being taken as they are
+    fields = neededFields(fields);
+    document_t doc;
+    vector<sentence_t> parsed_sentences;
+    bool parsed = withSpeculation(env, *pool, texts, hashes, doc,
+                                  [&](long context, const vector<string> &batch) {
+                                      parsed_sentences.clear();
+                                      udpipe_parse_h(context, batch, parsed_sentences);
+                                  },
+                                  [&](size_t &tokens) {
+                                      size_t before = doc.tokens.size();
+                                      bool converted = toDocument(parsed_sentences, doc, fields);
+                                      tokens = doc.tokens.size() - before;
+                                      return converted;
+                                  });
+    if (!parsed) {
+        if (!env->ExceptionCheck())
+            env->ThrowNew(env->FindClass(kIllegalStateException), "No token in sentence");
+        return nullptr;
+    }
+    LOGD("Parsed %zu sentences\n", doc.sentences.size());
+
+    // interpret
+    jobjectArray sentence_array = toJavaSentences(env, viewOf(doc), fields);
+
+    LOGD("Parsing done\n");
+    return sentence_array;
+}
+
+// q u e r y
+
+/**
+ * Native query function callable from Java
+ * Parses and matches a structural pattern straight on native results, no Java sentence is built
+ *
+ * @return [width, sentence index, token..., ...], width ints per match, token indices being 0-based in sentence
+ */
+extern "C" JNIEXPORT
+jintArray
+JNICALL Java_org_udpipe_JNI_query(
+        JNIEnv *env,
+        jobject type,
+        jlong handle,
+        jobjectArray input_texts,
+        jstring pattern,
+        jint max_matches) {
 
     (void) type;
-    if (handle == 0) {
+    shared_ptr<model_pool_t> pool = poolOf(handle);
+    if (!pool) {
         env->ThrowNew(env->FindClass(kIllegalStateException), "Cannot parse with null handle");
         return nullptr;
     }
 
     // input
-    const vector<string> texts = jniStringArrayToVector(env, input_texts);
+    const vector<string> texts = jniStringArrayToVector(env, input_texts, pool->preprocessing);
+    call_metrics_t call(env, texts, "query", pool.get());
+
+    // parse and convert in batches
+    document_t doc;
+    if (!parseInBatches(env, *pool, texts, doc)) {
+        return nullptr;
+    }
+    LOGD("Parsed %zu sentences\n", doc.sentences.size());
+
+    // match
+    return toJavaMatches(env, viewOf(doc), pattern, max_matches);
+}
+
+/**
+ * Native parseToDocument function callable from Java
+ * Parse result is kept in native storage, sentences are materialized on access by org.depparse.NativeDocument
+ *
+ * @return pointer to native document, to be owned by a NativeDocument
+ */
+extern "C" JNIEXPORT
+jlong
+JNICALL Java_org_udpipe_JNI_parseToDocument(
+        JNIEnv *env,
+        jobject type,
+        jlong handle,
+        jobjectArray input_texts) {
+
+    (void) type;
+    shared_ptr<model_pool_t> pool = poolOf(handle);
+    if (!pool) {
+        env->ThrowNew(env->FindClass(kIllegalStateException), "Cannot parse with null handle");
+        return 0;
+    }
+
+    // input
+    vector<uint64_t> hashes;
+    const vector<string> texts = jniStringArrayToVector(env, input_texts, pool->preprocessing, &hashes);
+    call_metrics_t call(env, texts, "parseToDocument", pool.get());
 
-    // parse
+    // parse and convert in batches, texts parsed ahead being taken as they are, no java object is built
+    document_t doc;
     vector<sentence_t> parsed_sentences;
-    udpipe_parse_h(static_cast<long>(handle), texts, parsed_sentences);
-    LOGD("Parsed %zu sentences\n", parsed_sentences.size());
+    bool parsed = withSpeculation(env, *pool, texts, hashes, doc,
+                                  [&](long context, const vector<string> &batch) {
+                                      parsed_sentences.clear();
+                                      udpipe_parse_h(context, batch, parsed_sentences);
+                                  },
+                                  [&](size_t &tokens) {
+                                      size_t before = doc.tokens.size();
+                                      bool converted = toDocument(parsed_sentences, doc);
+                                      tokens = doc.tokens.size() - before;
+                                      return converted;
+                                  });
+    if (!parsed) {
+        if (!env->ExceptionCheck())
+            env->ThrowNew(env->FindClass(kIllegalStateException), "No token in sentence");
+        return 0;
+    }
+    LOGD("Parsed %zu sentences\n", doc.sentences.size());
+    return toNativeDocument(doc);
+}
+
+/**
+ * Native parseToDocumentCached function callable from Java
+ * Parse result is looked up in the persistent cache (keyed by model identity and input texts) and served in place if found,
+ * else parsed and stored
+ *
+ * @return pointer to native document, to be owned by a NativeDocument
+ */
+extern "C" JNIEXPORT
+jlong
+JNICALL Java_org_udpipe_JNI_parseToDocumentCached(
+        JNIEnv *env,
+        jobject type,
+        jlong handle,
+        jlong cache_ptr,
+        jobjectArray input_texts) {
+
+    (void) type;
+    shared_ptr<model_pool_t> pool = poolOf(handle);
+    if (!pool) {
+        env->ThrowNew(env->FindClass(kIllegalStateException), "Cannot parse with null handle");
+        return 0;
+    }
+    shared_ptr<parse_cache_t> cached_parses = cacheOf(cache_ptr);
+    if (!cached_parses) {
+        env->ThrowNew(env->FindClass(kIllegalStateException), "Cannot parse with null cache");
+        return 0;
+    }
+    parse_cache_t &cache = *cached_parses;
+
+    // input
+    vector<uint64_t> hashes;
+    const vector<string> texts = jniStringArrayToVector(env, input_texts, pool->preprocessing, &hashes);
+    call_metrics_t call(env, texts, "parseToDocumentCached", pool.get());
+
+    // lookup
+    const string key = cacheKey(modelIdentity(pool->path()), hashes, "parse");
+    jlong cached = toNativeDocument(cache, key);
+    if (cached != 0) {
+        LOGD("Cache hit %s\n", key.c_str());
+        return cached;
+    }
+
+    // parse and convert in batches, remembering the model that parsed: a swap may have come in since lookup
+    document_t doc;
+    string parsed_path;
+    if (!parseInBatches(env, *pool, texts, doc, &parsed_path)) {
+        return 0;
+    }
+    LOGD("Parsed %zu sentences\n", doc.sentences.size());
+
+    // store under the key of the model that parsed, not at all if batches were parsed by different models
+    if (parsed_path.empty()) {
+        LOGD("Not stored, model swapped while parsing\n");
+        return toNativeDocument(doc);
+    }
+    const string stored_key = cacheKey(modelIdentity(parsed_path), hashes, "parse");
+    if (!cache.store(stored_key, viewOf(doc))) {
+        LOGD("Cannot store %s\n", stored_key.c_str());
+    }
+    return toNativeDocument(doc);
+}
+
+/**
+ * Native parseToSharedMemory function callable from Java
+ * Parse result is written in binary layout (see binary.h) to a sealed shared memory file
+ * that can be handed over to another process and mapped read-only
+ *
+ * @return file descriptor owned by caller, -1 if shared memory is not available
+ */
+extern "C" JNIEXPORT
+jint
+JNICALL Java_org_udpipe_JNI_parseToSharedMemory(
+        JNIEnv *env,
+        jobject type,
+        jlong handle,
+        jobjectArray input_texts) {
+
+    (void) type;
+    shared_ptr<model_pool_t> pool = poolOf(handle);
+    if (!pool) {
+        env->ThrowNew(env->FindClass(kIllegalStateException), "Cannot parse with null handle");
+        return -1;
+    }
+
+    // input
+    const vector<string> texts = jniStringArrayToVector(env, input_texts, pool->preprocessing);
+    call_metrics_t call(env, texts, "parseToSharedMemory", pool.get());
+
+    // parse and convert in batches
+    document_t doc;
+    if (!parseInBatches(env, *pool, texts, doc)) {
+        return -1;
+    }
+    LOGD("Parsed %zu sentences\n", doc.sentences.size());
+
+    // write
+    int fd = writeBinaryToSharedMemory(viewOf(doc), "parse");
+    if (fd < 0) {
+        LOGD("No shared memory: %s\n", strerror(errno));
+    }
+    return fd;
+}
+
+/**
+ * Native splitParse function callable from Java
+ * Parses raw paragraphs, udpipe's tokenizer splitting each into sentences, all paragraphs under one context lease.
+ * Sentence offsets are relative to the document, made of the paragraphs each followed by one separator char,
+ * sentence indices run across the whole input, docid holds the paragraph index.
+ */
+extern "C" JNIEXPORT
+jobjectArray
+JNICALL Java_org_udpipe_JNI_splitParse(
+        JNIEnv *env,
+        jobject type,
+        jlong handle,
+        jobjectArray input_texts) {
+
+    (void) type;
+    shared_ptr<model_pool_t> pool = poolOf(handle);
+    if (!pool) {
+        env->ThrowNew(env->FindClass(kIllegalStateException), "Cannot parse with null handle");
+        return nullptr;
+    }
+
+    // input
+    const vector<string> paragraphs = jniStringArrayToVector(env, input_texts, pool->preprocessing);
+    call_metrics_t call(env, paragraphs, "splitParse", pool.get());
+
+    // parse and convert in batches of paragraphs, one paragraph at a time so that sentences are known by paragraph
+    document_t doc;
+    vector<vector<sentence_t>> parsed_paragraphs;
+    size_t p = 0;
+    int32_t base = 0;
+    bool parsed = withBatches(env, *pool, paragraphs,
+                              [&](long context, const vector<string> &batch) {
+                                  parsed_paragraphs.assign(batch.size(), vector<sentence_t>());
+                                  vector<string> paragraph(1);
+                                  for (size_t k = 0; k < batch.size(); k++) {
+                                      paragraph[0] = batch[k];
+                                      udpipe_parse_h(context, paragraph, parsed_paragraphs[k]);
+                                  }
+                              },
+                              [&](size_t &tokens) {
+                                  size_t before = doc.tokens.size();
+                                  for (const auto &parsed_paragraph: parsed_paragraphs) {
+                                      if (!toDocumentParagraph(paragraphs[p], static_cast<int>(p), base, parsed_paragraph, doc))
+                                          return false;
+                                      base += charCount(paragraphs[p].data(), paragraphs[p].size()) + 1;
+                                      p++;
+                                  }
+                                  tokens = doc.tokens.size() - before;
+                                  return true;
+                              });
+    if (!parsed) {
+        if (!env->ExceptionCheck())
+            env->ThrowNew(env->FindClass(kIllegalStateException), "No token in sentence");
+        return nullptr;
+    }
+    LOGD("Parsed %zu paragraphs into %zu sentences\n", paragraphs.size(), doc.sentences.size());
 
     // interpret
-    jobjectArray sentence_array = toJavaSentences(env, parsed_sentences);
+    jobjectArray sentence_array = toJavaSentences(env, viewOf(doc));
 
     LOGD("Parsing done\n");
     return sentence_array;
 }
+
+// c o n l l - u
+
+/**
+ * Output size above which CoNLL-U is flushed to the file descriptor
+ */
+const size_t kConlluFlush = 1 << 16;
+
+/**
+ * Native parseToConllu function callable from Java
+ * Parses and serializes to CoNLL-U straight from native results, no Java sentence is built
+ *
+ * @return UTF-8 encoded CoNLL-U
+ */
+extern "C" JNIEXPORT
+jbyteArray
+JNICALL Java_org_udpipe_JNI_parseToConllu(
+        JNIEnv *env,
+        jobject type,
+        jlong handle,
+        jobjectArray input_texts) {
+
+    (void) type;
+    shared_ptr<model_pool_t> pool = poolOf(handle);
+    if (!pool) {
+        env->ThrowNew(env->FindClass(kIllegalStateException), "Cannot parse with null handle");
+        return nullptr;
+    }
+
+    // input
+    const vector<string> texts = jniStringArrayToVector(env, input_texts, pool->preprocessing);
+    call_metrics_t call(env, texts, "parseToConllu", pool.get());
+
+    // parse and convert in batches
+    document_t doc;
+    if (!parseInBatches(env, *pool, texts, doc)) {
+        return nullptr;
+    }
+    LOGD("Parsed %zu sentences\n", doc.sentences.size());
+
+    // serialize
+    string out;
+    writeConllu(viewOf(doc), 1, out);
+
+    // single copy to java
+    auto size = static_cast<jsize>(out.size());
+    jbyteArray bytes = CheckNotNull(env, env->NewByteArray(size));
+    if (env->ExceptionCheck()) {
+        return nullptr;
+    }
+    env->SetByteArrayRegion(bytes, 0, size, reinterpret_cast<const jbyte *>(out.data()));
+    return bytes;
+}
+
+/**
+ * Native parseToConlluFd function callable from Java
+ * Parses in batches and streams CoNLL-U to the file descriptor, so memory is bounded by batch size
+ *
+ * @param fd file descriptor open for writing, not closed
+ * @return number of bytes written
+ */
+extern "C" JNIEXPORT
+jlong
+JNICALL Java_org_udpipe_JNI_parseToConlluFd(
+        JNIEnv *env,
+        jobject type,
+        jlong handle,
+        jobjectArray input_texts,
+        jint fd) {
+
+    (void) type;
+    shared_ptr<model_pool_t> pool = poolOf(handle);
+    if (!pool) {
+        env->ThrowNew(env->FindClass(kIllegalStateException), "Cannot parse with null handle");
+        return -1;
+    }
+
+    // input
+    const vector<string> texts = jniStringArrayToVector(env, input_texts, pool->preprocessing);
+    call_metrics_t call(env, texts, "parseToConlluFd", pool.get());
+
+    // parse and serialize batch by batch
+    jlong written = 0;
+    long id = 1;
+    vector<sentence_t> parsed_sentences;
+    document_t doc;
+    string out;
+    bool parsed = withBatches(env, *pool, texts,
+                              [&](long context, const vector<string> &batch) {
+                                  parsed_sentences.clear();
+                                  udpipe_parse_h(context, batch, parsed_sentences);
+                              },
+                              [&](size_t &tokens) {
+                                  doc.clear();
+                                  if (!toDocument(parsed_sentences, doc))
+                                      return false;
+                                  tokens = doc.tokens.size();
+                                  const document_view_t view = viewOf(doc);
+                                  for (int k = 0; k < view.sentence_count; k++) {
+                                      writeConlluSentence(view, k, id++, out);
+                                      if (out.size() >= kConlluFlush) {
+                                          if (!writeFully(fd, out.data(), out.size())) {
+                                              env->ThrowNew(env->FindClass(kIOException), strerror(errno));
+                                              return false;
+                                          }
+                                          written += static_cast<jlong>(out.size());
+                                          out.clear();
+                                      }
+                                  }
+                                  return true;
+                              });
+    if (!parsed) {
+        if (!env->ExceptionCheck())
+            env->ThrowNew(env->FindClass(kIllegalStateException), "No token in sentence");
+        return -1;
+    }
+    if (!writeFully(fd, out.data(), out.size())) {
+        env->ThrowNew(env->FindClass(kIOException), strerror(errno));
+        return -1;
+    }
+    written += static_cast<jlong>(out.size());
+    LOGD("Written %ld CoNLL-U bytes\n", static_cast<long>(written));
+    return written;
+}
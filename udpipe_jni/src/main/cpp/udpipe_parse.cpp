@@ -0,0 +1,335 @@
+/* Copyright 2018
+ * Bernard Bou
+ * 1313ou@gmail.com */
+
+// Headless corpus parser: parses text with the udpipe backend across worker threads,
+// streams results to stdout in input order and reports throughput to stderr.
+
+#include <string>
+#include <vector>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
+#include "udpipe/iface_h.h"
+#include "udpipe/convert.h"
+#include "depparse_native/writers.h"
+
+using namespace std;
+
+// O P T I O N S
+
+struct options_t {
+    string model_path;
+    vector<string> files;
+    int threads = 0;
+    int batch = 64;
+    bool paragraphs = false;
+    bool quiet = false;
+    bool conllu = false;
+};
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "usage: %s -m <model.udpipe> [-t threads] [-b batch] [-p] [-f tsv|conllu] [-n] [file ...]\n"
+            "  -m model     udpipe model file\n"
+            "  -t threads   worker threads, each with its own model handle (default: number of cores)\n"
+            "  -b batch     texts per parse call (default: 64)\n"
+            "  -p           paragraph input: blank-line separated paragraphs, one text each (default: one sentence per line)\n"
+            "  -f format    output format: tsv (token fields as handed to Java, default) or conllu\n"
+            "  -n           no output, report throughput only\n"
+            "  file         input files, stdin if none or '-'\n",
+            prog);
+}
+
+static bool parseOptions(int argc, char *argv[], options_t &options) {
+    int c;
+    while ((c = getopt(argc, argv, "m:t:b:pf:nh")) != -1) {
+        switch (c) {
+            case 'm':
+                options.model_path = optarg;
+                break;
+            case 't':
+                options.threads = atoi(optarg);
+                break;
+            case 'b':
+                options.batch = atoi(optarg);
+                break;
+            case 'p':
+                options.paragraphs = true;
+                break;
+            case 'f':
+                if (strcmp(optarg, "conllu") == 0)
+                    options.conllu = true;
+                else if (strcmp(optarg, "tsv") != 0)
+                    return false;
+                break;
+            case 'n':
+                options.quiet = true;
+                break;
+            default:
+                return false;
+        }
+    }
+    for (int i = optind; i < argc; i++) {
+        options.files.emplace_back(argv[i]);
+    }
+    if (options.files.empty()) {
+        options.files.emplace_back("-");
+    }
+    if (options.threads <= 0) {
+        options.threads = static_cast<int>(thread::hardware_concurrency());
+        if (options.threads <= 0)
+            options.threads = 1;
+    }
+    if (options.batch <= 0) {
+        options.batch = 1;
+    }
+    return !options.model_path.empty();
+}
+
+// I N P U T
+
+/**
+ * Reads texts from a sequence of files, one per line or one per paragraph
+ */
+class text_reader_t {
+public:
+    text_reader_t(const vector<string> &files, bool paragraphs) : files(files), paragraphs(paragraphs) {
+    }
+
+    /**
+     * Read next text
+     *
+     * @param text next text
+     * @return false when input is exhausted or a file could not be opened
+     */
+    bool next(string &text) {
+        text.clear();
+        string line;
+        while (true) {
+            if (in == nullptr && !open()) {
+                return !text.empty();
+            }
+            if (!getline(*in, line)) {
+                close();
+                if (paragraphs && !text.empty())
+                    return true;
+                continue;
+            }
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+            bytes += line.size();
+            if (line.find_first_not_of(" \t") == string::npos) {
+                if (!text.empty())
+                    return true;
+                continue;
+            }
+            if (!paragraphs) {
+                text = line;
+                return true;
+            }
+            if (!text.empty())
+                text += ' ';
+            text += line;
+        }
+    }
+
+    bool failed = false;
+    long bytes = 0;
+
+private:
+    bool open() {
+        if (next_file >= files.size() || failed)
+            return false;
+        const string &file = files[next_file++];
+        if (file == "-") {
+            in = &cin;
+            return true;
+        }
+        file_in.open(file);
+        if (!file_in) {
+            fprintf(stderr, "cannot open %s\n", file.c_str());
+            failed = true;
+            return false;
+        }
+        in = &file_in;
+        return true;
+    }
+
+    void close() {
+        if (in == &file_in)
+            file_in.close();
+        in = nullptr;
+    }
+
+    const vector<string> &files;
+    const bool paragraphs;
+    size_t next_file = 0;
+    ifstream file_in;
+    istream *in = nullptr;
+};
+
+// P I P E L I N E
+
+/**
+ * Hands out input batches to workers and writes their results in input order, sentences being numbered as written
+ */
+class pipeline_t {
+public:
+    pipeline_t(text_reader_t &reader, int batch, int max_pending, bool conllu, bool quiet) : reader(reader), batch(batch), max_pending(max_pending), conllu(conllu), quiet(quiet) {
+    }
+
+    /**
+     * Get next batch
+     *
+     * @param texts texts of batch
+     * @param seq batch sequence number
+     * @return false when input is exhausted
+     */
+    bool take(vector<string> &texts, long &seq) {
+        unique_lock<mutex> lock(m);
+        cv.wait(lock, [this] { return next_seq - next_write < max_pending; });
+        texts.clear();
+        string text;
+        while (static_cast<int>(texts.size()) < batch && reader.next(text)) {
+            texts.push_back(text);
+        }
+        if (texts.empty())
+            return false;
+        seq = next_seq++;
+        return true;
+    }
+
+    /**
+     * Deliver batch result, output is written as soon as all preceding batches are written
+     * Sentence ids run on across batches, as texts may split into any number of sentences
+     *
+     * @param seq batch sequence number
+     * @param doc parse result, taken over
+     * @param converted false if conversion failed, the batch being reported and left out
+     */
+    void deliver(long seq, document_t &doc, bool converted) {
+        lock_guard<mutex> lock(m);
+        if (!converted) {
+            fprintf(stderr, "batch %ld: no token in sentence, left out\n", seq);
+            failed = true;
+            doc.clear();
+        }
+        pending[seq] = std::move(doc);
+        for (auto it = pending.begin(); it != pending.end() && it->first == next_write; it = pending.erase(it)) {
+            const document_view_t view = viewOf(it->second);
+            sentences += view.sentence_count;
+            tokens += view.token_count;
+            if (!quiet) {
+                out.clear();
+                if (conllu)
+                    writeConllu(view, next_id, out);
+                else
+                    writeTsv(view, next_id, out);
+                fwrite(out.data(), 1, out.size(), stdout);
+            }
+            next_id += view.sentence_count;
+            next_write++;
+        }
+        cv.notify_all();
+    }
+
+    long sentences = 0;
+    long tokens = 0;
+    bool failed = false;
+
+private:
+    text_reader_t &reader;
+    const int batch;
+    const long max_pending;
+    const bool conllu;
+    const bool quiet;
+    mutex m;
+    condition_variable cv;
+    map<long, document_t> pending;
+    string out;
+    long next_seq = 0;
+    long next_write = 0;
+    long next_id = 1;
+};
+
+// W O R K E R
+
+static void work(long handle, pipeline_t &pipeline) {
+    vector<string> texts;
+    vector<sentence_t> parsed_sentences;
+    long seq;
+    while (pipeline.take(texts, seq)) {
+        parsed_sentences.clear();
+        udpipe_parse_h(handle, texts, parsed_sentences);
+
+        document_t doc;
+        bool converted = toDocument(parsed_sentences, doc);
+        pipeline.deliver(seq, doc, converted);
+    }
+}
+
+// M A I N
+
+int main(int argc, char *argv[]) {
+    options_t options;
+    if (!parseOptions(argc, argv, options)) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    // load one handle per worker, the handle interface makes no thread-safety guarantee
+    auto t0 = chrono::steady_clock::now();
+    vector<long> handles(static_cast<size_t>(options.threads), 0);
+    {
+        vector<thread> loaders;
+        for (auto &handle: handles) {
+            loaders.emplace_back([&handle, &options] { handle = udpipe_load_h(options.model_path.c_str()); });
+        }
+        for (auto &loader: loaders) {
+            loader.join();
+        }
+    }
+    for (long handle: handles) {
+        if (handle == 0) {
+            fprintf(stderr, "cannot load model %s\n", options.model_path.c_str());
+            return 1;
+        }
+    }
+    auto t1 = chrono::steady_clock::now();
+
+    // parse
+    text_reader_t reader(options.files, options.paragraphs);
+    pipeline_t pipeline(reader, options.batch, 2 * options.threads, options.conllu, options.quiet);
+    vector<thread> workers;
+    for (long handle: handles) {
+        workers.emplace_back(work, handle, ref(pipeline));
+    }
+    for (auto &worker: workers) {
+        worker.join();
+    }
+    fflush(stdout);
+    auto t2 = chrono::steady_clock::now();
+
+    for (long handle: handles) {
+        udpipe_unload_h(handle);
+    }
+
+    // report
+    double load_seconds = chrono::duration<double>(t1 - t0).count();
+    double seconds = chrono::duration<double>(t2 - t1).count();
+    fprintf(stderr, "threads=%d batch=%d bytes=%ld sentences=%ld tokens=%ld load_seconds=%.3f seconds=%.3f sentences_per_sec=%.1f tokens_per_sec=%.1f\n",
+            options.threads, options.batch, reader.bytes, pipeline.sentences, pipeline.tokens, load_seconds, seconds,
+            seconds > 0 ? pipeline.sentences / seconds : 0.,
+            seconds > 0 ? pipeline.tokens / seconds : 0.);
+    return reader.failed || pipeline.failed ? 1 : 0;
+}
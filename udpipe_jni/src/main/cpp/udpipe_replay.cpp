@@ -0,0 +1,40 @@
+/* Copyright 2018
+ * Bernard Bou
+ * 1313ou@gmail.com */
+
+// Host replayer of udpipe JNI library traces (see depparse_native/replay.h).
+// Built with UDPIPE_INFERENCE when linked against a host build of the udpipe inference library,
+// calls being replayed against a model through the same parse and conversion path as JNI.parse; stub backend only otherwise.
+
+#include <string>
+#include <vector>
+
+#include "depparse_native/replay.h"
+
+#ifdef UDPIPE_INFERENCE
+
+#include "udpipe/iface_h.h"
+#include "udpipe/convert.h"
+
+using namespace std;
+
+static size_t parse(long handle, const vector<string> &texts) {
+    vector<sentence_t> parsed_sentences;
+    udpipe_parse_h(handle, texts, parsed_sentences);
+    document_t doc;
+    toDocument(parsed_sentences, doc);
+    return doc.tokens.size();
+}
+
+int main(int argc, char *argv[]) {
+    const replay_backend_t backend = {"udpipe", udpipe_load_h, udpipe_unload_h, parse};
+    return runReplay(argc, argv, &backend);
+}
+
+#else
+
+int main(int argc, char *argv[]) {
+    return runReplay(argc, argv, nullptr);
+}
+
+#endif
@@ -0,0 +1,42 @@
+/* Copyright 2018
+ * Bernard Bou
+ * 1313ou@gmail.com */
+
+// Host training driver of the udpipe JNI library conversion code, for profile-guided builds (see depparse_native/optimize.cmake).
+// Corpus sentences are handed over as udpipe parse results: head 1-based, byte offsets with exclusive ends.
+
+#include <string>
+
+#include "udpipe/convert.h"
+#include "depparse_native/train_driver.h"
+
+using namespace std;
+
+static void toParsed(const corpus_sentence_t &sentence, parsed_sentence_t &parsed) {
+    parsed.clear();
+    parsed.emplace_back();
+    parsed_token_t &token0 = parsed.back();
+    token0["text"] = sentence.text;
+    token0["start"] = "0";
+    token0["end"] = to_string(static_cast<int>(sentence.text.size()) - 1);
+    for (const auto &t: sentence.tokens) {
+        parsed.emplace_back();
+        parsed_token_t &token = parsed.back();
+        token["word"] = t.form;
+        token["category"] = t.upos;
+        token["upostag"] = t.upos;
+        token["xpostag"] = t.xpos;
+        token["lemma"] = t.lemma;
+        token["feats"] = t.feats;
+        token["head"] = to_string(t.head);
+        token["label"] = t.deprel;
+        token["deps"] = t.deps;
+        token["start"] = to_string(t.start);
+        token["end"] = to_string(t.end);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    const training_backend_t backend = {"udpipe", toParsed, toDocument};
+    return runTraining(argc, argv, backend);
+}
@@ -0,0 +1,67 @@
+/* Copyright 2018
+ * Bernard Bou
+ * 1313ou@gmail.com */
+
+#ifndef UDPIPE_CONVERT_H
+#define UDPIPE_CONVERT_H
+
+#include <string>
+#include <vector>
+
+#include "udpipe/iface_h.h"
+#include "depparse_native/document.h"
+
+// conversion of udpipe parse results to backend-neutral documents (no JNI)
+
+/**
+ * Append a parsed sentence to document
+ *
+ * @param parsed_sentence parsed udpipe sentence, token[0] holding sentence data
+ * @param doc document to append to
+ * @return false if sentence has no token
+ */
+bool
+toDocumentSentence(const sentence_t &parsed_sentence, document_t &doc);
+
+/**
+ * Append a parsed sentence to document, projected on fields
+ *
+ * @param fields fields to convert (bit mask of kField*), others are left out
+ */
+bool
+toDocumentSentence(const sentence_t &parsed_sentence, document_t &doc, int32_t fields);
+
+/**
+ * Append parsed sentences to document
+ *
+ * @param parsed_sentences parsed udpipe sentences
+ * @param doc document to append to
+ * @return false if one parsed sentence has no token
+ */
+bool
+toDocument(const std::vector<sentence_t> &parsed_sentences, document_t &doc);
+
+/**
+ * Append parsed sentences to document, projected on fields
+ *
+ * @param fields fields to convert (bit mask of kField*), others are left out
+ */
+bool
+toDocument(const std::vector<sentence_t> &parsed_sentences, document_t &doc, int32_t fields);
+
+/**
+ * Append sentences parsed out of one paragraph to document.
+ * Sentence offsets are made relative to the document, token offsets stay relative to their sentence text,
+ * docid defaults to the paragraph index.
+ *
+ * @param paragraph paragraph text
+ * @param paragraph_index paragraph index
+ * @param base char offset of paragraph in document
+ * @param parsed_sentences parsed sentences of paragraph, token[0] start and end being paragraph byte offsets
+ * @param doc document to append to
+ * @return false if one parsed sentence has no token
+ */
+bool
+toDocumentParagraph(const std::string &paragraph, int paragraph_index, int32_t base, const std::vector<sentence_t> &parsed_sentences, document_t &doc);
+
+#endif
@@ -1,6 +1,8 @@
 package org.udpipe
 
+import org.depparse.Fields
 import org.depparse.Sentence
+import java.io.IOException
 
 object JNI {
 
@@ -11,7 +13,189 @@ object JNI {
 
     external fun version(): Int
     external fun load(modelPath: String): Long
+
+    /**
+     * Load model with a pool of up to size parse contexts, so that as many parse calls on the handle may run concurrently.
+     * Contexts are model instances loaded on demand, the first one being loaded by this call.
+     */
+    external fun loadPool(modelPath: String, size: Int): Long
+
     external fun unload(handle: Long)
 
-    external fun parse(handle: Long, inputTexts: Array<String>): Array<Sentence>
+    /**
+     * Load other model behind handle, calls being served by the current model meanwhile and those in flight finishing on it,
+     * the current model being freed once they are done
+     *
+     * @return false if the new model could not be loaded, the current one being kept
+     */
+    external fun swap(handle: Long, modelPath: String): Boolean
+
+    /**
+     * Release memory according to level (as in onTrimMemory), handle staying valid:
+     * idle parse contexts beyond the first are unloaded, speculative results dropped, page cache of model files dropped
+     * (models already read into memory stay), free heap pages returned
+     *
+     * @return number of parse contexts unloaded
+     */
+    external fun trim(handle: Long, level: Int): Int
+
+    /**
+     * State of adaptive batch sizing of parse calls (see org.depparse.BatchState)
+     */
+    external fun batchState(handle: Long): LongArray
+
+    /**
+     * Set latency target of parse batches, parse calls being split natively so that each batch takes about that long
+     *
+     * @param millis target latency per batch in milliseconds, at least 1
+     */
+    external fun setBatchTarget(handle: Long, millis: Int)
+
+    /**
+     * Set preprocessing of input texts of subsequent parse calls
+     *
+     * @param flags org.depparse.Preprocessing flags
+     */
+    external fun setPreprocessing(handle: Long, flags: Int)
+
+    /**
+     * Parse texts likely to be asked for next on idle time, in order, replacing texts still queued.
+     * Results are parked natively and taken by the next parse and parseToDocument calls on these texts.
+     * Parsing ahead holds back while other calls are in flight.
+     *
+     * @return number of texts queued
+     */
+    external fun speculate(handle: Long, texts: Array<String>): Int
+
+    /**
+     * Drop texts queued for speculative parsing and parked results
+     */
+    external fun clearSpeculation(handle: Long)
+
+    /**
+     * State of speculative parsing (see org.depparse.SpeculationState)
+     */
+    external fun speculationState(handle: Long): LongArray
+
+    /**
+     * Snapshot of library metrics since loaded: latency histograms (parse, convert, end-to-end) and counters
+     * (calls, failures, sentences, tokens, input bytes), to be decoded by org.depparse.Metrics
+     */
+    external fun metricsSnapshot(): LongArray
+
+    /**
+     * Record parse calls of this library to trace file, for replay on the host (depparse_native/replay.h),
+     * until stopTrace; a trace being recorded is ended first
+     *
+     * @param path trace file, truncated
+     * @param redact whether texts are recorded as hashes and lengths only
+     * @return false if trace file could not be opened
+     */
+    external fun startTrace(path: String, redact: Boolean): Boolean
+
+    /**
+     * End trace being recorded, if any
+     */
+    external fun stopTrace()
+
+    /**
+     * Parse
+     *
+     * @param fields fields to build (bit mask of org.depparse.Fields), others being skipped in conversion
+     */
+    external fun parse(handle: Long, inputTexts: Array<String>, fields: Int = Fields.ALL): Array<Sentence>
+
+    /**
+     * Create registry of models kept loaded side by side, keyed by model path, least recently used ones being evicted to fit budget
+     *
+     * @param budget memory budget in bytes, estimated from model file sizes, unlimited if 0
+     * @param size pool size of each model
+     * @return registry handle
+     */
+    external fun loadModels(budget: Long, size: Int): Long
+
+    /**
+     * Free registry and its models once calls in flight on it are done, waiting for background loads to end
+     */
+    external fun unloadModels(registry: Long)
+
+    /**
+     * Start loading model in the background if not loaded
+     */
+    external fun prefetch(registry: Long, modelPath: String)
+
+    /**
+     * Drop model from registry, calls in flight finishing on it
+     */
+    external fun evict(registry: Long, modelPath: String)
+
+    /**
+     * Estimated memory used by registry models in bytes
+     */
+    external fun modelsSize(registry: Long): Long
+
+    /**
+     * Release registry memory according to level: from background level on, least recently used models but one are evicted,
+     * remaining ones being trimmed as with trim
+     *
+     * @return number of models evicted
+     */
+    external fun trimModels(registry: Long, level: Int): Int
+
+    /**
+     * Parse with registry model, loading it on a miss
+     */
+    @Throws(IllegalStateException::class)
+    external fun parseWith(registry: Long, modelPath: String, inputTexts: Array<String>): Array<Sentence>
+
+    /**
+     * Parse raw paragraphs, udpipe splitting them into sentences, in one call, no sentence detection needed upstream
+     *
+     * @param inputTexts paragraphs
+     * @return sentences of all paragraphs in order, offsets relative to the paragraphs joined by one separator char, docid holding the paragraph index
+     */
+    external fun splitParse(handle: Long, inputTexts: Array<String>): Array<Sentence>
+
+    /**
+     * Parse to UTF-8 CoNLL-U, no Sentence/Token objects are built
+     */
+    external fun parseToConllu(handle: Long, inputTexts: Array<String>): ByteArray
+
+    /**
+     * Parse and stream CoNLL-U to open file descriptor (left open), returns number of bytes written
+     */
+    @Throws(IOException::class)
+    external fun parseToConlluFd(handle: Long, inputTexts: Array<String>, fd: Int): Long
+
+    /**
+     * Parse and keep result in native storage, to be wrapped in org.depparse.NativeDocument
+     * that materializes sentences on access
+     */
+    external fun parseToDocument(handle: Long, inputTexts: Array<String>): Long
+
+    /**
+     * Parse through persistent cache: a previous parse of the same texts by the same model is served in place
+     * from its mapped cache entry, else texts are parsed and the result stored
+     *
+     * @param cache org.depparse.ParseCache handle
+     * @return native document, to be wrapped in org.depparse.NativeDocument
+     */
+    external fun parseToDocumentCached(handle: Long, cache: Long, inputTexts: Array<String>): Long
+
+    /**
+     * Parse into a sealed shared memory file in binary layout, to be decoded by org.depparse.BinaryDocument
+     *
+     * @return file descriptor to adopt, -1 if shared memory is not available
+     */
+    external fun parseToSharedMemory(handle: Long, inputTexts: Array<String>): Int
+
+    /**
+     * Parse and match structural pattern natively, no Sentence/Token objects are built
+     *
+     * @param pattern query pattern, see org.depparse.QueryMatches
+     * @param maxMatches maximum number of matches, unlimited if <= 0
+     * @return packed matches, to be wrapped in org.depparse.QueryMatches
+     */
+    @Throws(IllegalArgumentException::class)
+    external fun query(handle: Long, inputTexts: Array<String>, pattern: String, maxMatches: Int): IntArray
 }